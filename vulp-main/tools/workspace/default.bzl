@@ -3,6 +3,7 @@
 # Copyright 2022 Stéphane Caron
 
 load("//tools/workspace/bullet:repository.bzl", "bullet_repository")
+load("//tools/workspace/google_benchmark:repository.bzl", "google_benchmark_repository")
 load("//tools/workspace/mpacklog:repository.bzl", "mpacklog_repository")
 load("//tools/workspace/palimpsest:repository.bzl", "palimpsest_repository")
 load("//tools/workspace/pi3hat:repository.bzl", "pi3hat_repository")
@@ -15,6 +16,7 @@ def add_default_repositories():
     be loaded and called from a WORKSPACE file.
     """
     bullet_repository()
+    google_benchmark_repository()
     mpacklog_repository()
     palimpsest_repository()
     pi3hat_repository()
@@ -0,0 +1,13 @@
+# -*- python -*-
+
+load("@bazel_tools//tools/build_defs/repo:git.bzl", "git_repository")
+
+def google_benchmark_repository():
+    """
+    Clone repository from GitHub and make its targets available for binding.
+    """
+    git_repository(
+        name = "google_benchmark",
+        remote = "https://github.com/google/benchmark",
+        tag = "v1.8.3",
+    )
@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "vulp/actuation/BulletCamera.h"
+
+#include <spdlog/spdlog.h>
+
+#include <stdexcept>
+#include <utility>
+
+#include "vulp/actuation/bullet_utils.h"
+
+namespace vulp::actuation {
+
+BulletCamera::BulletCamera(const Parameters& params, double dt,
+                           const std::string& robot_urdf_path,
+                           const std::vector<std::string>& scene_urdf_paths)
+    : params_(params), dt_(dt), period_(params.period) {
+  if (params.width < 1 || params.height < 1) {
+    throw std::invalid_argument("Camera images should have a positive size");
+  }
+  if (!bullet_.connect(eCONNECT_DIRECT)) {
+    throw std::runtime_error("Could not connect the camera world");
+  }
+
+  // The camera world is never stepped, thus has no gravity
+  robot_ = bullet_.loadURDF(robot_urdf_path);
+  if (robot_ < 0) {
+    throw std::runtime_error("Could not load the robot URDF in the camera");
+  }
+  for (const auto& urdf_path : scene_urdf_paths) {
+    if (bullet_.loadURDF(urdf_path) < 0) {
+      throw std::runtime_error("Could not load the scene URDF: " + urdf_path);
+    }
+  }
+}
+
+BulletCamera::~BulletCamera() { bullet_.disconnect(); }
+
+void BulletCamera::reset(const Parameters& params) {
+  period_ = params.period;
+  nb_cycles_ = 0;
+  capture_time_ = 0.0;
+}
+
+void BulletCamera::capture(const Eigen::Matrix4d& transform_base_to_world,
+                           const std::vector<int>& joint_indices,
+                           const std::vector<double>& joint_angles) {
+  // Mirror the robot state from the control loop
+  const Eigen::Matrix4d& T = transform_base_to_world;
+  const Eigen::Matrix3d rotation_base_to_world = T.block<3, 3>(0, 0);
+  const Eigen::Vector3d position_base_in_world = T.block<3, 1>(0, 3);
+  bullet_.resetBasePositionAndOrientation(
+      robot_, bullet_from_eigen(position_base_in_world),
+      bullet_from_eigen(Eigen::Quaterniond(rotation_base_to_world)));
+  for (size_t i = 0; i < joint_indices.size(); ++i) {
+    if (joint_indices[i] >= 0) {
+      bullet_.resetJointState(robot_, joint_indices[i], joint_angles[i]);
+    }
+  }
+
+  // Camera frame attached to the base
+  const Eigen::Vector3d eye = position_base_in_world +
+                              rotation_base_to_world * params_.position_in_base;
+  const Eigen::Vector3d target =
+      position_base_in_world + rotation_base_to_world * params_.target_in_base;
+  float view_matrix[16];
+  float projection_matrix[16];
+  bullet_.computeViewMatrix(bullet_from_eigen(eye), bullet_from_eigen(target),
+                            btVector3(0.0, 0.0, 1.0), view_matrix);
+  bullet_.computeProjectionMatrixFOV(
+      static_cast<float>(params_.fov),
+      static_cast<float>(params_.width) / static_cast<float>(params_.height),
+      static_cast<float>(params_.near_plane),
+      static_cast<float>(params_.far_plane), projection_matrix);
+
+  b3RobotSimulatorGetCameraImageArgs args(params_.width, params_.height);
+  args.m_viewMatrix = view_matrix;
+  args.m_projectionMatrix = projection_matrix;
+  args.m_renderer = ER_TINY_RENDERER;
+  b3CameraImageData image_data;
+  if (!bullet_.getCameraImage(params_.width, params_.height, args,
+                              &image_data)) {
+    spdlog::warn("Could not render the camera image at t = {} s",
+                 capture_time_);
+    return;
+  }
+
+  // The back buffer is only accessed from this function
+  BulletCameraImage& image = buffers_[back_];
+  const size_t nb_bytes = 4 * static_cast<size_t>(image_data.m_pixelWidth) *
+                          static_cast<size_t>(image_data.m_pixelHeight);
+  image.time = capture_time_;
+  image.width = image_data.m_pixelWidth;
+  image.height = image_data.m_pixelHeight;
+  image.rgba.assign(image_data.m_rgbColorData,
+                    image_data.m_rgbColorData + nb_bytes);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::swap(back_, middle_);
+  has_new_image_ = true;
+}
+
+const BulletCameraImage* BulletCamera::latest_image() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (has_new_image_) {
+    std::swap(front_, middle_);
+    has_new_image_ = false;
+    has_front_image_ = true;
+  }
+  return has_front_image_ ? &buffers_[front_] : nullptr;
+}
+
+}  // namespace vulp::actuation
@@ -0,0 +1,217 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <palimpsest/Dictionary.h>
+
+#include <Eigen/Geometry>
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "RobotSimulator/b3RobotSimulatorClientAPI.h"
+#include "vulp/utils/get_unsigned.h"
+
+namespace vulp::actuation {
+
+using palimpsest::Dictionary;
+
+//! Image rendered by a \ref BulletCamera.
+struct BulletCameraImage {
+  //! Simulation time since the last reset when the image was captured, in [s]
+  double time = 0.0;
+
+  //! Image width in pixels
+  int width = 0;
+
+  //! Image height in pixels
+  int height = 0;
+
+  //! Pixels in row-major order, with four bytes (RGBA) per pixel
+  std::vector<uint8_t> rgba;
+};
+
+/*! Simulated camera rendered on the CPU.
+ *
+ * The camera has its own direct-mode Bullet client, where the robot and scene
+ * URDFs are loaded but never stepped. At a decimated rate, the control loop
+ * applies the base pose and joint angles of the robot to the camera robot,
+ * then renders it with the TinyRenderer. Rendering happens on the thread that
+ * steps the main simulation, as Bullet clients are not documented as safe to
+ * use concurrently.
+ *
+ * Images are handed over to readers through a triple buffer: rendering
+ * writes to a back buffer, which is swapped with the latest image under a
+ * mutex, and readers swap that latest image with the buffer they hold. Pixels
+ * are never copied and buffers are allocated only once.
+ *
+ * Only the robot is mirrored in the camera world, thus environment bodies
+ * appear in their initial state.
+ */
+class BulletCamera {
+ public:
+  //! Camera parameters.
+  struct Parameters {
+    /*! Configure from dictionary.
+     *
+     * \param[in] config Global configuration dictionary.
+     */
+    void configure(const Dictionary& config) {
+      if (!config.has("bullet") || !config("bullet").has("camera")) {
+        return;
+      }
+      const auto& camera = config("bullet")("camera");
+      period = utils::get_unsigned(camera, "period", period);
+      width = camera.get<int>("width", width);
+      height = camera.get<int>("height", height);
+      fov = camera.get<double>("fov", fov);
+      near_plane = camera.get<double>("near_plane", near_plane);
+      far_plane = camera.get<double>("far_plane", far_plane);
+      position_in_base =
+          camera.get<Eigen::Vector3d>("position_in_base", position_in_base);
+      target_in_base =
+          camera.get<Eigen::Vector3d>("target_in_base", target_in_base);
+    }
+
+    /*! Number of control cycles between two captures.
+     *
+     * The camera is only created if this period is positive at construction.
+     * Upon reset, a zero period pauses captures.
+     */
+    unsigned period = 0;
+
+    //! Image width in pixels
+    int width = 160;
+
+    //! Image height in pixels
+    int height = 120;
+
+    //! Vertical field of view in [deg]
+    double fov = 60.0;
+
+    //! Distance to the near clipping plane in [m]
+    double near_plane = 0.01;
+
+    //! Distance to the far clipping plane in [m]
+    double far_plane = 10.0;
+
+    //! Position of the camera in the base frame, in [m]
+    Eigen::Vector3d position_in_base = Eigen::Vector3d(0.1, 0.0, 0.1);
+
+    //! Point the camera looks at, in the base frame, in [m]
+    Eigen::Vector3d target_in_base = Eigen::Vector3d(1.0, 0.0, -0.3);
+  };
+
+  /*! Load the camera world.
+   *
+   * \param[in] params Camera parameters.
+   * \param[in] dt Duration of a control cycle in [s].
+   * \param[in] robot_urdf_path Path to the URDF model of the robot.
+   * \param[in] scene_urdf_paths Paths to the URDFs of the scene, e.g. the
+   *     floor plane and environment bodies.
+   *
+   * \throw std::invalid_argument if the image size is not positive.
+   * \throw std::runtime_error if the camera world could not be loaded.
+   */
+  BulletCamera(const Parameters& params, double dt,
+               const std::string& robot_urdf_path,
+               const std::vector<std::string>& scene_urdf_paths);
+
+  //! Disconnect the camera world.
+  ~BulletCamera();
+
+  //! No copy constructor.
+  BulletCamera(const BulletCamera&) = delete;
+
+  //! No copy assignment operator.
+  BulletCamera& operator=(const BulletCamera&) = delete;
+
+  /*! Reset the camera clock.
+   *
+   * \param[in] params Camera parameters, of which only the period is updated.
+   */
+  void reset(const Parameters& params);
+
+  /*! Advance the camera clock by one control cycle.
+   *
+   * \return True if a snapshot should be captured at this cycle.
+   */
+  bool tick() noexcept {
+    const bool is_due = (period_ > 0 && nb_cycles_ % period_ == 0);
+    capture_time_ = nb_cycles_ * dt_;
+    ++nb_cycles_;
+    return is_due;
+  }
+
+  /*! Render the robot in a given state.
+   *
+   * \param[in] transform_base_to_world Pose of the base in the world frame.
+   * \param[in] joint_indices Bullet indices of the joints to set, negative
+   *     indices being skipped.
+   * \param[in] joint_angles Angles of these joints in [rad].
+   *
+   * The image is rendered before this function returns, then published as
+   * the latest image.
+   */
+  void capture(const Eigen::Matrix4d& transform_base_to_world,
+               const std::vector<int>& joint_indices,
+               const std::vector<double>& joint_angles);
+
+  /*! Get the latest rendered image.
+   *
+   * \return Pointer to the latest image, or nullptr if no image has been
+   *     rendered yet.
+   *
+   * The image is owned by the reader until its next call to this function,
+   * and is not modified in the meantime. There should be a single reader.
+   */
+  const BulletCameraImage* latest_image() const;
+
+ private:
+  //! Camera parameters
+  Parameters params_;
+
+  //! Duration of a control cycle in [s]
+  double dt_;
+
+  //! Number of control cycles between two captures
+  unsigned period_;
+
+  //! Number of control cycles since the last reset
+  unsigned nb_cycles_ = 0;
+
+  //! Simulation time of the current control cycle in [s]
+  double capture_time_ = 0.0;
+
+  //! Bullet client of the camera world
+  b3RobotSimulatorClientAPI bullet_;
+
+  //! Identifier of the robot model in the camera world
+  int robot_;
+
+  //! Image buffers of the triple buffer
+  std::array<BulletCameraImage, 3> buffers_;
+
+  //! Index of the buffer written by \ref capture
+  size_t back_ = 0;
+
+  //! Mutex protecting the buffer indices below
+  mutable std::mutex mutex_;
+
+  //! Index of the latest rendered image
+  mutable size_t middle_ = 1;
+
+  //! Index of the buffer owned by the reader
+  mutable size_t front_ = 2;
+
+  //! True if \ref middle_ holds an image the reader has not taken yet
+  mutable bool has_new_image_ = false;
+
+  //! True once the reader holds an image
+  mutable bool has_front_image_ = false;
+};
+
+}  // namespace vulp::actuation
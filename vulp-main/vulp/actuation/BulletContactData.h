@@ -3,18 +3,31 @@
 
 #pragma once
 
-#include <string>
+#include <Eigen/Core>
 
 namespace vulp::actuation {
 
 /*! Contact information for a single link.
  *
- * This is a placeholder class that can grow later if we want to compute a net
- * wrench from individual contact forces reported by Bullet.
+ * Individual contact forces reported by Bullet are aggregated into a net
+ * contact wrench on the link, expressed in the world frame at the centroid of
+ * contact points.
  */
 struct BulletContactData {
   //! Number of contact points detected on link
-  int num_contact_points;
+  int num_contact_points = 0;
+
+  //! Sum of normal forces at contact points, in [N]
+  double normal_force = 0.0;
+
+  //! Centroid of contact points in the world frame, in [m]
+  Eigen::Vector3d centroid_in_world = Eigen::Vector3d::Zero();
+
+  //! Net contact force exerted on the link, in the world frame, in [N]
+  Eigen::Vector3d force_in_world = Eigen::Vector3d::Zero();
+
+  //! Net contact torque at the centroid, in the world frame, in [N] * [m]
+  Eigen::Vector3d torque_in_world = Eigen::Vector3d::Zero();
 };
 
 }  // namespace vulp::actuation
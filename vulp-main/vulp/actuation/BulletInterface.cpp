@@ -4,29 +4,21 @@
 #include "vulp/actuation/BulletInterface.h"
 
 #include <algorithm>
+#include <cmath>
+#include <map>
 #include <memory>
+#include <stdexcept>
 #include <string>
 
-#include "tools/cpp/runfiles/runfiles.h"
+#include "SharedMemory/PhysicsClientC_API.h"
+#include "vulp/actuation/BulletModelCache.h"
 #include "vulp/actuation/bullet_utils.h"
 
-using bazel::tools::cpp::runfiles::Runfiles;
-
 namespace vulp::actuation {
 
-std::string find_plane_urdf(const std::string argv0) {
-  std::string error;
-  std::unique_ptr<Runfiles> runfiles(Runfiles::Create(argv0, &error));
-  if (runfiles == nullptr) {
-    throw std::runtime_error(
-        "Could not retrieve the package path to plane.urdf: " + error);
-  }
-  return runfiles->Rlocation("vulp/vulp/actuation/bullet/plane/plane.urdf");
-}
-
 BulletInterface::BulletInterface(const ServoLayout& layout,
                                  const Parameters& params)
-    : Interface(layout), params_(params) {
+    : Interface(layout), params_(params), rng_(params.seed) {
   // Start simulator
   auto flag = (params.gui ? eCONNECT_GUI : eCONNECT_DIRECT);
   bool is_connected = bullet_.connect(flag);
@@ -43,8 +35,32 @@ BulletInterface::BulletInterface(const ServoLayout& layout,
   }
   bullet_.setRealTimeSimulation(false);  // making sure
 
+  // Remember engine defaults that profiles may override
+  b3RobotSimulatorSetPhysicsEngineParameters engine_params;
+  if (!bullet_.getPhysicsEngineParameters(engine_params)) {
+    throw std::runtime_error("Could not read physics engine parameters");
+  }
+  default_solver_iterations_ = engine_params.m_numSolverIterations;
+
+  // Collision settings of the performance profile
+  b3RobotSimulatorLoadUrdfFileArgs robot_args;
+  b3RobotSimulatorLoadUrdfFileArgs env_args;
+  if (params.self_collision) {
+    robot_args.m_flags |=
+        URDF_USE_SELF_COLLISION | URDF_USE_SELF_COLLISION_EXCLUDE_ALL_PARENTS;
+  }
+  if (params.implicit_cylinders) {
+    robot_args.m_flags |= URDF_USE_IMPLICIT_CYLINDER;
+    env_args.m_flags |= URDF_USE_IMPLICIT_CYLINDER;
+  }
+  if (params.sleeping_environment) {
+    env_args.m_flags |= URDF_ENABLE_SLEEPING;
+  }
+
   // Load robot model
-  robot_ = bullet_.loadURDF(params.robot_urdf_path);
+  robot_ = bullet_.loadURDF(params.robot_urdf_path, robot_args);
+  joint_table_ =
+      BulletModelCache::joint_table(bullet_, robot_, params.robot_urdf_path);
   imu_link_index_ = get_link_index("imu");
   if (imu_link_index_ < 0) {
     throw std::runtime_error("Robot does not have a link named \"imu\"");
@@ -58,30 +74,37 @@ BulletInterface::BulletInterface(const ServoLayout& layout,
     reply.id = servo_id;
     reply.result.temperature = 20.0;  // ['C], simulation room temperature
     reply.result.voltage = 18.0;      // [V], nominal voltage of a RYOBI battery
-    joint_index_map_.try_emplace(joint_name, -1);
-    servo_reply_.try_emplace(joint_name, reply);
+    servo_slot_.try_emplace(servo_id, servo_ids_.size());
+    servo_ids_.push_back(servo_id);
+    joint_names_.push_back(joint_name);
+    joint_indices_.push_back(-1);
+    joint_u_indices_.push_back(-1);
+    velocity_torques_.push_back(0.0);
+    servo_replies_.push_back(reply);
+    joint_properties_.emplace_back();
   }
 
   // Map servo layout to Bullet
-  b3JointInfo joint_info;
-  const int nb_joints = bullet_.getNumJoints(robot_);
-  for (int joint_index = 0; joint_index < nb_joints; ++joint_index) {
-    bullet_.getJointInfo(robot_, joint_index, &joint_info);
-    std::string joint_name = joint_info.m_jointName;
-    if (joint_index_map_.find(joint_name) != joint_index_map_.end()) {
-      joint_index_map_[joint_name] = joint_index;
-
-      BulletJointProperties props;
-      props.maximum_torque = joint_info.m_jointMaxForce;
-      joint_properties_.try_emplace(joint_name, props);
+  for (size_t slot = 0; slot < joint_names_.size(); ++slot) {
+    const auto it = joint_table_->joint_index.find(joint_names_[slot]);
+    if (it != joint_table_->joint_index.end()) {
+      const int joint_index = it->second;
+      joint_indices_[slot] = joint_index;
+      joint_u_indices_[slot] = joint_table_->u_index[joint_index];
+      joint_properties_[slot].maximum_torque =
+          joint_table_->maximum_torque[joint_index];
     }
   }
 
   // Load plane URDF
+  std::vector<std::string> scene_urdf_paths;
   if (params.floor) {
-    if (bullet_.loadURDF(find_plane_urdf(params.argv0)) < 0) {
+    const std::string plane_urdf_path =
+        BulletModelCache::plane_urdf_path(params.argv0);
+    if (bullet_.loadURDF(plane_urdf_path, env_args) < 0) {
       throw std::runtime_error("Could not load the plane URDF!");
     }
+    scene_urdf_paths.push_back(plane_urdf_path);
   } else {
     spdlog::info("Not loading the plane URDF");
     if (params.gravity) {
@@ -94,29 +117,86 @@ BulletInterface::BulletInterface(const ServoLayout& layout,
   // Load environment URDFs
   for (const auto& urdf_path : params.env_urdf_paths) {
     spdlog::info("Loading environment URDF: ", urdf_path);
-    if (bullet_.loadURDF(urdf_path) < 0) {
+    if (bullet_.loadURDF(urdf_path, env_args) < 0) {
       throw std::runtime_error("Could not load the environment URDF: " +
                                urdf_path);
     }
+    scene_urdf_paths.push_back(urdf_path);
+  }
+
+  // Start the simulated camera
+  if (params.camera.period > 0) {
+    camera_ = std::make_unique<BulletCamera>(
+        params.camera, params.dt, params.robot_urdf_path, scene_urdf_paths);
+    camera_joint_angles_.resize(joint_names_.size(), 0.0);
   }
 
   // Start visualizer and configure simulation
   bullet_.configureDebugVisualizer(COV_ENABLE_RENDERING, 1);
   reset(Dictionary{});
+
+  // Save the world state restored by subsequent resets
+  snapshot_id_ = bullet_.saveStateToMemory();
+  if (snapshot_id_ < 0) {
+    spdlog::warn("Could not save the simulation state, resets will be slower");
+  }
 }
 
 BulletInterface::~BulletInterface() { bullet_.disconnect(); }
 
 void BulletInterface::reset(const Dictionary& config) {
-  params_.configure(config);
-  bullet_.setTimeStep(params_.dt);
-  reset_base_state(params_.position_base_in_world,
-                   params_.orientation_base_in_world,
+  Parameters params = params_;
+  params.configure(config);
+  if (params.nb_substeps < 1) {
+    throw std::invalid_argument("Number of substeps should be at least one");
+  }
+  if (params.contact_period < 1) {
+    throw std::invalid_argument("Contact period should be at least one cycle");
+  }
+  if (params.height_scan_period < 1) {
+    throw std::invalid_argument(
+        "Height scan period should be at least one cycle");
+  }
+  for (const auto& link_name : params.monitor_contacts) {
+    if (get_link_index(link_name) < 0) {
+      throw std::invalid_argument("Cannot monitor contacts of link \"" +
+                                  link_name + "\" not found in the URDF");
+    }
+  }
+  params_ = params;
+  bullet_.setTimeStep(params_.dt / params_.nb_substeps);
+  b3RobotSimulatorSetPhysicsEngineParameters engine_params;
+  engine_params.m_numSolverIterations =
+      (params_.solver_iterations > 0)
+          ? static_cast<int>(params_.solver_iterations)
+          : default_solver_iterations_;
+  bullet_.setPhysicsEngineParameter(engine_params);
+  if (params_.restore_snapshot && snapshot_id_ >= 0) {
+    bullet_.restoreStateFromMemory(snapshot_id_);
+  } else {
+    reset_joint_angles();
+  }
+
+  std::uniform_real_distribution<double> unit_noise(-1.0, 1.0);
+  Eigen::Vector3d position_base_in_world = params_.position_base_in_world;
+  for (Eigen::Index k = 0; k < 3; ++k) {
+    position_base_in_world[k] += params_.position_noise[k] * unit_noise(rng_);
+  }
+  const double yaw = params_.yaw_noise * unit_noise(rng_);
+  const Eigen::Quaterniond orientation_base_in_world =
+      Eigen::Quaterniond(Eigen::AngleAxisd(yaw, Eigen::Vector3d::UnitZ())) *
+      params_.orientation_base_in_world;
+  reset_base_state(position_base_in_world, orientation_base_in_world,
                    params_.linear_velocity_base_to_world_in_world,
                    params_.angular_velocity_base_in_base);
   reset_contact_data();
-  reset_joint_angles();
   reset_joint_properties();
+  reset_height_scan();
+  if (camera_ != nullptr) {
+    camera_->reset(params_.camera);
+  } else if (params_.camera.period > 0) {
+    spdlog::warn("The camera can only be enabled at construction");
+  }
 }
 
 void BulletInterface::reset_base_state(
@@ -138,35 +218,75 @@ void BulletInterface::reset_base_state(
 }
 
 void BulletInterface::reset_contact_data() {
+  contact_bucket_by_link_.assign(joint_table_->size() + 1, -1);
+  contact_buckets_.clear();
+  contact_data_.clear();
   for (const auto& link_name : params_.monitor_contacts) {
-    contact_data_.try_emplace(link_name, BulletContactData());
+    int& bucket = contact_bucket_by_link_[get_link_index(link_name) + 1];
+    if (bucket < 0) {
+      bucket = static_cast<int>(contact_data_.size());
+      contact_data_.emplace_back();
+    }
+    contact_buckets_.push_back(static_cast<size_t>(bucket));
   }
+  contact_counter_ = 0;
+}
+
+void BulletInterface::reset_height_scan() {
+  const size_t nb_rays =
+      params_.height_scan_nb_rows * params_.height_scan_nb_cols;
+  height_scan_.assign(nb_rays, -params_.height_scan_ray_depth);
+  height_scan_from_.resize(3 * nb_rays);
+  height_scan_to_.resize(3 * nb_rays);
+  height_scan_counter_ = 0;
 }
 
 void BulletInterface::reset_joint_angles() {
-  const int nb_joints = bullet_.getNumJoints(robot_);
+  const int nb_joints = static_cast<int>(joint_table_->size());
   for (int joint_index = 0; joint_index < nb_joints; ++joint_index) {
     bullet_.resetJointState(robot_, joint_index, 0.0);
   }
 }
 
 void BulletInterface::reset_joint_properties() {
-  b3JointInfo joint_info;
-  const int nb_joints = bullet_.getNumJoints(robot_);
-  for (int joint_index = 0; joint_index < nb_joints; ++joint_index) {
-    bullet_.getJointInfo(robot_, joint_index, &joint_info);
-    std::string joint_name = joint_info.m_jointName;
-    if (joint_index_map_.find(joint_name) != joint_index_map_.end()) {
-      const auto friction_it = params_.joint_friction.find(joint_name);
-      if (friction_it != params_.joint_friction.end()) {
-        joint_properties_[joint_name].friction = friction_it->second;
-      } else {
-        joint_properties_[joint_name].friction = 0.0;
-      }
+  for (size_t slot = 0; slot < joint_names_.size(); ++slot) {
+    const auto friction_it = params_.joint_friction.find(joint_names_[slot]);
+    if (friction_it != params_.joint_friction.end()) {
+      joint_properties_[slot].friction = friction_it->second;
+    } else {
+      joint_properties_[slot].friction = 0.0;
     }
   }
 }
 
+const std::map<std::string, BulletJointProperties>&
+BulletInterface::joint_properties() {
+  // Assign values in place so that references to elements remain valid
+  for (size_t slot = 0; slot < joint_names_.size(); ++slot) {
+    joint_properties_map_[joint_names_[slot]] = joint_properties_[slot];
+  }
+  return joint_properties_map_;
+}
+
+const std::map<std::string, moteus::ServoReply>&
+BulletInterface::servo_reply() {
+  // Assign values in place so that references to elements remain valid
+  for (size_t slot = 0; slot < joint_names_.size(); ++slot) {
+    servo_reply_map_[joint_names_[slot]] = servo_replies_[slot];
+  }
+  return servo_reply_map_;
+}
+
+size_t BulletInterface::find_joint_slot(const std::string& joint_name) const {
+  const auto it =
+      std::find(joint_names_.begin(), joint_names_.end(), joint_name);
+  if (it == joint_names_.end()) {
+    throw std::out_of_range("Joint \"" + joint_name +
+                            "\" is not in the servo layout");
+  }
+  return static_cast<size_t>(it - joint_names_.begin());
+}
+
 void BulletInterface::observe(Dictionary& observation) const {
   // Eigen quaternions are serialized as [w, x, y, z]
   // See include/palimpsest/mpack/eigen.h in palimpsest
@@ -178,9 +298,22 @@ void BulletInterface::observe(Dictionary& observation) const {
 
   Dictionary& monitor = observation("bullet");
   monitor("imu")("linear_velocity") = imu_data_.linear_velocity_imu_in_world;
-  for (const auto& link_name : params_.monitor_contacts) {
-    monitor("contact")(link_name)("num_contact_points") =
-        contact_data_.at(link_name).num_contact_points;
+  for (size_t i = 0; i < params_.monitor_contacts.size(); ++i) {
+    const BulletContactData& contact = contact_data_[contact_buckets_[i]];
+    auto& output = monitor("contact")(params_.monitor_contacts[i]);
+    output("num_contact_points") = contact.num_contact_points;
+    output("normal_force") = contact.normal_force;
+    output("centroid") = contact.centroid_in_world;
+    output("force") = contact.force_in_world;
+    output("torque") = contact.torque_in_world;
+  }
+
+  // Observation dictionaries persist across resets, so that a scan disabled
+  // by the last reset is removed rather than left stale
+  if (!height_scan_.empty()) {
+    monitor("height_scan") = height_scan_;
+  } else if (monitor.has("height_scan")) {
+    monitor.remove("height_scan");
   }
 
   // Observe the base state
@@ -202,9 +335,31 @@ void BulletInterface::cycle(
 
   read_joint_sensors();
   read_imu_data(imu_data_, bullet_, robot_, imu_link_index_, params_.dt);
-  read_contacts();
+  if (contact_counter_ == 0) {
+    read_contacts();
+  }
+  contact_counter_ = (contact_counter_ + 1) % params_.contact_period;
+  if (height_scan_counter_ == 0) {
+    read_height_scan();
+  }
+  height_scan_counter_ =
+      (height_scan_counter_ + 1) % params_.height_scan_period;
+  if (camera_ != nullptr && camera_->tick()) {
+    capture_camera_snapshot();
+  }
   send_commands(data);
   bullet_.stepSimulation();
+  if (params_.nb_substeps > 1) {
+    // Substeps update joint states to recompute torques, while replies
+    // report the state at the beginning of the cycle like other sensors
+    cycle_replies_ = servo_replies_;
+    for (unsigned substep = 1; substep < params_.nb_substeps; ++substep) {
+      read_joint_sensors();
+      update_joint_torques(data);
+      bullet_.stepSimulation();
+    }
+    servo_replies_.swap(cycle_replies_);
+  }
 
   if (params_.follower_camera) {
     translate_camera_to_robot();
@@ -213,33 +368,160 @@ void BulletInterface::cycle(
   moteus::Output output;
   for (size_t i = 0; i < data.replies.size(); ++i) {
     const auto servo_id = data.commands[i].id;
-    const std::string& joint_name = servo_layout().joint_name(servo_id);
     data.replies[i].id = servo_id;
-    data.replies[i].result = servo_reply_[joint_name].result;
+    data.replies[i].result = servo_replies_[find_slot(i, servo_id)].result;
     output.query_result_size = i + 1;
   }
   callback(output);
 }
 
 void BulletInterface::read_contacts() {
+  if (contact_data_.empty()) {
+    return;
+  }
+  for (auto& contact : contact_data_) {
+    contact = BulletContactData();
+  }
+
+  // Contact normals on body B point toward body A, so that forces computed
+  // from them apply to body A and are flipped for body B. Both sides are
+  // checked rather than assuming that the queried robot is always body A.
+  using Vector3dMap = Eigen::Map<const Eigen::Vector3d>;
   b3ContactInformation contact_info;
   b3RobotSimulatorGetContactPointsArgs contact_args;
-  for (const auto& link_name : params_.monitor_contacts) {
-    contact_args.m_bodyUniqueIdA = robot_;
-    contact_args.m_linkIndexA = get_link_index(link_name);
-    bullet_.getContactPoints(contact_args, &contact_info);
-    contact_data_[link_name].num_contact_points =
-        contact_info.m_numContactPoints;
+  contact_args.m_bodyUniqueIdA = robot_;
+  bullet_.getContactPoints(contact_args, &contact_info);
+  for (int k = 0; k < contact_info.m_numContactPoints; ++k) {
+    const b3ContactPointData& point = contact_info.m_contactPointData[k];
+    const Eigen::Vector3d force_on_a =
+        point.m_normalForce * Vector3dMap(point.m_contactNormalOnBInWS) +
+        point.m_linearFrictionForce1 *
+            Vector3dMap(point.m_linearFrictionDirection1) +
+        point.m_linearFrictionForce2 *
+            Vector3dMap(point.m_linearFrictionDirection2);
+    if (point.m_bodyUniqueIdA == robot_) {
+      add_contact_force(point.m_linkIndexA,
+                        Vector3dMap(point.m_positionOnAInWS),
+                        point.m_normalForce, force_on_a);
+    }
+    if (point.m_bodyUniqueIdB == robot_) {
+      add_contact_force(point.m_linkIndexB,
+                        Vector3dMap(point.m_positionOnBInWS),
+                        point.m_normalForce, -force_on_a);
+    }
+  }
+
+  for (auto& contact : contact_data_) {
+    if (contact.num_contact_points > 0) {
+      contact.centroid_in_world /= contact.num_contact_points;
+      contact.torque_in_world -=
+          contact.centroid_in_world.cross(contact.force_in_world);
+    }
+  }
+}
+
+void BulletInterface::add_contact_force(int link_index,
+                                        const Eigen::Vector3d& position,
+                                        double normal_force,
+                                        const Eigen::Vector3d& force) {
+  const size_t link_key = static_cast<size_t>(link_index + 1);
+  if (link_key >= contact_bucket_by_link_.size() ||
+      contact_bucket_by_link_[link_key] < 0) {
+    return;
+  }
+
+  // Torques are summed at the world origin until the centroid is known
+  auto& contact = contact_data_[contact_bucket_by_link_[link_key]];
+  contact.num_contact_points++;
+  contact.normal_force += normal_force;
+  contact.centroid_in_world += position;
+  contact.force_in_world += force;
+  contact.torque_in_world += position.cross(force);
+}
+
+void BulletInterface::capture_camera_snapshot() {
+  for (size_t slot = 0; slot < servo_replies_.size(); ++slot) {
+    camera_joint_angles_[slot] =
+        servo_replies_[slot].result.position * (2.0 * M_PI);
+  }
+  camera_->capture(transform_base_to_world(), joint_indices_,
+                   camera_joint_angles_);
+}
+
+void BulletInterface::read_height_scan() {
+  const size_t nb_rays = height_scan_.size();
+  if (nb_rays == 0) {
+    return;
+  }
+
+  // Grid of rays centered on the base and rotated by its yaw
+  const Eigen::Matrix4d T = transform_base_to_world();
+  const double yaw = std::atan2(T(1, 0), T(0, 0));
+  const double cos_yaw = std::cos(yaw);
+  const double sin_yaw = std::sin(yaw);
+  const double spacing = params_.height_scan_spacing;
+  const double x_offset = -0.5 * (params_.height_scan_nb_rows - 1) * spacing;
+  const double y_offset = -0.5 * (params_.height_scan_nb_cols - 1) * spacing;
+  const double z_from = T(2, 3) + params_.height_scan_ray_height;
+  const double z_to = T(2, 3) - params_.height_scan_ray_depth;
+  size_t k = 0;
+  for (unsigned row = 0; row < params_.height_scan_nb_rows; ++row) {
+    const double dx = x_offset + row * spacing;
+    for (unsigned col = 0; col < params_.height_scan_nb_cols; ++col, ++k) {
+      const double dy = y_offset + col * spacing;
+      const double x = T(0, 3) + cos_yaw * dx - sin_yaw * dy;
+      const double y = T(1, 3) + sin_yaw * dx + cos_yaw * dy;
+      height_scan_from_[3 * k] = height_scan_to_[3 * k] = x;
+      height_scan_from_[3 * k + 1] = height_scan_to_[3 * k + 1] = y;
+      height_scan_from_[3 * k + 2] = z_from;
+      height_scan_to_[3 * k + 2] = z_to;
+    }
+  }
+
+  // Rays only hit static bodies (btBroadphaseProxy::StaticFilter)
+  constexpr int kStaticFilter = 2;
+  b3PhysicsClientHandle client = bullet_.getPhysicsClientHandle();
+  b3SharedMemoryCommandHandle command =
+      b3CreateRaycastBatchCommandInit(client);
+  b3RaycastBatchSetCollisionFilterMask(command, kStaticFilter);
+  b3RaycastBatchAddRays(client, command, height_scan_from_.data(),
+                        height_scan_to_.data(), static_cast<int>(nb_rays));
+  b3SharedMemoryStatusHandle status =
+      b3SubmitClientCommandAndWaitStatus(client, command);
+  if (b3GetStatusType(status) !=
+      CMD_REQUEST_RAY_CAST_INTERSECTIONS_COMPLETED) {
+    throw std::runtime_error("Could not cast height scan rays");
+  }
+
+  b3RaycastInformation raycast_info;
+  b3GetRaycastInformation(client, &raycast_info);
+  const size_t nb_hits = static_cast<size_t>(raycast_info.m_numRayHits);
+  for (k = 0; k < nb_rays; ++k) {
+    const bool has_hit =
+        k < nb_hits && raycast_info.m_rayHits[k].m_hitObjectUniqueId >= 0;
+    height_scan_[k] =
+        has_hit ? raycast_info.m_rayHits[k].m_hitPositionWorld[2] - T(2, 3)
+                : -params_.height_scan_ray_depth;
   }
 }
 
 void BulletInterface::read_joint_sensors() {
+  // getJointState would request the full robot state for each joint
+  b3PhysicsClientHandle client = bullet_.getPhysicsClientHandle();
+  b3SharedMemoryStatusHandle status = b3SubmitClientCommandAndWaitStatus(
+      client, b3RequestActualStateCommandInit(client, robot_));
+  if (b3GetStatusType(status) != CMD_ACTUAL_STATE_UPDATE_COMPLETED) {
+    throw std::runtime_error("Could not read joint states from the simulator");
+  }
+
   b3JointSensorState sensor_state;
-  for (const auto& name_index : joint_index_map_) {
-    const auto& joint_name = name_index.first;
-    const auto joint_index = name_index.second;
-    bullet_.getJointState(robot_, joint_index, &sensor_state);
-    auto& result = servo_reply_[joint_name].result;
+  for (size_t slot = 0; slot < joint_indices_.size(); ++slot) {
+    if (joint_indices_[slot] < 0 ||
+        !b3GetJointState(client, status, joint_indices_[slot],
+                         &sensor_state)) {
+      continue;
+    }
+    auto& result = servo_replies_[slot].result;
     result.position = sensor_state.m_jointPosition / (2.0 * M_PI);
     result.velocity = sensor_state.m_jointVelocity / (2.0 * M_PI);
     result.torque = sensor_state.m_jointMotorTorque;
@@ -247,28 +529,26 @@ void BulletInterface::read_joint_sensors() {
 }
 
 void BulletInterface::send_commands(const moteus::Data& data) {
-  b3RobotSimulatorJointMotorArgs motor_args(CONTROL_MODE_VELOCITY);
-
-  for (const auto& command : data.commands) {
-    const auto servo_id = command.id;
-    const std::string& joint_name = servo_layout().joint_name(servo_id);
-    const int joint_index = joint_index_map_[joint_name];
-
-    const auto previous_mode = servo_reply_[joint_name].result.mode;
+  velocity_slots_.clear();
+  torque_slots_.clear();
+  torque_command_indices_.clear();
+  for (size_t i = 0; i < data.commands.size(); ++i) {
+    const auto& command = data.commands[i];
+    const size_t slot = find_slot(i, command.id);
+    auto& result = servo_replies_[slot].result;
+
+    const auto previous_mode = result.mode;
     if (previous_mode == moteus::Mode::kStopped &&
         command.mode != moteus::Mode::kStopped) {
       // disable velocity controllers to enable torque control
-      motor_args.m_controlMode = CONTROL_MODE_VELOCITY;
-      motor_args.m_maxTorqueValue = 0.;  // [N m]
-      bullet_.setJointMotorControl(robot_, joint_index, motor_args);
+      velocity_torques_[slot] = 0.;  // [N m]
+      velocity_slots_.push_back(slot);
     }
-    servo_reply_[joint_name].result.mode = command.mode;
+    result.mode = command.mode;
 
     if (command.mode == moteus::Mode::kStopped) {
-      motor_args.m_controlMode = CONTROL_MODE_VELOCITY;
-      motor_args.m_maxTorqueValue = 100.;  // [N m]
-      motor_args.m_targetVelocity = 0.;    // [rad] / [s]
-      bullet_.setJointMotorControl(robot_, joint_index, motor_args);
+      velocity_torques_[slot] = 100.;  // [N m]
+      velocity_slots_.push_back(slot);
       continue;
     }
 
@@ -278,29 +558,83 @@ void BulletInterface::send_commands(const moteus::Data& data) {
           std::to_string(static_cast<unsigned>(command.mode)));
     }
 
-    const double target_position = command.position.position * (2.0 * M_PI);
-    const double target_velocity = command.position.velocity * (2.0 * M_PI);
-    const double feedforward_torque = command.position.feedforward_torque;
-    const double kp_scale = command.position.kp_scale;
-    const double kd_scale = command.position.kd_scale;
-    const double maximum_torque = command.position.maximum_torque;
-    const double joint_torque = compute_joint_torque(
-        joint_name, feedforward_torque, target_position, target_velocity,
-        kp_scale, kd_scale, maximum_torque);
-    motor_args.m_controlMode = CONTROL_MODE_TORQUE;
-    motor_args.m_maxTorqueValue = joint_torque;
-    servo_reply_[joint_name].result.torque = joint_torque;
-    bullet_.setJointMotorControl(robot_, joint_index, motor_args);
+    result.torque = compute_command_torque(slot, command);
+    torque_slots_.push_back(slot);
+    torque_command_indices_.push_back(i);
   }
+
+  // Velocity controllers are disabled before torques apply
+  submit_motor_commands(CONTROL_MODE_VELOCITY, velocity_slots_);
+  submit_motor_commands(CONTROL_MODE_TORQUE, torque_slots_);
+}
+
+void BulletInterface::update_joint_torques(const moteus::Data& data) {
+  for (size_t k = 0; k < torque_slots_.size(); ++k) {
+    const size_t slot = torque_slots_[k];
+    const auto& command = data.commands[torque_command_indices_[k]];
+    servo_replies_[slot].result.torque = compute_command_torque(slot, command);
+  }
+  submit_motor_commands(CONTROL_MODE_TORQUE, torque_slots_);
+}
+
+double BulletInterface::compute_command_torque(
+    const size_t slot, const moteus::ServoCommand& command) {
+  const double target_position = command.position.position * (2.0 * M_PI);
+  const double target_velocity = command.position.velocity * (2.0 * M_PI);
+  const double feedforward_torque = command.position.feedforward_torque;
+  const double kp_scale = command.position.kp_scale;
+  const double kd_scale = command.position.kd_scale;
+  const double maximum_torque = command.position.maximum_torque;
+  return compute_joint_torque(slot, feedforward_torque, target_position,
+                              target_velocity, kp_scale, kd_scale,
+                              maximum_torque);
+}
+
+void BulletInterface::submit_motor_commands(int control_mode,
+                                            const std::vector<size_t>& slots) {
+  if (slots.empty()) {
+    return;
+  }
+
+  // Same gain as the default of b3RobotSimulatorJointMotorArgs
+  const double velocity_kd =
+      b3RobotSimulatorJointMotorArgs(CONTROL_MODE_VELOCITY).m_kd;
+  b3PhysicsClientHandle client = bullet_.getPhysicsClientHandle();
+  b3SharedMemoryCommandHandle command =
+      b3JointControlCommandInit2(client, robot_, control_mode);
+  for (const size_t slot : slots) {
+    const int u_index = joint_u_indices_[slot];
+    if (u_index < 0) {
+      continue;  // joint is not in the URDF
+    }
+    if (control_mode == CONTROL_MODE_TORQUE) {
+      b3JointControlSetDesiredForceTorque(command, u_index,
+                                          servo_replies_[slot].result.torque);
+    } else {
+      b3JointControlSetDesiredVelocity(command, u_index, 0.);  // [rad] / [s]
+      b3JointControlSetKd(command, u_index, velocity_kd);
+      b3JointControlSetMaximumForce(command, u_index, velocity_torques_[slot]);
+    }
+  }
+  b3SubmitClientCommandAndWaitStatus(client, command);
 }
 
 double BulletInterface::compute_joint_torque(
     const std::string& joint_name, const double feedforward_torque,
     const double target_position, const double target_velocity,
     const double kp_scale, const double kd_scale, const double maximum_torque) {
+  return compute_joint_torque(find_joint_slot(joint_name), feedforward_torque,
+                              target_position, target_velocity, kp_scale,
+                              kd_scale, maximum_torque);
+}
+
+double BulletInterface::compute_joint_torque(
+    const size_t slot, const double feedforward_torque,
+    const double target_position, const double target_velocity,
+    const double kp_scale, const double kd_scale, const double maximum_torque) {
   assert(!std::isnan(target_velocity));
-  const BulletJointProperties& joint_props = joint_properties_[joint_name];
-  const auto& measurements = servo_reply_[joint_name].result;
+  const BulletJointProperties& joint_props = joint_properties_[slot];
+  const auto& measurements = servo_replies_[slot].result;
   const double measured_position = measurements.position * (2.0 * M_PI);
   const double measured_velocity = measurements.velocity * (2.0 * M_PI);
   const double kp = kp_scale * params_.torque_control_kp;
@@ -339,6 +673,24 @@ Eigen::Vector3d BulletInterface::linear_velocity_base_to_world_in_world()
   return eigen_from_bullet(linear_velocity_base_to_world_in_world);
 }
 
+int BulletInterface::solver_iterations() {
+  b3RobotSimulatorSetPhysicsEngineParameters engine_params;
+  bullet_.getPhysicsEngineParameters(engine_params);
+  return engine_params.m_numSolverIterations;
+}
+
+double BulletInterface::compute_robot_mass() {
+  double mass = 0.0;
+  b3DynamicsInfo dynamics_info;
+  for (int link_index = -1; link_index < bullet_.getNumJoints(robot_);
+       ++link_index) {
+    if (bullet_.getDynamicsInfo(robot_, link_index, &dynamics_info)) {
+      mass += dynamics_info.m_mass;
+    }
+  }
+  return mass;
+}
+
 Eigen::Vector3d BulletInterface::angular_velocity_base_in_base()
     const noexcept {
   btVector3 angular_velocity_base_to_world_in_world;
@@ -361,13 +713,9 @@ void BulletInterface::translate_camera_to_robot() {
                                      camera_info.m_yaw, position_base_in_world);
 }
 
-int BulletInterface::get_link_index(const std::string& link_name) {
-  if (link_index_.find(link_name) != link_index_.end()) {
-    return link_index_[link_name];
-  }
-  int link_index = find_link_index(bullet_, robot_, link_name);
-  link_index_[link_name] = link_index;
-  return link_index;
+int BulletInterface::get_link_index(const std::string& link_name) const {
+  const auto it = joint_table_->link_index.find(link_name);
+  return (it != joint_table_->link_index.end()) ? it->second : -1;
 }
 
 }  // namespace vulp::actuation
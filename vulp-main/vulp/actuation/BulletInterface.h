@@ -8,16 +8,23 @@
 
 #include <limits>
 #include <map>
+#include <memory>
+#include <random>
+#include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "RobotSimulator/b3RobotSimulatorClientAPI.h"
+#include "vulp/actuation/BulletCamera.h"
 #include "vulp/actuation/BulletContactData.h"
 #include "vulp/actuation/BulletImuData.h"
 #include "vulp/actuation/BulletJointProperties.h"
+#include "vulp/actuation/BulletModelCache.h"
 #include "vulp/actuation/Interface.h"
 #include "vulp/actuation/moteus/Output.h"
 #include "vulp/actuation/moteus/ServoReply.h"
+#include "vulp/utils/get_unsigned.h"
 
 namespace vulp::actuation {
 
@@ -47,8 +54,39 @@ class BulletInterface : public Interface {
       spdlog::info("Applying \"bullet\" runtime configuration...");
 
       const auto& bullet = config("bullet");
+      camera.configure(config);
+      if (bullet.has("profile")) {
+        apply_profile(bullet.get<std::string>("profile"));
+      }
+      contact_period =
+          utils::get_unsigned(bullet, "contact_period", contact_period);
       follower_camera = bullet.get<bool>("follower_camera", follower_camera);
       gui = bullet.get<bool>("gui", gui);
+      nb_substeps = utils::get_unsigned(bullet, "nb_substeps", nb_substeps);
+      restore_snapshot =
+          bullet.get<bool>("restore_snapshot", restore_snapshot);
+      solver_iterations =
+          utils::get_unsigned(bullet, "solver_iterations", solver_iterations);
+      self_collision = bullet.get<bool>("self_collision", self_collision);
+      implicit_cylinders =
+          bullet.get<bool>("implicit_cylinders", implicit_cylinders);
+      sleeping_environment =
+          bullet.get<bool>("sleeping_environment", sleeping_environment);
+
+      if (bullet.has("height_scan")) {
+        const auto& scan = bullet("height_scan");
+        height_scan_nb_rows =
+            utils::get_unsigned(scan, "nb_rows", height_scan_nb_rows);
+        height_scan_nb_cols =
+            utils::get_unsigned(scan, "nb_cols", height_scan_nb_cols);
+        height_scan_period =
+            utils::get_unsigned(scan, "period", height_scan_period);
+        height_scan_spacing = scan.get<double>("spacing", height_scan_spacing);
+        height_scan_ray_height =
+            scan.get<double>("ray_height", height_scan_ray_height);
+        height_scan_ray_depth =
+            scan.get<double>("ray_depth", height_scan_ray_depth);
+      }
 
       monitor_contacts.clear();
       if (bullet.has("monitor")) {
@@ -81,6 +119,9 @@ class BulletInterface : public Interface {
             "linear_velocity_base_to_world_in_world", Eigen::Vector3d::Zero());
         angular_velocity_base_in_base = reset.get<Eigen::Vector3d>(
             "angular_velocity_base_in_base", Eigen::Vector3d::Zero());
+        position_noise = reset.get<Eigen::Vector3d>("position_noise",
+                                                    Eigen::Vector3d::Zero());
+        yaw_noise = reset.get<double>("yaw_noise", 0.0);
       }
 
       if (bullet.has("torque_control")) {
@@ -89,6 +130,41 @@ class BulletInterface : public Interface {
       }
     }
 
+    /*! Apply the settings of a performance profile.
+     *
+     * \param[in] name Name of the profile: "default", "fast" or "accurate".
+     *
+     * \throw std::invalid_argument if the profile is unknown.
+     *
+     * The default profile keeps Bullet defaults. The fast profile trades
+     * accuracy for step time with fewer solver iterations, implicit cylinder
+     * collision shapes and sleeping environment bodies. The accurate profile
+     * runs more solver iterations and enables self-collisions. In \ref
+     * configure, settings given explicitly override those of the profile.
+     */
+    void apply_profile(const std::string& name) {
+      if (name == "default") {
+        solver_iterations = 0;
+        self_collision = false;
+        implicit_cylinders = false;
+        sleeping_environment = false;
+      } else if (name == "fast") {
+        solver_iterations = 10;
+        self_collision = false;
+        implicit_cylinders = true;
+        sleeping_environment = true;
+      } else if (name == "accurate") {
+        solver_iterations = 100;
+        self_collision = true;
+        implicit_cylinders = false;
+        sleeping_environment = false;
+      } else {
+        throw std::invalid_argument("Unknown performance profile \"" + name +
+                                    "\"");
+      }
+      profile = name;
+    }
+
     /*! Value of argv[0] used to locate runfiles (e.g. plane.urdf) in Bazel.
      *
      * This value helps find runfiles because Bazel does not seem to set the
@@ -104,12 +180,95 @@ class BulletInterface : public Interface {
      */
     std::string argv0 = "";
 
-    //! Contacts to monitor and report along with observations
+    //! Parameters of the simulated camera, disabled by default.
+    BulletCamera::Parameters camera;
+
+    /*! Links whose contacts are monitored and reported with observations.
+     *
+     * Names should match child links of joints in the URDF, otherwise resets
+     * throw.
+     */
     std::vector<std::string> monitor_contacts;
 
+    /*! Number of cycles between two readings of monitored contacts.
+     *
+     * Contacts are read at the first cycle after a reset, then every this
+     * many cycles. Observations report the last contacts read in between.
+     */
+    unsigned contact_period = 1;
+
+    /*! Number of rows of the height scan grid, along the heading of the
+     * base. The height scan is disabled if there are no rows or columns.
+     */
+    unsigned height_scan_nb_rows = 0;
+
+    //! Number of columns of the height scan grid, along the lateral axis.
+    unsigned height_scan_nb_cols = 0;
+
+    //! Number of cycles between two height scans.
+    unsigned height_scan_period = 1;
+
+    //! Distance between two neighboring rays of the height scan, in [m].
+    double height_scan_spacing = 0.1;
+
+    //! Height above the base where height scan rays start, in [m].
+    double height_scan_ray_height = 1.0;
+
+    //! Depth below the base where height scan rays end, in [m].
+    double height_scan_ray_depth = 2.0;
+
     //! Simulation timestep in [s]
     double dt = std::numeric_limits<double>::quiet_NaN();
 
+    /*! Number of physics steps per simulation timestep.
+     *
+     * Each cycle steps the physics engine this many times with a timestep of
+     * dt / nb_substeps. Joint torques from position commands are recomputed
+     * at each substep, emulating the inner loop of moteus controllers, while
+     * observations are still only read once per cycle.
+     */
+    unsigned nb_substeps = 1;
+
+    /*! If true, resets restore the world state saved after loading.
+     *
+     * The snapshot covers the robot and environment bodies, which are thus
+     * all back to their initial state in a single call. Otherwise, resets
+     * only zero joint angles one at a time.
+     */
+    bool restore_snapshot = true;
+
+    //! Name of the last performance profile applied.
+    std::string profile = "default";
+
+    /*! Maximum number of constraint solver iterations per physics step.
+     *
+     * Zero selects the Bullet default, read from the engine at construction,
+     * even after a profile with more iterations was applied. This setting is
+     * applied at construction and upon reset.
+     */
+    unsigned solver_iterations = 0;
+
+    /*! If true, enable collisions between links of the robot.
+     *
+     * Collisions between a link and its ancestors are filtered out, as these
+     * pairs are connected by joints. Only applied at construction.
+     */
+    bool self_collision = false;
+
+    /*! If true, use implicit cylinders rather than convex meshes for
+     * cylinder collision shapes. Only applied at construction.
+     */
+    bool implicit_cylinders = false;
+
+    /*! If true, environment bodies sleep when they come to rest, so that
+     * they cost no simulation time until woken up. Only applied at
+     * construction.
+     */
+    bool sleeping_environment = false;
+
+    //! Seed of the random number generator, only used at construction.
+    unsigned seed = 0;
+
     //! Translate the camera to follow the robot
     bool follower_camera = false;
 
@@ -157,6 +316,12 @@ class BulletInterface : public Interface {
     //! Body angular velocity of the base upon reset
     Eigen::Vector3d angular_velocity_base_in_base = Eigen::Vector3d::Zero();
 
+    //! Half-widths of uniform noise added to the base position upon reset
+    Eigen::Vector3d position_noise = Eigen::Vector3d::Zero();
+
+    //! Half-width of uniform noise added to the base yaw upon reset, in [rad]
+    double yaw_noise = 0.0;
+
     //! Joint friction parameters
     std::map<std::string, double> joint_friction;
   };
@@ -176,6 +341,13 @@ class BulletInterface : public Interface {
   /*! Reset interface.
    *
    * \param[in] config Additional configuration dictionary.
+   *
+   * \throw std::invalid_argument if the number of substeps or a reading
+   *     period is zero, or if the performance profile is unknown.
+   *
+   * The world state saved after loading is restored, unless disabled in
+   * parameters, then the floating base is reset to its configured state
+   * plus optional position and yaw noise.
    */
   void reset(const Dictionary& config) override;
 
@@ -207,6 +379,20 @@ class BulletInterface : public Interface {
    */
   Eigen::Vector3d linear_velocity_base_to_world_in_world() const noexcept;
 
+  /*! Get the total mass of the robot in [kg].
+   *
+   * \note This function is only used for testing and does not need to be
+   * optimized.
+   */
+  double compute_robot_mass();
+
+  /*! Get the number of solver iterations currently set in the engine.
+   *
+   * \note This function is only used for testing and does not need to be
+   * optimized.
+   */
+  int solver_iterations();
+
   /*! Get the groundtruth floating base angular velocity.
    *
    * \note This function is only used for testing and does not need to be
@@ -217,6 +403,9 @@ class BulletInterface : public Interface {
   //! Reset contact data.
   void reset_contact_data();
 
+  //! Reset height scan buffers to the configured grid.
+  void reset_height_scan();
+
   //! Reset joint angles to zero.
   void reset_joint_angles();
 
@@ -239,15 +428,32 @@ class BulletInterface : public Interface {
       const Eigen::Vector3d& linear_velocity_base_to_world_in_world,
       const Eigen::Vector3d& angular_velocity_base_in_base);
 
-  //! Joint properties (accessor used for testing)
-  const std::map<std::string, BulletJointProperties>& joint_properties() {
-    return joint_properties_;
+  /*! Get the latest image of the simulated camera.
+   *
+   * \return Pointer to the latest image, or nullptr if the camera is
+   *     disabled or has not rendered any image yet.
+   *
+   * Images are shared without copy through a triple buffer: the returned
+   * image is valid and unchanged until the next call to this function. They
+   * are not written to observation dictionaries.
+   */
+  const BulletCameraImage* camera_image() const {
+    return (camera_ != nullptr) ? camera_->latest_image() : nullptr;
   }
 
-  //! Internal map of servo replies (accessor used for testing)
-  const std::map<std::string, moteus::ServoReply>& servo_reply() {
-    return servo_reply_;
-  }
+  /*! Joint properties (accessor used for testing)
+   *
+   * \note This function copies per-joint state to a map and does not need to
+   * be optimized.
+   */
+  const std::map<std::string, BulletJointProperties>& joint_properties();
+
+  /*! Internal map of servo replies (accessor used for testing)
+   *
+   * \note This function copies per-joint state to a map and does not need to
+   * be optimized.
+   */
+  const std::map<std::string, moteus::ServoReply>& servo_reply();
 
   /*! Reproduce the moteus position controller in Bullet.
    *
@@ -260,6 +466,10 @@ class BulletInterface : public Interface {
    * \param[in] kd_scale Multiplicative factor applied to the derivative gain
    *     in torque control.
    * \param[in] maximum_torque Maximum torque in [N] * [m] from the command.
+   *
+   * \throw std::out_of_range if the joint is not in the servo layout.
+   *
+   * \note This overload looks up the joint by name and is used for testing.
    */
   double compute_joint_torque(const std::string& joint_name,
                               const double feedforward_torque,
@@ -269,30 +479,147 @@ class BulletInterface : public Interface {
                               const double maximum_torque);
 
  private:
+  /*! Reproduce the moteus position controller in Bullet.
+   *
+   * \param[in] slot Index of the servo in per-joint vectors.
+   * \param[in] feedforward_torque Feedforward torque command in [N] * [m].
+   * \param[in] target_position Target angular position in [rad].
+   * \param[in] target_velocity Target angular velocity in [rad] / [s].
+   * \param[in] kp_scale Multiplicative factor applied to the proportional gain
+   *     in torque control.
+   * \param[in] kd_scale Multiplicative factor applied to the derivative gain
+   *     in torque control.
+   * \param[in] maximum_torque Maximum torque in [N] * [m] from the command.
+   */
+  double compute_joint_torque(const size_t slot,
+                              const double feedforward_torque,
+                              const double target_position,
+                              const double target_velocity,
+                              const double kp_scale, const double kd_scale,
+                              const double maximum_torque);
+
+  /*! Find the slot of a servo in per-joint vectors.
+   *
+   * \param[in] i Index of the servo command in the current cycle.
+   * \param[in] servo_id Servo identifier.
+   *
+   * \return Slot of the servo.
+   *
+   * \throw std::out_of_range if the servo is not in the layout.
+   *
+   * Slots follow the order of servo IDs in the layout, so that commands in
+   * the same order are matched without lookup.
+   */
+  size_t find_slot(size_t i, int servo_id) const {
+    if (i < servo_ids_.size() && servo_ids_[i] == servo_id) {
+      return i;
+    }
+    return servo_slot_.at(servo_id);
+  }
+
+  /*! Find the slot of a joint in per-joint vectors.
+   *
+   * \param[in] joint_name Name of the joint.
+   *
+   * \return Slot of the joint.
+   *
+   * \throw std::out_of_range if the joint is not in the servo layout.
+   */
+  size_t find_joint_slot(const std::string& joint_name) const;
+
   /*! Get index of a given robot link in Bullet
    *
    * \param[in] link_name Name of the searched link.
    *
    * \return Link index if found, -1 otherwise.
    *
-   * This is a memoization wrapper around \ref find_link_index, thus it has
-   * amortized O(log n) time complexity (that of std::map, where n is the
+   * Links are looked up in the joint table of the robot model, thus this
+   * function has O(log n) time complexity (that of std::map, where n is the
    * number of links).
    */
-  int get_link_index(const std::string& link_name);
+  int get_link_index(const std::string& link_name) const;
+
+  /*! Cast the rays of the height scan around the base.
+   *
+   * \throw std::runtime_error if the simulator did not return ray hits.
+   *
+   * All rays are cast vertically in a single batch, from a grid centered on
+   * the base and aligned with its yaw. Rays only hit static bodies, such as
+   * the floor and fixed-base environment URDFs, so that the robot does not
+   * occlude the scan.
+   */
+  void read_height_scan();
 
-  //! Read contact sensors from the simulator
+  /*! Read contact sensors from the simulator
+   *
+   * All contacts of the robot are read from a single query, then bucketed by
+   * link index to aggregate contact data of monitored links in one pass.
+   * Self-collisions are reported once by Bullet, thus credited to both links
+   * with opposite wrenches.
+   */
   void read_contacts();
 
-  //! Read joint sensors from the simulator
+  /*! Add a contact force to the contact data of a monitored link.
+   *
+   * \param[in] link_index Index of the link in Bullet, -1 for the base.
+   * \param[in] position Contact point in the world frame.
+   * \param[in] normal_force Normal force at the contact point, in [N].
+   * \param[in] force Contact force applied to the link, in the world frame.
+   */
+  void add_contact_force(int link_index, const Eigen::Vector3d& position,
+                         double normal_force, const Eigen::Vector3d& force);
+
+  /*! Read joint sensors from the simulator
+   *
+   * \throw std::runtime_error if the simulator did not return joint states.
+   *
+   * All joint states are read from a single state request.
+   */
   void read_joint_sensors();
 
   /*! Send commands to simulated joints
    *
    * \param data Buffer to read commands from.
+   *
+   * Motor commands are submitted in at most two batches, one per control
+   * mode, rather than one command per joint.
    */
   void send_commands(const moteus::Data& data);
 
+  /*! Recompute torques of joints in position mode from their commands.
+   *
+   * \param data Buffer to read commands from.
+   *
+   * This function is called at every physics substep after the first one.
+   * Bullet clears joint torques after each step, while velocity controllers
+   * of stopped joints remain active, so that only torques are submitted.
+   */
+  void update_joint_torques(const moteus::Data& data);
+
+  /*! Compute the joint torque of a position command.
+   *
+   * \param[in] slot Index of the servo in per-joint vectors.
+   * \param[in] command Position command of the servo.
+   *
+   * \return Joint torque in [N] * [m].
+   */
+  double compute_command_torque(const size_t slot,
+                                const moteus::ServoCommand& command);
+
+  /*! Submit motor commands for a batch of joints in a single command.
+   *
+   * \param[in] control_mode Either CONTROL_MODE_VELOCITY, where joints are
+   *     braked to zero velocity with the torques in \ref velocity_torques_,
+   *     or CONTROL_MODE_TORQUE, where joints apply the torques of their servo
+   *     replies.
+   * \param[in] slots Slots of the joints in the batch.
+   */
+  void submit_motor_commands(int control_mode,
+                             const std::vector<size_t>& slots);
+
+  //! Capture a snapshot of the robot for the simulated camera.
+  void capture_camera_snapshot();
+
   //! Convenience function to follow the base translation
   void translate_camera_to_robot();
 
@@ -300,20 +627,66 @@ class BulletInterface : public Interface {
   //! Interface parameters
   Parameters params_;
 
-  //! Map from actuated joint name to joint index in Bullet
-  std::map<std::string, int> joint_index_map_;
+  /*! Slot of each servo in the per-joint vectors below.
+   *
+   * Per-joint state is resolved once at construction, so that cycles index
+   * vectors rather than look up joint names.
+   */
+  std::unordered_map<int, size_t> servo_slot_;
+
+  //! Servo identifier at each slot.
+  std::vector<int> servo_ids_;
+
+  //! Name of the joint at each slot.
+  std::vector<std::string> joint_names_;
+
+  //! Joint index in Bullet at each slot, -1 if the joint is not in the URDF.
+  std::vector<int> joint_indices_;
+
+  //! Velocity index of each joint in Bullet, used by motor commands.
+  std::vector<int> joint_u_indices_;
+
+  //! Slots of joints in velocity control at the current step.
+  std::vector<size_t> velocity_slots_;
+
+  //! Maximum torque of the velocity controller at each slot, in [N m].
+  std::vector<double> velocity_torques_;
+
+  //! Slots of joints in torque control at the current step.
+  std::vector<size_t> torque_slots_;
+
+  //! Index in the cycle's commands of each joint in \ref torque_slots_.
+  std::vector<size_t> torque_command_indices_;
 
-  //! Simulated servo replies, laid out as a joint_name -> servo_reply map
-  std::map<std::string, moteus::ServoReply> servo_reply_;
+  //! Simulated servo reply at each slot.
+  std::vector<moteus::ServoReply> servo_replies_;
+
+  //! Servo replies at the beginning of the cycle, kept during substeps.
+  std::vector<moteus::ServoReply> cycle_replies_;
+
+  //! Map of servo replies returned by \ref servo_reply.
+  std::map<std::string, moteus::ServoReply> servo_reply_map_;
 
   //! Bullet client
   b3RobotSimulatorClientAPI bullet_;
 
+  //! Identifier of the world state saved after loading, -1 if none.
+  int snapshot_id_ = -1;
+
+  //! Number of solver iterations of the engine before any profile.
+  int default_solver_iterations_ = -1;
+
+  //! Random number generator for reset noise.
+  std::mt19937 rng_;
+
   //! Identifier of the robot model in the simulation
   int robot_;
 
-  //! Maximum joint torques read from the URDF model
-  std::map<std::string, BulletJointProperties> joint_properties_;
+  //! Joint properties at each slot, with maximum torques from the URDF.
+  std::vector<BulletJointProperties> joint_properties_;
+
+  //! Map of joint properties returned by \ref joint_properties.
+  std::map<std::string, BulletJointProperties> joint_properties_map_;
 
   //! Link index of the IMU in Bullet
   int imu_link_index_;
@@ -324,11 +697,46 @@ class BulletInterface : public Interface {
   //! Spatial linear velocity of the IMU link, used to compute its acceleration
   Eigen::Vector3d linear_velocity_imu_in_world_;
 
-  //! Map from link name to link index in Bullet
-  std::map<std::string, int> link_index_;
+  //! Joint and link tables of the robot model, shared by the process.
+  std::shared_ptr<const BulletJointTable> joint_table_;
+
+  /*! Contact bucket of each link, indexed by link index plus one.
+   *
+   * The base link has index -1 in Bullet, hence the offset. Links that are
+   * not monitored have no bucket (-1).
+   */
+  std::vector<int> contact_bucket_by_link_;
+
+  //! Contact bucket of each link in \ref Parameters::monitor_contacts.
+  std::vector<size_t> contact_buckets_;
+
+  //! Contact data of each bucket, i.e. of each distinct monitored link.
+  std::vector<BulletContactData> contact_data_;
+
+  //! Number of cycles since contacts were last read, modulo contact period.
+  unsigned contact_counter_ = 0;
+
+  /*! Terrain height below each ray of the height scan, in row-major order.
+   *
+   * Heights are relative to the base, and set to minus the ray depth for
+   * rays that hit nothing.
+   */
+  std::vector<double> height_scan_;
+
+  //! Start points of height scan rays, as consecutive 3D world positions.
+  std::vector<double> height_scan_from_;
+
+  //! End points of height scan rays, as consecutive 3D world positions.
+  std::vector<double> height_scan_to_;
+
+  //! Number of cycles since the last height scan, modulo scan period.
+  unsigned height_scan_counter_ = 0;
+
+  //! Joint angle at each slot in [rad], captured for the camera.
+  std::vector<double> camera_joint_angles_;
 
-  //! Map from link name to link contact data
-  std::map<std::string, BulletContactData> contact_data_;
+  //! Simulated camera, only created if enabled at construction.
+  std::unique_ptr<BulletCamera> camera_;
 };
 
 }  // namespace vulp::actuation
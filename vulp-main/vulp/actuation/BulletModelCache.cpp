@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "vulp/actuation/BulletModelCache.h"
+
+#include <mutex>
+#include <stdexcept>
+
+#include "tools/cpp/runfiles/runfiles.h"
+
+using bazel::tools::cpp::runfiles::Runfiles;
+
+namespace vulp::actuation {
+
+namespace {
+
+//! Mutex protecting the cached data below.
+std::mutex cache_mutex;
+
+//! Joint tables by URDF path.
+std::map<std::string, std::shared_ptr<const BulletJointTable>> joint_tables;
+
+//! Plane URDF paths by value of argv[0].
+std::map<std::string, std::string> plane_urdf_paths;
+
+/*! Read the joint and link tables of a robot model.
+ *
+ * \param[in] bullet Bullet client where the model is loaded.
+ * \param[in] robot Identifier of the robot model in the simulation.
+ */
+std::shared_ptr<const BulletJointTable> read_joint_table(
+    b3RobotSimulatorClientAPI& bullet, int robot) {
+  auto table = std::make_shared<BulletJointTable>();
+  b3JointInfo joint_info;
+  const int nb_joints = bullet.getNumJoints(robot);
+  for (int joint_index = 0; joint_index < nb_joints; ++joint_index) {
+    bullet.getJointInfo(robot, joint_index, &joint_info);
+    table->joint_index.try_emplace(joint_info.m_jointName, joint_index);
+    table->link_index.try_emplace(joint_info.m_linkName, joint_index);
+    table->u_index.push_back(joint_info.m_uIndex);
+    table->maximum_torque.push_back(joint_info.m_jointMaxForce);
+  }
+  return table;
+}
+
+}  // namespace
+
+std::shared_ptr<const BulletJointTable> BulletModelCache::joint_table(
+    b3RobotSimulatorClientAPI& bullet, int robot,
+    const std::string& urdf_path) {
+  const size_t nb_joints = static_cast<size_t>(bullet.getNumJoints(robot));
+  {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    const auto it = joint_tables.find(urdf_path);
+    if (it != joint_tables.end() && it->second->size() == nb_joints) {
+      return it->second;
+    }
+  }
+  auto table = read_joint_table(bullet, robot);
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  joint_tables[urdf_path] = table;
+  return table;
+}
+
+std::string BulletModelCache::plane_urdf_path(const std::string& argv0) {
+  {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    const auto it = plane_urdf_paths.find(argv0);
+    if (it != plane_urdf_paths.end()) {
+      return it->second;
+    }
+  }
+  std::string error;
+  std::unique_ptr<Runfiles> runfiles(Runfiles::Create(argv0, &error));
+  if (runfiles == nullptr) {
+    throw std::runtime_error(
+        "Could not retrieve the package path to plane.urdf: " + error);
+  }
+  const std::string path =
+      runfiles->Rlocation("vulp/vulp/actuation/bullet/plane/plane.urdf");
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  plane_urdf_paths[argv0] = path;
+  return path;
+}
+
+void BulletModelCache::clear() {
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  joint_tables.clear();
+  plane_urdf_paths.clear();
+}
+
+}  // namespace vulp::actuation
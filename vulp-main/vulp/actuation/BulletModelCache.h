@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "RobotSimulator/b3RobotSimulatorClientAPI.h"
+
+namespace vulp::actuation {
+
+//! Joint and link tables of a robot model loaded in Bullet.
+struct BulletJointTable {
+  //! Joint index by joint name.
+  std::map<std::string, int> joint_index;
+
+  //! Link index by link name (link and joint indices are the same in Bullet).
+  std::map<std::string, int> link_index;
+
+  //! Velocity index in Bullet of each joint, by joint index.
+  std::vector<int> u_index;
+
+  //! Maximum torque from the model of each joint, by joint index, in [N m].
+  std::vector<double> maximum_torque;
+
+  //! Number of joints of the model.
+  size_t size() const noexcept { return u_index.size(); }
+};
+
+/*! Per-process cache of model data used when creating Bullet interfaces.
+ *
+ * Bullet parses URDF files in each simulator, but data that only depends on
+ * the model or on the process can be shared by all simulators of a process:
+ * paths to runfiles and the joint and link tables of each robot model. Tests
+ * and parallel workers that create many simulators thus only pay for these
+ * once.
+ *
+ * Functions of this class are thread-safe.
+ */
+class BulletModelCache {
+ public:
+  /*! Get the joint and link tables of a robot model.
+   *
+   * \param[in] bullet Bullet client where the model is loaded.
+   * \param[in] robot Identifier of the robot model in the simulation.
+   * \param[in] urdf_path Path the model was loaded from, used as cache key.
+   *
+   * \return Joint and link tables of the model.
+   *
+   * Tables are read with getJointInfo the first time a model is seen, or if
+   * the number of joints of the loaded model differs from the cached one.
+   */
+  static std::shared_ptr<const BulletJointTable> joint_table(
+      b3RobotSimulatorClientAPI& bullet, int robot,
+      const std::string& urdf_path);
+
+  /*! Get the path to the plane URDF from Bazel runfiles.
+   *
+   * \param[in] argv0 Value of argv[0] used to locate runfiles.
+   *
+   * \return Path to the plane URDF.
+   *
+   * \throw std::runtime_error If runfiles cannot be found.
+   */
+  static std::string plane_urdf_path(const std::string& argv0);
+
+  //! Clear all cached data, for instance to measure cold starts.
+  static void clear();
+};
+
+}  // namespace vulp::actuation
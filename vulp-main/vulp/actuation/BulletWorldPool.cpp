@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "vulp/actuation/BulletWorldPool.h"
+
+#include <exception>
+#include <stdexcept>
+#include <string>
+
+namespace vulp::actuation {
+
+BulletWorldPool::BulletWorldPool(const ServoLayout& layout,
+                                 const BulletInterface::Parameters& params,
+                                 size_t nb_worlds) {
+  if (params.gui) {
+    throw std::invalid_argument("Worlds of a pool run without GUI");
+  }
+  if (nb_worlds < 1) {
+    throw std::invalid_argument("Pool needs at least one world");
+  }
+
+  worlds_.reserve(nb_worlds);
+  for (size_t index = 0; index < nb_worlds; ++index) {
+    worlds_.push_back(std::make_unique<BulletInterface>(layout, params));
+  }
+  outputs_.resize(nb_worlds);
+}
+
+void BulletWorldPool::step_all() {
+  run_tasks(
+      [this](size_t index) {
+        BulletInterface& world = *worlds_[index];
+        world.cycle(world.data(), [this, index](const moteus::Output& output) {
+          outputs_[index] = output;
+        });
+      },
+      worlds_.size());
+}
+
+void BulletWorldPool::reset_subset(const std::vector<size_t>& indices,
+                                   const Dictionary& config) {
+  std::vector<bool> is_reset(worlds_.size(), false);
+  for (const size_t index : indices) {
+    if (index >= worlds_.size()) {
+      throw std::out_of_range("World index " + std::to_string(index) +
+                              " is out of range");
+    }
+    if (is_reset[index]) {
+      throw std::invalid_argument("World index " + std::to_string(index) +
+                                  " appears more than once");
+    }
+    is_reset[index] = true;
+  }
+  run_tasks([&](size_t k) { worlds_[indices[k]]->reset(config); },
+            indices.size());
+}
+
+void BulletWorldPool::run_tasks(const std::function<void(size_t)>& task,
+                                size_t nb_tasks) {
+  std::exception_ptr error;
+  for (size_t k = 0; k < nb_tasks; ++k) {
+    try {
+      task(k);
+    } catch (...) {
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+}  // namespace vulp::actuation
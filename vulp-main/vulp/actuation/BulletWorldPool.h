@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <palimpsest/Dictionary.h>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "vulp/actuation/BulletInterface.h"
+#include "vulp/actuation/ServoLayout.h"
+#include "vulp/actuation/moteus/Output.h"
+
+namespace vulp::actuation {
+
+/*! Pool of independent Bullet worlds stepped in lockstep.
+ *
+ * Each world is a \ref BulletInterface with its own direct-mode simulator,
+ * servo commands and replies, so that rollouts from many simulated robots can
+ * be collected in a single process.
+ *
+ * Worlds are stepped one after the other on the calling thread. Bullet keeps
+ * process-wide state, such as its physics client plumbing and allocator
+ * statistics, that is not documented as thread-safe, so that in-process
+ * worlds are not stepped concurrently. Run several processes to use several
+ * cores.
+ */
+class BulletWorldPool {
+ public:
+  /*! Create worlds.
+   *
+   * \param[in] layout Servo layout of the robot in each world.
+   * \param[in] params Interface parameters of each world.
+   * \param[in] nb_worlds Number of worlds.
+   *
+   * \throw std::invalid_argument if the GUI is enabled, as worlds run in
+   *     direct mode, or if there are no worlds.
+   * \throw std::runtime_error If a simulator did not start properly.
+   */
+  BulletWorldPool(const ServoLayout& layout,
+                  const BulletInterface::Parameters& params, size_t nb_worlds);
+
+  //! No copy constructor.
+  BulletWorldPool(const BulletWorldPool&) = delete;
+
+  //! No copy assignment operator.
+  BulletWorldPool& operator=(const BulletWorldPool&) = delete;
+
+  //! Number of worlds.
+  size_t size() const noexcept { return worlds_.size(); }
+
+  /*! Get a world, for instance to write its commands or read its replies.
+   *
+   * \param[in] index Index of the world.
+   *
+   * \throw std::out_of_range if the index is not that of a world.
+   */
+  BulletInterface& world(size_t index) { return *worlds_.at(index); }
+
+  /*! Get the output of the last cycle of a world.
+   *
+   * \param[in] index Index of the world.
+   *
+   * \throw std::out_of_range if the index is not that of a world.
+   */
+  const moteus::Output& output(size_t index) const {
+    return outputs_.at(index);
+  }
+
+  /*! Spin a communication cycle in every world.
+   *
+   * Each world reads its own commands and writes its own replies, as in
+   * \ref BulletInterface::cycle.
+   *
+   * \throw std::runtime_error if a world failed to step. Other worlds still
+   *     step in this case.
+   */
+  void step_all();
+
+  /*! Reset a subset of worlds, for instance at the end of their episodes.
+   *
+   * \param[in] indices Indices of the worlds to reset.
+   * \param[in] config Configuration dictionary passed to each reset.
+   *
+   * \throw std::out_of_range if an index is not that of a world.
+   * \throw std::invalid_argument if an index appears more than once.
+   */
+  void reset_subset(const std::vector<size_t>& indices,
+                    const Dictionary& config);
+
+ private:
+  /*! Run a task on every index, even if some of them throw.
+   *
+   * \param[in] task Function called with the index of each task.
+   * \param[in] nb_tasks Number of tasks.
+   *
+   * \throw Rethrows the first exception thrown by a task, if any.
+   */
+  void run_tasks(const std::function<void(size_t)>& task, size_t nb_tasks);
+
+  //! Simulated worlds.
+  std::vector<std::unique_ptr<BulletInterface>> worlds_;
+
+  //! Output of the last cycle of each world.
+  std::vector<moteus::Output> outputs_;
+};
+
+}  // namespace vulp::actuation
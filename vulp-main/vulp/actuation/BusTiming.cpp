@@ -0,0 +1,197 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "vulp/actuation/BusTiming.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#include "vulp/actuation/moteus/protocol.h"
+
+namespace vulp::actuation {
+
+namespace {
+
+//! Valid data lengths of CAN-FD frames, in bytes.
+constexpr std::array<uint8_t, 16> kDataLengths = {0,  1,  2,  3,  4,  5,
+                                                  6,  7,  8,  12, 16, 20,
+                                                  24, 32, 48, 64};
+
+/*! Arbitration bits of an extended CAN-FD frame.
+ *
+ * SOF, base identifier (11), SRR, IDE, identifier extension (18), RRS, FDF,
+ * res and BRS.
+ */
+constexpr unsigned kArbitrationBits = 36;
+
+//! ACK slot, ACK delimiter, end of frame (7) and inter-frame space (3).
+constexpr unsigned kTrailerBits = 12;
+
+//! ESI and DLC bits at the beginning of the data phase.
+constexpr unsigned kControlBits = 5;
+
+//! Stuff count field, including its parity bit.
+constexpr unsigned kStuffCountBits = 4;
+
+//! Worst-case number of dynamic stuff bits for a sequence of bits.
+constexpr unsigned stuff_bits(unsigned nb_bits) {
+  return (nb_bits > 0) ? (nb_bits - 1) / 4 : 0;
+}
+
+}  // namespace
+
+uint8_t can_fd_data_length(size_t payload) {
+  for (const uint8_t length : kDataLengths) {
+    if (payload <= length) {
+      return length;
+    }
+  }
+  throw std::out_of_range("Payload of " + std::to_string(payload) +
+                          " bytes does not fit in a CAN-FD frame");
+}
+
+double can_fd_frame_duration(size_t payload, const CanBitrates& bitrates) {
+  const unsigned data_bytes = can_fd_data_length(payload);
+  const unsigned crc_bits = (data_bytes <= 16) ? 17 : 21;
+
+  // CRC fields have one fixed stuff bit every four bits, plus a delimiter
+  const unsigned nominal_bits = kArbitrationBits +
+                                stuff_bits(kArbitrationBits) + kTrailerBits;
+  const unsigned payload_bits = kControlBits + 8 * data_bytes;
+  const unsigned data_bits = payload_bits + stuff_bits(payload_bits) +
+                             kStuffCountBits + crc_bits + crc_bits / 4 + 1;
+
+  const double data_bitrate =
+      bitrates.bitrate_switch ? bitrates.data : bitrates.nominal;
+  return nominal_bits / bitrates.nominal + data_bits / data_bitrate;
+}
+
+std::vector<size_t> interleave_buses(const std::vector<int>& buses) {
+  std::map<int, std::vector<size_t>> bus_frames;
+  for (size_t i = 0; i < buses.size(); ++i) {
+    bus_frames[buses[i]].push_back(i);
+  }
+
+  // Buses with the most frames come first, ties broken by bus identifier
+  std::vector<const std::vector<size_t>*> queues;
+  for (const auto& bus_queue : bus_frames) {
+    queues.push_back(&bus_queue.second);
+  }
+  std::stable_sort(queues.begin(), queues.end(),
+                   [](const std::vector<size_t>* a,
+                      const std::vector<size_t>* b) {
+                     return a->size() > b->size();
+                   });
+
+  std::vector<size_t> order;
+  order.reserve(buses.size());
+  for (size_t rank = 0; order.size() < buses.size(); ++rank) {
+    for (const auto* queue : queues) {
+      if (rank < queue->size()) {
+        order.push_back((*queue)[rank]);
+      }
+    }
+  }
+  return order;
+}
+
+ServoFrameSizes compute_frame_sizes(
+    const moteus::PositionResolution& resolution,
+    const moteus::QueryCommand& query) {
+  ServoFrameSizes sizes;
+
+  moteus::CanFrame command_frame;
+  moteus::WriteCanFrame command_writer(&command_frame);
+  moteus::EmitPositionCommand(&command_writer, moteus::PositionCommand(),
+                              resolution);
+  moteus::EmitQueryCommand(&command_writer, query);
+  sizes.command_payload = command_frame.size;
+  sizes.command_length = can_fd_data_length(command_frame.size);
+
+  moteus::CanFrame reply_frame;
+  moteus::WriteCanFrame reply_writer(&reply_frame);
+  moteus::EmitQueryResult(&reply_writer, query, moteus::QueryResult());
+  sizes.reply_payload = reply_frame.size;
+  sizes.reply_length = can_fd_data_length(reply_frame.size);
+  return sizes;
+}
+
+BusTiming::BusTiming(const ServoLayout& layout,
+                     const moteus::PositionResolution& resolution,
+                     const moteus::QueryCommand& query,
+                     const std::map<int, CanBitrates>& bus_bitrates)
+    : frame_sizes_(compute_frame_sizes(resolution, query)) {
+  const bool expect_reply = query.any_set();
+  for (const auto& servo_bus : layout.servo_bus_map()) {
+    const int bus = servo_bus.second;
+    const auto it = bus_bitrates.find(bus);
+    const CanBitrates bitrates =
+        (it != bus_bitrates.end()) ? it->second : CanBitrates();
+
+    BusLoad& load = bus_loads_[bus];
+    load.nb_servos++;
+    load.tx_bytes += frame_sizes_.command_length;
+    load.duration +=
+        can_fd_frame_duration(frame_sizes_.command_payload, bitrates);
+    if (expect_reply) {
+      load.rx_bytes += frame_sizes_.reply_length;
+      load.duration +=
+          can_fd_frame_duration(frame_sizes_.reply_payload, bitrates);
+    }
+  }
+  double total_duration = 0.0;
+  for (const auto& bus_load : bus_loads_) {
+    const double duration = bus_load.second.duration;
+    if (duration > cycle_duration_) {
+      cycle_duration_ = duration;
+      busiest_bus_ = bus_load.first;
+    }
+    total_duration += duration;
+  }
+  // Buses without servos could take some of the load
+  size_t nb_buses = bus_loads_.size();
+  for (const auto& bus_bitrate : bus_bitrates) {
+    if (bus_loads_.find(bus_bitrate.first) == bus_loads_.end()) {
+      ++nb_buses;
+    }
+  }
+  if (nb_buses > 0) {
+    balanced_cycle_duration_ = total_duration / nb_buses;
+  }
+}
+
+double BusTiming::max_frequency() const noexcept {
+  if (cycle_duration_ <= 0.0) {
+    return std::numeric_limits<double>::infinity();
+  }
+  return 1.0 / cycle_duration_;
+}
+
+double BusTiming::imbalance() const noexcept {
+  if (balanced_cycle_duration_ <= 0.0) {
+    return 1.0;
+  }
+  return cycle_duration_ / balanced_cycle_duration_;
+}
+
+double decimated_cycle_duration(const BusTiming& full, const BusTiming& fast,
+                                unsigned period) {
+  if (period <= 1) {
+    return full.cycle_duration();
+  }
+  double cycle_duration = 0.0;
+  for (const auto& bus_load : full.bus_loads()) {
+    const auto it = fast.bus_loads().find(bus_load.first);
+    const double fast_duration =
+        (it != fast.bus_loads().end()) ? it->second.duration : 0.0;
+    const double duration =
+        fast_duration + (bus_load.second.duration - fast_duration) / period;
+    cycle_duration = std::max(cycle_duration, duration);
+  }
+  return cycle_duration;
+}
+
+}  // namespace vulp::actuation
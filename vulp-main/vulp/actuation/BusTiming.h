@@ -0,0 +1,201 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "vulp/actuation/ServoLayout.h"
+#include "vulp/actuation/moteus/PositionResolution.h"
+#include "vulp/actuation/moteus/QueryCommand.h"
+
+namespace vulp::actuation {
+
+//! Bitrates of a CAN-FD bus.
+struct CanBitrates {
+  //! Bitrate of the arbitration phase, in [bit] / [s].
+  double nominal = 1e6;
+
+  //! Bitrate of the data phase, in [bit] / [s].
+  double data = 5e6;
+
+  //! If true, the data phase is transmitted at the data bitrate.
+  bool bitrate_switch = true;
+};
+
+/*! Round a payload size up to the next valid CAN-FD data length.
+ *
+ * \param[in] payload Payload size in bytes, at most 64.
+ *
+ * \return Size of the frame data field, including padding, in bytes.
+ *
+ * \throw std::out_of_range if the payload does not fit in a CAN-FD frame.
+ */
+uint8_t can_fd_data_length(size_t payload);
+
+/*! Estimate the time a CAN-FD frame occupies the bus.
+ *
+ * \param[in] payload Payload size in bytes, before padding.
+ * \param[in] bitrates Bus bitrates.
+ *
+ * \return Frame duration in [s].
+ *
+ * The estimate assumes 29-bit identifiers, as used by the pi3hat to address
+ * moteus controllers, and counts the worst case of stuff bits, so that it is
+ * an upper bound on the time a frame spends on the bus.
+ */
+double can_fd_frame_duration(size_t payload, const CanBitrates& bitrates);
+
+//! Sizes of the frames exchanged with a servo at each cycle.
+struct ServoFrameSizes {
+  //! Payload of the command frame (position command and query), in bytes.
+  size_t command_payload = 0;
+
+  //! Data length of the command frame after CAN-FD padding, in bytes.
+  size_t command_length = 0;
+
+  //! Payload of the reply frame, in bytes.
+  size_t reply_payload = 0;
+
+  //! Data length of the reply frame after CAN-FD padding, in bytes.
+  size_t reply_length = 0;
+};
+
+/*! Compute the sizes of the frames exchanged with a servo.
+ *
+ * \param[in] resolution Resolution of position commands.
+ * \param[in] query Query sent along with commands.
+ *
+ * \return Frame sizes for a position command, which is the largest command.
+ */
+ServoFrameSizes compute_frame_sizes(
+    const moteus::PositionResolution& resolution,
+    const moteus::QueryCommand& query);
+
+/*! Order frames so that consecutive frames go to different buses.
+ *
+ * Frames reach the buses one after the other, so that a bus cannot start
+ * transmitting before its first frame has arrived. Taking frames from each
+ * bus in turn, starting from buses with the most frames, lets all buses
+ * transmit in parallel from the beginning of a cycle.
+ *
+ * \param[in] buses Bus of each frame, in their original order.
+ *
+ * \return Indices of frames in transmission order. Frames on the same bus
+ *     keep their original order.
+ */
+std::vector<size_t> interleave_buses(const std::vector<int>& buses);
+
+//! Bus load of a communication cycle.
+struct BusLoad {
+  //! Number of servos on the bus.
+  unsigned nb_servos = 0;
+
+  //! Bytes sent on the bus, including CAN-FD padding.
+  size_t tx_bytes = 0;
+
+  //! Bytes received from the bus, including CAN-FD padding.
+  size_t rx_bytes = 0;
+
+  //! Estimated bus time of a cycle, in [s].
+  double duration = 0.0;
+};
+
+/*! Estimate how many bytes and how much bus time a cycle costs.
+ *
+ * Each servo receives one command frame and sends back one reply frame per
+ * cycle. Buses transmit in parallel, so that the duration of a cycle is that
+ * of the busiest bus. Host-side overheads, such as SPI transfers to the
+ * pi3hat, are not modeled: the cycle duration is a lower bound on the cycle
+ * time measured by an interface.
+ */
+class BusTiming {
+ public:
+  /*! Compute bus loads for a servo layout.
+   *
+   * \param[in] layout Servo layout.
+   * \param[in] resolution Resolution of position commands.
+   * \param[in] query Query sent to all servos.
+   * \param[in] bus_bitrates Bitrates of each bus. Buses that are not in this
+   *     map use the default \ref CanBitrates. Buses in this map count as
+   *     available to balance the layout, even if they have no servo.
+   */
+  BusTiming(const ServoLayout& layout,
+            const moteus::PositionResolution& resolution,
+            const moteus::QueryCommand& query,
+            const std::map<int, CanBitrates>& bus_bitrates = {});
+
+  //! Frame sizes for each servo.
+  const ServoFrameSizes& frame_sizes() const noexcept { return frame_sizes_; }
+
+  //! Load of each bus, indexed by bus identifier.
+  const std::map<int, BusLoad>& bus_loads() const noexcept {
+    return bus_loads_;
+  }
+
+  //! Estimated duration of a communication cycle, in [s].
+  double cycle_duration() const noexcept { return cycle_duration_; }
+
+  //! Maximum cycle frequency the buses can sustain, in [Hz].
+  double max_frequency() const noexcept;
+
+  //! Identifier of the bus with the longest duration, zero if there is none.
+  int busiest_bus() const noexcept { return busiest_bus_; }
+
+  /*! Cycle duration if bus time was spread evenly over buses, in [s].
+   *
+   * This is a lower bound on the cycle duration that the same servos could
+   * achieve on the available buses, that is, buses of the layout or with
+   * known bitrates, if they were distributed differently.
+   */
+  double balanced_cycle_duration() const noexcept {
+    return balanced_cycle_duration_;
+  }
+
+  /*! Ratio between the cycle duration and its balanced duration.
+   *
+   * One when all buses are equally loaded. A ratio of two means the busiest
+   * bus makes cycles twice as long as they would be with a balanced layout.
+   */
+  double imbalance() const noexcept;
+
+ private:
+  //! Frame sizes for each servo.
+  ServoFrameSizes frame_sizes_;
+
+  //! Load of each bus, indexed by bus identifier.
+  std::map<int, BusLoad> bus_loads_;
+
+  //! Estimated duration of a communication cycle, in [s].
+  double cycle_duration_ = 0.0;
+
+  //! Identifier of the bus with the longest duration.
+  int busiest_bus_ = 0;
+
+  //! Cycle duration if bus time was spread evenly over buses, in [s].
+  double balanced_cycle_duration_ = 0.0;
+};
+
+/*! Estimate the average cycle duration when slow query fields are decimated.
+ *
+ * With a decimation period \f$N\f$, each servo is sent the full query once
+ * every \f$N\f$ cycles and the fast query otherwise, in a round-robin fashion
+ * across servos. On average over a period, a bus then spends its fast
+ * duration plus \f$1 / N\f$ of the extra time of full queries per cycle.
+ *
+ * \param[in] full Bus timing with the full query sent to all servos.
+ * \param[in] fast Bus timing of the same layout with the fast query.
+ * \param[in] period Decimation period. Zero or one disable decimation.
+ *
+ * \return Average duration of the busiest bus over a decimation period, in
+ *     [s]. Cycles where slow fields are due for all servos of a bus, such as
+ *     the first cycles, last up to \ref BusTiming::cycle_duration of the full
+ *     query.
+ */
+double decimated_cycle_duration(const BusTiming& full, const BusTiming& fast,
+                                unsigned period);
+
+}  // namespace vulp::actuation
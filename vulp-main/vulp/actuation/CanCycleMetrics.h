@@ -0,0 +1,340 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+namespace vulp::actuation {
+
+//! Summary of a window of samples, cheap to copy across threads.
+struct WindowSummary {
+  //! Latest sample, NaN if there is none.
+  double last = std::numeric_limits<double>::quiet_NaN();
+
+  //! Mean over the window, NaN if there are no samples.
+  double mean = std::numeric_limits<double>::quiet_NaN();
+
+  //! Maximum over the window, NaN if there are no samples.
+  double max = std::numeric_limits<double>::quiet_NaN();
+
+  //! Number of samples in the window.
+  unsigned count = 0;
+};
+
+/*! Statistics of a quantity over a sliding window of consecutive cycles.
+ *
+ * Statistics cover the latest samples, up to the size of the window, so that
+ * a spike is reported during exactly that many cycles after it happened. The
+ * mean is a running sum over a ring buffer of samples, recomputed from the
+ * buffer once per window to bound rounding errors. The maximum is the front
+ * of a monotonic queue of sample indices. Adding a sample takes amortized
+ * constant time, and memory is only allocated at construction.
+ */
+class WindowStatistics {
+ public:
+  /*! Initialize statistics.
+   *
+   * \param[in] window Number of samples in a window, at least one.
+   */
+  explicit WindowStatistics(unsigned window = 1000)
+      : samples_((window > 0) ? window : 1, 0.0),
+        max_queue_(samples_.size(), 0) {}
+
+  /*! Add a sample, removing the oldest one if the window is full.
+   *
+   * \param[in] value New sample.
+   */
+  void add(double value) noexcept {
+    const size_t window = samples_.size();
+    const size_t slot = nb_samples_ % window;
+    if (nb_samples_ >= window) {
+      sum_ -= samples_[slot];
+      if (max_front() + window == nb_samples_) {
+        max_begin_ = (max_begin_ + 1) % window;
+        --max_size_;
+      }
+    }
+    samples_[slot] = value;
+    sum_ += value;
+    last_ = value;
+
+    // Samples dominated by the new one can no longer be the maximum
+    while (max_size_ > 0 && samples_[max_back() % window] <= value) {
+      --max_size_;
+    }
+    max_queue_[(max_begin_ + max_size_) % window] = nb_samples_;
+    ++max_size_;
+    ++nb_samples_;
+    if (slot + 1 == window) {
+      sum_ = std::accumulate(samples_.begin(), samples_.end(), 0.0);
+    }
+  }
+
+  //! Latest sample, NaN if there is none.
+  double last() const noexcept { return last_; }
+
+  //! Mean over the window, NaN if there are no samples.
+  double mean() const noexcept {
+    return (count() > 0) ? sum_ / count()
+                         : std::numeric_limits<double>::quiet_NaN();
+  }
+
+  //! Maximum over the window, NaN if there are no samples.
+  double max() const noexcept {
+    return (count() > 0) ? samples_[max_front() % samples_.size()]
+                         : std::numeric_limits<double>::quiet_NaN();
+  }
+
+  //! Number of samples the mean and maximum are computed from.
+  unsigned count() const noexcept {
+    return static_cast<unsigned>(
+        std::min<uint64_t>(nb_samples_, samples_.size()));
+  }
+
+  //! Summary of the current window.
+  WindowSummary summary() const noexcept {
+    WindowSummary summary;
+    summary.last = last();
+    summary.mean = mean();
+    summary.max = max();
+    summary.count = count();
+    return summary;
+  }
+
+ private:
+  //! Index of the maximum sample in the window.
+  uint64_t max_front() const noexcept { return max_queue_[max_begin_]; }
+
+  //! Index of the latest sample in the queue.
+  uint64_t max_back() const noexcept {
+    return max_queue_[(max_begin_ + max_size_ - 1) % max_queue_.size()];
+  }
+
+  //! Ring buffer of samples, indexed by sample index modulo window size.
+  std::vector<double> samples_;
+
+  //! Circular storage of indices of samples with decreasing values.
+  std::vector<uint64_t> max_queue_;
+
+  //! Position of the first index, that of the maximum, in the queue.
+  size_t max_begin_ = 0;
+
+  //! Number of indices in the queue.
+  size_t max_size_ = 0;
+
+  //! Number of samples added so far.
+  uint64_t nb_samples_ = 0;
+
+  //! Sum of samples in the window.
+  double sum_ = 0.0;
+
+  //! Latest sample.
+  double last_ = std::numeric_limits<double>::quiet_NaN();
+};
+
+//! Counters of CAN communication cycles.
+struct CanCycleCounters {
+  //! Number of servo identifiers that fit in a CAN arbitration ID.
+  static constexpr int kNbServoIds = 128;
+
+  //! Start without missing replies.
+  CanCycleCounters() { missing_reply_streaks_.fill(0); }
+
+  /*! Number of consecutive cycles where a servo did not reply.
+   *
+   * \param[in] servo_id Servo identifier.
+   *
+   * \return Length of the current streak of missing replies, zero for
+   *     invalid identifiers.
+   */
+  uint32_t missing_reply_streak(int servo_id) const noexcept {
+    return is_valid(servo_id) ? missing_reply_streaks_[servo_id] : 0;
+  }
+
+  //! Number of completed cycles.
+  uint32_t nb_cycles = 0;
+
+  //! Number of cycles where the transport reported an error.
+  uint32_t nb_transport_errors = 0;
+
+  //! Number of cycles that waited for an attitude that did not come.
+  uint32_t nb_missing_attitudes = 0;
+
+  //! Number of cycles where at least one expected reply was missing.
+  uint32_t nb_incomplete_cycles = 0;
+
+  //! Total number of missing replies.
+  uint32_t nb_missing_replies = 0;
+
+  //! Longest streak of missing replies from any servo.
+  uint32_t max_missing_reply_streak = 0;
+
+  //! Number of frames transmitted at the last cycle.
+  uint32_t tx_frames = 0;
+
+  //! Number of frames received at the last cycle.
+  uint32_t rx_frames = 0;
+
+  //! Number of replies expected at the last cycle.
+  uint32_t expected_replies = 0;
+
+ protected:
+  //! Check whether a servo identifier fits in a CAN arbitration ID.
+  static constexpr bool is_valid(int servo_id) {
+    return 0 <= servo_id && servo_id < kNbServoIds;
+  }
+
+  //! Consecutive cycles where each servo did not reply.
+  std::array<uint32_t, kNbServoIds> missing_reply_streaks_;
+};
+
+/*! Metrics of CAN cycles at a given time, cheap to copy across threads.
+ *
+ * Window statistics are reduced to their summaries, so that copying a
+ * snapshot does not copy sample buffers.
+ */
+struct CanCycleSnapshot : public CanCycleCounters {
+  //! Wall time of transport cycles, in [s].
+  WindowSummary transport_duration;
+
+  //! Delay from cycle requests to the start of CAN cycles, in [s].
+  WindowSummary handoff_delay;
+
+  //! Time from the end of transport cycles to their callbacks, in [s].
+  WindowSummary callback_delay;
+};
+
+/*! Metrics of CAN communication cycles.
+ *
+ * Counts transport errors, missing attitudes and missing replies, tracks for
+ * each servo how many consecutive replies it missed, and keeps statistics of
+ * the durations and delays of each cycle. Together they help correlate
+ * hiccups of the control loop with bus problems.
+ *
+ * This class is not thread-safe: it is meant to be updated from the CAN
+ * thread only, and read through a \ref snapshot taken when the CAN thread is
+ * idle.
+ */
+class CanCycleMetrics : public CanCycleCounters {
+ public:
+  /*! Initialize metrics.
+   *
+   * \param[in] window Number of cycles in the sliding window of statistics.
+   */
+  explicit CanCycleMetrics(unsigned window = 1000)
+      : transport_duration(window),
+        handoff_delay(window),
+        callback_delay(window) {
+    expected_.fill(false);
+    received_.fill(false);
+  }
+
+  /*! Start a new cycle.
+   *
+   * \param[in] delay Time from the cycle request to the start of the cycle on
+   *     the CAN thread, in [s].
+   */
+  void start_cycle(double delay) noexcept {
+    handoff_delay.add(delay);
+    tx_frames = 0;
+    rx_frames = 0;
+    expected_replies = 0;
+    expected_.fill(false);
+    received_.fill(false);
+  }
+
+  /*! Count a transmitted frame.
+   *
+   * \param[in] servo_id Identifier of the destination servo.
+   * \param[in] expect_reply True if the servo should reply to this frame.
+   */
+  void send_frame(int servo_id, bool expect_reply) noexcept {
+    ++tx_frames;
+    if (expect_reply && is_valid(servo_id)) {
+      expected_[servo_id] = true;
+      ++expected_replies;
+    }
+  }
+
+  /*! Count a received reply.
+   *
+   * \param[in] servo_id Identifier of the servo that replied.
+   */
+  void receive_reply(int servo_id) noexcept {
+    ++rx_frames;
+    if (is_valid(servo_id)) {
+      received_[servo_id] = true;
+    }
+  }
+
+  /*! End the current cycle, once its replies have been received.
+   *
+   * \param[in] duration Wall time of the transport cycle, in [s].
+   * \param[in] transport_error True if the transport reported an error.
+   * \param[in] missing_attitude True if the cycle waited for an attitude
+   *     that did not come.
+   */
+  void end_cycle(double duration, bool transport_error,
+                 bool missing_attitude) noexcept {
+    ++nb_cycles;
+    transport_duration.add(duration);
+    nb_transport_errors += transport_error;
+    nb_missing_attitudes += missing_attitude;
+
+    uint32_t nb_missing = 0;
+    for (int servo_id = 0; servo_id < kNbServoIds; ++servo_id) {
+      uint32_t& streak = missing_reply_streaks_[servo_id];
+      if (received_[servo_id]) {
+        streak = 0;
+      } else if (expected_[servo_id]) {
+        ++streak;
+        ++nb_missing;
+        max_missing_reply_streak = std::max(max_missing_reply_streak, streak);
+      }
+    }
+    nb_missing_replies += nb_missing;
+    nb_incomplete_cycles += (nb_missing > 0);
+  }
+
+  /*! Record the delay from the end of a transport cycle to its callback.
+   *
+   * \param[in] delay Delay in [s], which covers decoding replies.
+   */
+  void record_callback_delay(double delay) noexcept {
+    callback_delay.add(delay);
+  }
+
+  //! Counters and summaries of window statistics.
+  CanCycleSnapshot snapshot() const noexcept {
+    CanCycleSnapshot snapshot;
+    static_cast<CanCycleCounters&>(snapshot) = *this;
+    snapshot.transport_duration = transport_duration.summary();
+    snapshot.handoff_delay = handoff_delay.summary();
+    snapshot.callback_delay = callback_delay.summary();
+    return snapshot;
+  }
+
+  //! Wall time of transport cycles, in [s].
+  WindowStatistics transport_duration;
+
+  //! Delay from cycle requests to the start of CAN cycles, in [s].
+  WindowStatistics handoff_delay;
+
+  //! Time from the end of transport cycles to their callbacks, in [s].
+  WindowStatistics callback_delay;
+
+ private:
+  //! Servos expected to reply at the current cycle.
+  std::array<bool, kNbServoIds> expected_;
+
+  //! Servos that replied at the current cycle.
+  std::array<bool, kNbServoIds> received_;
+};
+
+}  // namespace vulp::actuation
@@ -0,0 +1,125 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "vulp/actuation/moteus/Span.h"
+
+namespace vulp::actuation {
+
+/*! Transport of CAN-FD frames between the host and its servos.
+ *
+ * A transport executes communication cycles: it sends one batch of frames,
+ * collects replies, and optionally reads the attitude estimated by the IMU.
+ * The \ref Pi3HatInterface runs cycles from its CAN thread, so that the same
+ * threading, encoding and decoding code runs on the robot with the pi3hat,
+ * and on any host with an emulator.
+ *
+ * Types are laid out like their counterparts in the pi3hat library, without
+ * depending on it, so that transports can be built on hosts without the
+ * library.
+ */
+class CanTransport {
+ public:
+  //! CAN-FD frame.
+  struct Frame {
+    //! Arbitration identifier.
+    uint32_t id = 0;
+
+    //! Frame data.
+    uint8_t data[64] = {};
+
+    //! Size of the frame data in bytes.
+    uint8_t size = 0;
+
+    //! Bus the frame is sent or received on, starting from 1.
+    int bus = 0;
+
+    //! True if and only if the frame expects a reply.
+    bool expect_reply = false;
+  };
+
+  //! Attitude estimate from the IMU.
+  struct Attitude {
+    //! Unit quaternion.
+    struct Quaternion {
+      float w = 1.0f;
+      float x = 0.0f;
+      float y = 0.0f;
+      float z = 0.0f;
+    };
+
+    //! Three-dimensional vector.
+    struct Vector3 {
+      float x = 0.0f;
+      float y = 0.0f;
+      float z = 0.0f;
+    };
+
+    //! Orientation from the IMU frame to the world frame.
+    Quaternion attitude;
+
+    //! Angular velocity of the IMU in the IMU frame, in [deg] / [s].
+    Vector3 rate_dps;
+
+    //! Linear acceleration of the IMU in the IMU frame, in [m] / [s]².
+    Vector3 accel_mps2;
+  };
+
+  //! Input to a communication cycle.
+  struct Input {
+    //! Frames to send.
+    moteus::Span<Frame> tx_can;
+
+    //! Buffer to write received frames to.
+    moteus::Span<Frame> rx_can;
+
+    //! Attitude output, written if the cycle outputs an attitude.
+    Attitude* attitude = nullptr;
+
+    //! Request an attitude estimate from the IMU.
+    bool request_attitude = false;
+
+    //! Wait for a new attitude estimate if none is available yet.
+    bool wait_for_attitude = false;
+  };
+
+  //! Output of a communication cycle.
+  struct Output {
+    //! True if and only if the transport reported an error.
+    bool error = false;
+
+    //! Number of frames written to the receive buffer.
+    size_t rx_can_size = 0;
+
+    //! True if and only if a new attitude estimate was written.
+    bool attitude_present = false;
+  };
+
+  //! Virtual destructor so that derived destructors are called properly.
+  virtual ~CanTransport() = default;
+
+  /*! Run a communication cycle.
+   *
+   * \param[in] input Frames to send, receive buffer and attitude request.
+   *
+   * \return Number of received frames and attitude status.
+   *
+   * This function blocks until the cycle has completed.
+   */
+  virtual Output cycle(const Input& input) = 0;
+};
+
+/*! Function that creates a transport.
+ *
+ * Transports are created by the thread that runs their cycles, so that
+ * hardware resources are opened on that thread.
+ */
+using CanTransportFactory = std::function<std::unique_ptr<CanTransport>()>;
+
+}  // namespace vulp::actuation
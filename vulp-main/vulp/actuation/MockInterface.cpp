@@ -3,28 +3,74 @@
 
 #include "vulp/actuation/MockInterface.h"
 
+#include <utility>
+
 using std::chrono::duration_cast;
 using std::chrono::microseconds;
 
 namespace vulp::actuation {
 
 MockInterface::MockInterface(const ServoLayout& layout, const double dt)
-    : Interface(layout), dt_(dt) {
-  query_results_.clear();
-  for (const auto& id_bus : layout.servo_bus_map()) {
-    const auto& servo_id = id_bus.first;
-    moteus::QueryResult result;
-    result.d_current = std::numeric_limits<double>::quiet_NaN();
-    result.fault = 0;
-    result.q_current = std::numeric_limits<double>::quiet_NaN();
-    result.rezero_state = false;
-    result.temperature = std::numeric_limits<double>::quiet_NaN();
-    result.voltage = std::numeric_limits<double>::quiet_NaN();
-    query_results_.try_emplace(servo_id, result);
+    : MockInterface(layout, dt, Parameters()) {}
+
+MockInterface::MockInterface(const ServoLayout& layout, const double dt,
+                             const Parameters& params)
+    : Interface(layout), dt_(dt), params_(params), rng_(params.seed) {
+  check_parameters(params);
+  build_latency_histogram(params);
+  default_result_.d_current = std::numeric_limits<double>::quiet_NaN();
+  default_result_.fault = 0;
+  default_result_.q_current = std::numeric_limits<double>::quiet_NaN();
+  default_result_.rezero_state = false;
+  default_result_.temperature = std::numeric_limits<double>::quiet_NaN();
+  default_result_.voltage = std::numeric_limits<double>::quiet_NaN();
+
+  for (const auto& command : commands()) {
+    servo_index_[command.id] = static_cast<Eigen::Index>(servo_ids_.size());
+    servo_ids_.push_back(command.id);
   }
+  const Eigen::Index nb_servos = static_cast<Eigen::Index>(servo_ids_.size());
+  constexpr double kNaN = std::numeric_limits<double>::quiet_NaN();
+  modes_.assign(servo_ids_.size(), moteus::Mode::kStopped);
+  commanded_.setConstant(nb_servos, false);
+  active_.setZero(nb_servos);
+  target_position_.setConstant(nb_servos, kNaN);
+  target_velocity_.setConstant(nb_servos, kNaN);
+  feedforward_torque_.setZero(nb_servos);
+  kp_scale_.setOnes(nb_servos);
+  kd_scale_.setOnes(nb_servos);
+  maximum_torque_.setZero(nb_servos);
+  position_.setConstant(nb_servos, kNaN);
+  velocity_.setConstant(nb_servos, kNaN);
+  torque_.setConstant(nb_servos, kNaN);
+  start_thread_if_needed();
 }
 
-void MockInterface::reset(const Dictionary& config) {}
+MockInterface::~MockInterface() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    done_ = true;
+    cycle_condition_.notify_one();
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void MockInterface::reset(const Dictionary& config) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Parameters params = params_;
+    params.configure(config);
+    check_parameters(params);
+    build_latency_histogram(params);
+    params_ = std::move(params);
+    if (config.has("mock") && config("mock").has("seed")) {
+      rng_.seed(params_.seed);
+    }
+  }
+  start_thread_if_needed();
+}
 
 void MockInterface::observe(Dictionary& observation) const {
   // Eigen quaternions are serialized as [w, x, y, z]
@@ -40,29 +86,265 @@ void MockInterface::cycle(const moteus::Data& data,
                           std::function<void(const moteus::Output&)> callback) {
   assert(data.replies.size() == data.commands.size());
 
-  for (const auto& command : data.commands) {
-    const auto servo_id = command.id;
-    auto& result = query_results_[servo_id];
-    result.mode = command.mode;
-    const auto& target = command.position;
-    if (std::isnan(target.position) && !std::isnan(target.velocity) &&
-        !std::isnan(result.position)) {
-      result.position += target.velocity * dt_;
-    } else {
-      result.position = target.position;
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (ongoing_cycle_) {
+    throw std::logic_error(
+        "Cycle cannot be called before the previous one has completed.");
+  }
+  if (params_.latency_mode == LatencyMode::kSynchronous) {
+    const moteus::Output output = simulate(data, params_);
+    lock.unlock();
+    callback(output);
+    return;
+  }
+
+  data_ = data;
+  callback_ = std::move(callback);
+  request_time_ = std::chrono::steady_clock::now();
+  ongoing_cycle_ = true;
+  cycle_condition_.notify_one();
+}
+
+void MockInterface::check_parameters(const Parameters& params) {
+  if (params.latency < 0.0 || params.min_latency < 0.0 ||
+      params.min_latency > params.max_latency) {
+    throw std::invalid_argument(
+        "Latencies should be non-negative with min_latency <= max_latency");
+  }
+  if (params.drop_probability < 0.0 || params.drop_probability > 1.0 ||
+      params.truncate_probability < 0.0 || params.truncate_probability > 1.0) {
+    throw std::invalid_argument("Probabilities should be between 0 and 1");
+  }
+  if (params.time_constant <= 0.0 || params.inertia <= 0.0) {
+    throw std::invalid_argument(
+        "Servo time constant and inertia should be positive");
+  }
+  if (params.kp < 0.0 || params.kd < 0.0 || params.friction < 0.0) {
+    throw std::invalid_argument(
+        "Servo gains and friction should be non-negative");
+  }
+  if (params.latency_mode != LatencyMode::kHistogram) {
+    return;
+  }
+  if (params.histogram_counts.empty() ||
+      params.histogram_edges.size() != params.histogram_counts.size() + 1) {
+    throw std::invalid_argument(
+        "Latency histogram should have one more edge than it has bins");
+  }
+  if (params.histogram_edges.front() < 0.0) {
+    throw std::invalid_argument("Latency histogram has negative latencies");
+  }
+  for (size_t i = 1; i < params.histogram_edges.size(); ++i) {
+    if (params.histogram_edges[i] <= params.histogram_edges[i - 1]) {
+      throw std::invalid_argument(
+          "Latency histogram edges should be strictly increasing");
+    }
+  }
+  double total_count = 0.0;
+  for (const double count : params.histogram_counts) {
+    if (count < 0.0) {
+      throw std::invalid_argument("Latency histogram has negative counts");
+    }
+    total_count += count;
+  }
+  if (total_count <= 0.0) {
+    throw std::invalid_argument("Latency histogram has no samples");
+  }
+}
+
+void MockInterface::build_latency_histogram(const Parameters& params) {
+  if (params.time_constant <= 0.0 || params.inertia <= 0.0) {
+    throw std::invalid_argument(
+        "Servo time constant and inertia should be positive");
+  }
+  if (params.kp < 0.0 || params.kd < 0.0 || params.friction < 0.0) {
+    throw std::invalid_argument(
+        "Servo gains and friction should be non-negative");
+  }
+  if (params.latency_mode != LatencyMode::kHistogram) {
+    return;
+  }
+  latency_histogram_ = std::piecewise_constant_distribution<double>(
+      params.histogram_edges.begin(), params.histogram_edges.end(),
+      params.histogram_counts.begin());
+}
+
+void MockInterface::start_thread_if_needed() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (params_.latency_mode != LatencyMode::kSynchronous &&
+      !thread_.joinable()) {
+    thread_ = std::thread(&MockInterface::run_thread, this);
+  }
+}
+
+void MockInterface::run_thread() {
+  while (!done_) {
+    std::chrono::steady_clock::time_point deadline;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cycle_condition_.wait(lock,
+                            [this]() { return done_ || ongoing_cycle_; });
+      if (!ongoing_cycle_) {
+        return;  // done_ is set
+      }
+      deadline =
+          request_time_ + std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::duration<double>(
+                                  sample_latency(params_)));
+    }
+    std::this_thread::sleep_until(deadline);
+
+    moteus::Output output;
+    std::function<void(const moteus::Output&)> callback;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      output = simulate(data_, params_);
+      ongoing_cycle_ = false;
+      std::swap(callback, callback_);
+    }
+    callback(output);
+  }
+}
+
+double MockInterface::sample_latency(const Parameters& params) {
+  switch (params.latency_mode) {
+    case LatencyMode::kFixed: {
+      return params.latency;
+    }
+    case LatencyMode::kUniform: {
+      std::uniform_real_distribution<double> distribution(params.min_latency,
+                                                          params.max_latency);
+      return distribution(rng_);
+    }
+    case LatencyMode::kHistogram: {
+      return latency_histogram_(rng_);
+    }
+    default: {
+      return 0.0;
+    }
+  }
+}
+
+Eigen::Index MockInterface::find_servo(size_t i, int servo_id) const {
+  if (i < servo_ids_.size() && servo_ids_[i] == servo_id) {
+    return static_cast<Eigen::Index>(i);
+  }
+  const auto it = servo_index_.find(servo_id);
+  return (it != servo_index_.end()) ? it->second : -1;
+}
+
+void MockInterface::read_commands(
+    const moteus::Span<moteus::ServoCommand>& commands) {
+  commanded_.setConstant(false);
+  for (size_t i = 0; i < commands.size(); ++i) {
+    const auto& command = commands[i];
+    const Eigen::Index index = find_servo(i, command.id);
+    if (index < 0) {
+      continue;  // servo is not in the layout
     }
-    result.velocity = target.velocity;
-    result.torque = target.feedforward_torque;
+    commanded_[index] = true;
+    const auto& target = command.position;
+    modes_[index] = command.mode;
+    active_[index] = (command.mode == moteus::Mode::kStopped) ? 0.0 : 1.0;
+    target_position_[index] = target.position;
+    target_velocity_[index] = target.velocity;
+    feedforward_torque_[index] = target.feedforward_torque;
+    kp_scale_[index] = target.kp_scale;
+    kd_scale_[index] = target.kd_scale;
+    maximum_torque_[index] = target.maximum_torque;
+  }
+}
+
+void MockInterface::step_servos(const Parameters& params) {
+  // Servos that are not in the current commands keep their state, and NaN
+  // checks are written (x == x) so that they vectorize as comparisons
+  const auto& commanded = commanded_;
+  const auto& tp = target_position_;
+  const auto& tv = target_velocity_;
+  const auto has_position = (tp == tp);
+  const auto has_velocity = (tv == tv);
+  if (params.servo_model == ServoModel::kKinematic) {
+    position_ = commanded.select(
+        (!has_position && has_velocity && position_ == position_)
+            .select(position_ + tv * dt_, tp),
+        position_);
+    velocity_ = commanded.select(tv, velocity_);
+    torque_ = commanded.select(feedforward_torque_, torque_);
+    return;
+  }
+
+  // Dynamic models start from zero rather than unknown states
+  position_ = (position_ == position_ || !commanded).select(position_, 0.0);
+  velocity_ = (velocity_ == velocity_ || !commanded).select(velocity_, 0.0);
+  const auto target_velocity = has_velocity.select(tv, 0.0);
+  const auto position_error = has_position.select(tp - position_, 0.0);
+  const auto feedforward_torque =
+      (feedforward_torque_ == feedforward_torque_)
+          .select(feedforward_torque_, 0.0);
+  if (params.servo_model == ServoModel::kFirstOrder) {
+    velocity_ = commanded.select(
+        active_ * (target_velocity + position_error / params.time_constant),
+        velocity_);
+    position_ = commanded.select(position_ + velocity_ * dt_, position_);
+    torque_ = commanded.select(active_ * feedforward_torque, torque_);
+    return;
   }
 
+  const auto kp_scale = (kp_scale_ == kp_scale_).select(kp_scale_, 1.0);
+  const auto kd_scale = (kd_scale_ == kd_scale_).select(kd_scale_, 1.0);
+  const auto maximum_torque =
+      (maximum_torque_ == maximum_torque_)
+          .select(maximum_torque_.abs(),
+                  std::numeric_limits<double>::infinity());
+  torque_ = commanded.select(
+      active_ * (feedforward_torque + params.kp * kp_scale * position_error +
+                 params.kd * kd_scale * (target_velocity - velocity_))
+                    .min(maximum_torque)
+                    .max(-maximum_torque),
+      torque_);
+
+  // Semi-implicit Euler integration
+  velocity_ = commanded.select(
+      velocity_ +
+          (torque_ - params.friction * velocity_) / params.inertia * dt_,
+      velocity_);
+  position_ = commanded.select(position_ + velocity_ * dt_, position_);
+}
+
+moteus::Output MockInterface::simulate(const moteus::Data& data,
+                                       const Parameters& params) {
+  read_commands(data.commands);
+  step_servos(params);
+
+  // Dropped replies are skipped, as when servos fail to reply on the bus
   moteus::Output output;
+  std::bernoulli_distribution drop(params.drop_probability);
   for (size_t i = 0; i < data.replies.size(); ++i) {
+    if (params.drop_probability > 0.0 && drop(rng_)) {
+      continue;
+    }
     const auto servo_id = data.commands[i].id;
-    data.replies[i].id = servo_id;
-    data.replies[i].result = query_results_[servo_id];
-    output.query_result_size = i + 1;
+    auto& reply = data.replies[output.query_result_size++];
+    reply.id = servo_id;
+    reply.result = default_result_;
+    const Eigen::Index index = find_servo(i, servo_id);
+    if (index >= 0) {
+      reply.result.mode = modes_[index];
+      reply.result.position = position_[index];
+      reply.result.velocity = velocity_[index];
+      reply.result.torque = torque_[index];
+    }
+  }
+
+  // Truncated cycles keep a random number of their first replies
+  std::bernoulli_distribution truncate(params.truncate_probability);
+  if (params.truncate_probability > 0.0 && output.query_result_size > 0 &&
+      truncate(rng_)) {
+    std::uniform_int_distribution<size_t> size(0,
+                                               output.query_result_size - 1);
+    output.query_result_size = size(rng_);
   }
-  callback(output);
+  return output;
 }
 
 }  // namespace vulp::actuation
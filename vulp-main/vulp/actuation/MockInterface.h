@@ -6,27 +6,224 @@
 #include <palimpsest/Dictionary.h>
 #include <spdlog/spdlog.h>
 
+#include <Eigen/Core>
 #include <Eigen/Geometry>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <limits>
 #include <map>
+#include <mutex>
+#include <random>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "vulp/actuation/ImuData.h"
 #include "vulp/actuation/Interface.h"
 #include "vulp/actuation/moteus/protocol.h"
+#include "vulp/utils/get_unsigned.h"
 
 namespace vulp::actuation {
 
 class MockInterface : public Interface {
  public:
+  //! Distribution of the latency of communication cycles.
+  enum class LatencyMode {
+    //! Cycles complete synchronously, before \ref cycle returns.
+    kSynchronous,
+
+    //! Callbacks fire from a background thread after a fixed latency.
+    kFixed,
+
+    //! Latencies are sampled uniformly between a minimum and a maximum.
+    kUniform,
+
+    //! Latencies are sampled from a recorded histogram.
+    kHistogram
+  };
+
+  /*! Get the latency mode corresponding to a name.
+   *
+   * \param[in] name One of "synchronous", "fixed", "uniform" or "histogram".
+   *
+   * \return Latency mode.
+   *
+   * \throw std::invalid_argument if the name is not a latency mode.
+   */
+  static LatencyMode latency_mode_from_string(const std::string& name) {
+    if (name == "synchronous") {
+      return LatencyMode::kSynchronous;
+    } else if (name == "fixed") {
+      return LatencyMode::kFixed;
+    } else if (name == "uniform") {
+      return LatencyMode::kUniform;
+    } else if (name == "histogram") {
+      return LatencyMode::kHistogram;
+    }
+    throw std::invalid_argument("Unknown latency mode \"" + name + "\"");
+  }
+
+  //! Model of servo dynamics.
+  enum class ServoModel {
+    //! Servos reach their target position and velocity instantly.
+    kKinematic,
+
+    //! Positions converge to their targets with a time constant.
+    kFirstOrder,
+
+    //! PD controllers with torque limits drive rotors with inertia.
+    kSecondOrder
+  };
+
+  /*! Get the servo model corresponding to a name.
+   *
+   * \param[in] name One of "kinematic", "first_order" or "second_order".
+   *
+   * \return Servo model.
+   *
+   * \throw std::invalid_argument if the name is not a servo model.
+   */
+  static ServoModel servo_model_from_string(const std::string& name) {
+    if (name == "kinematic") {
+      return ServoModel::kKinematic;
+    } else if (name == "first_order") {
+      return ServoModel::kFirstOrder;
+    } else if (name == "second_order") {
+      return ServoModel::kSecondOrder;
+    }
+    throw std::invalid_argument("Unknown servo model \"" + name + "\"");
+  }
+
+  //! Interface parameters.
+  struct Parameters {
+    //! Keep default constructor.
+    Parameters() = default;
+
+    /*! Initialize from global configuration.
+     *
+     * \param[in] config Global configuration dictionary.
+     */
+    explicit Parameters(const Dictionary& config) { configure(config); }
+
+    /*! Configure from dictionary.
+     *
+     * \param[in] config Global configuration dictionary.
+     */
+    void configure(const Dictionary& config) {
+      if (!config.has("mock")) {
+        spdlog::debug("No \"mock\" runtime configuration");
+        return;
+      }
+      spdlog::info("Applying \"mock\" runtime configuration...");
+
+      const auto& mock = config("mock");
+      if (mock.has("latency_mode")) {
+        latency_mode = latency_mode_from_string(
+            mock.get<std::string>("latency_mode"));
+      }
+      latency = mock.get<double>("latency", latency);
+      min_latency = mock.get<double>("min_latency", min_latency);
+      max_latency = mock.get<double>("max_latency", max_latency);
+      if (mock.has("histogram_edges")) {
+        histogram_edges = mock("histogram_edges").as<std::vector<double>>();
+      }
+      if (mock.has("histogram_counts")) {
+        histogram_counts = mock("histogram_counts").as<std::vector<double>>();
+      }
+      drop_probability = mock.get<double>("drop_probability", drop_probability);
+      truncate_probability =
+          mock.get<double>("truncate_probability", truncate_probability);
+      seed = utils::get_unsigned(mock, "seed", seed);
+      if (mock.has("servo_model")) {
+        servo_model =
+            servo_model_from_string(mock.get<std::string>("servo_model"));
+      }
+      time_constant = mock.get<double>("time_constant", time_constant);
+      kp = mock.get<double>("kp", kp);
+      kd = mock.get<double>("kd", kd);
+      inertia = mock.get<double>("inertia", inertia);
+      friction = mock.get<double>("friction", friction);
+    }
+
+    //! Latency mode.
+    LatencyMode latency_mode = LatencyMode::kSynchronous;
+
+    //! Latency of each cycle in [s], in fixed mode.
+    double latency = 0.0;
+
+    //! Minimum latency of a cycle in [s], in uniform mode.
+    double min_latency = 0.0;
+
+    //! Maximum latency of a cycle in [s], in uniform mode.
+    double max_latency = 0.0;
+
+    /*! Bin edges of the latency histogram in [s], in histogram mode.
+     *
+     * Latencies are sampled from bins with probabilities proportional to
+     * their counts, then uniformly within their bin, so that a histogram of
+     * measured cycle durations can be replayed.
+     */
+    std::vector<double> histogram_edges;
+
+    //! Number of samples in each bin, one fewer than bin edges.
+    std::vector<double> histogram_counts;
+
+    //! Probability that each servo reply is dropped.
+    double drop_probability = 0.0;
+
+    //! Probability that the replies of a cycle are truncated.
+    double truncate_probability = 0.0;
+
+    /*! Seed of the random number generator.
+     *
+     * The generator is seeded at construction, and re-seeded by resets whose
+     * configuration sets the seed.
+     */
+    unsigned seed = 0;
+
+    //! Model of servo dynamics.
+    ServoModel servo_model = ServoModel::kKinematic;
+
+    //! Time constant of the first-order model, in [s].
+    double time_constant = 0.01;
+
+    //! Position gain of the second-order model, in [N m] / [rev].
+    double kp = 10.0;
+
+    //! Velocity gain of the second-order model, in [N m] / ([rev] / [s]).
+    double kd = 0.5;
+
+    //! Rotor inertia of the second-order model, in [N m] / ([rev] / [s]²).
+    double inertia = 0.05;
+
+    //! Viscous friction of the second-order model, in [N m] / ([rev] / [s]).
+    double friction = 0.01;
+  };
+
+  /*! Create mock actuator interface with synchronous cycles.
+   *
+   * \param[in] layout Servo layout.
+   * \param[in] dt Spine timestep in [s].
+   */
+  MockInterface(const ServoLayout& layout, const double dt);
+
   /*! Create mock actuator interface.
    *
+   * \param[in] layout Servo layout.
+   * \param[in] dt Spine timestep in [s].
    * \param[in] params Interface parameters.
+   *
+   * \throw std::invalid_argument if parameters are invalid.
    */
-  MockInterface(const ServoLayout& layout, const double dt);
+  MockInterface(const ServoLayout& layout, const double dt,
+                const Parameters& params);
 
-  //! Default destructor
-  ~MockInterface() = default;
+  //! Stop background thread, if any.
+  ~MockInterface();
 
   /*! Reset interface.
    *
@@ -48,19 +245,167 @@ class MockInterface : public Interface {
    * The callback will be invoked from an arbitrary thread when the
    * communication cycle has completed. All memory pointed to by @p data must
    * remain valid until the callback is invoked.
+   *
+   * In synchronous mode, the callback is invoked before this function
+   * returns. In other modes, it is invoked from a background thread once the
+   * latency of the cycle has elapsed since this function was called.
    */
   void cycle(const moteus::Data& data,
              std::function<void(const moteus::Output&)> callback) final;
 
  private:
+  /*! Validate parameters.
+   *
+   * \param[in] params Interface parameters.
+   *
+   * \throw std::invalid_argument if latencies are negative, probabilities
+   *     are not in [0, 1], the servo time constant or inertia is not
+   *     positive, servo gains or friction are negative, or the latency
+   *     histogram is ill-formed: edges not strictly increasing, or counts
+   *     negative or all zero.
+   */
+  static void check_parameters(const Parameters& params);
+
+  /*! Build the distribution of latencies, in histogram mode.
+   *
+   * \param[in] params Validated interface parameters.
+   */
+  void build_latency_histogram(const Parameters& params);
+
+  //! Start the background thread if the latency mode requires it.
+  void start_thread_if_needed();
+
+  //! Main loop of the background thread.
+  void run_thread();
+
+  /*! Sample the latency of a cycle.
+   *
+   * \param[in] params Interface parameters.
+   *
+   * \return Latency in [s].
+   */
+  double sample_latency(const Parameters& params);
+
+  /*! Find the index of a servo in flat arrays.
+   *
+   * \param[in] i Index of the servo command in the current cycle.
+   * \param[in] servo_id Servo identifier.
+   *
+   * \return Index of the servo, or -1 if the servo is not in the layout.
+   */
+  Eigen::Index find_servo(size_t i, int servo_id) const;
+
+  /*! Copy servo commands to the flat arrays of targets.
+   *
+   * \param[in] commands Servo commands.
+   */
+  void read_commands(const moteus::Span<moteus::ServoCommand>& commands);
+
+  /*! Step servo dynamics for one timestep.
+   *
+   * \param[in] params Interface parameters.
+   *
+   * Only servos in the commands of the current cycle are stepped, the others
+   * keeping their state, as servos do when they receive no CAN frame.
+   */
+  void step_servos(const Parameters& params);
+
+  /*! Apply commands and write replies, dropping some of them.
+   *
+   * \param[in] data Buffer to read commands from and write replies to.
+   * \param[in] params Interface parameters.
+   *
+   * \return Output of the cycle.
+   */
+  moteus::Output simulate(const moteus::Data& data, const Parameters& params);
+
   //! Spine timestep in [s].
   const double dt_;
 
-  //! Mock servo replies, laid out as a servo_id -> query_result map
-  std::map<int, moteus::QueryResult> query_results_;
+  //! Interface parameters, protected by \ref mutex_.
+  Parameters params_;
+
+  /*! Index of each servo in the flat arrays below.
+   *
+   * Servos are indexed in the order of \ref commands, so that this map is
+   * only used for commands in a different order.
+   */
+  std::unordered_map<int, Eigen::Index> servo_index_;
+
+  //! Servo identifier at each index.
+  std::vector<int> servo_ids_;
+
+  //! Reply fields that are not simulated.
+  moteus::QueryResult default_result_;
+
+  //! Latest mode of each servo.
+  std::vector<moteus::Mode> modes_;
+
+  //! True for servos in the commands of the current cycle.
+  Eigen::Array<bool, Eigen::Dynamic, 1> commanded_;
+
+  //! One for servos in position mode, zero for stopped servos.
+  Eigen::ArrayXd active_;
+
+  //! Target position of each servo in [rev], NaN if there is none.
+  Eigen::ArrayXd target_position_;
+
+  //! Target velocity of each servo in [rev] / [s], NaN if there is none.
+  Eigen::ArrayXd target_velocity_;
+
+  //! Feedforward torque of each servo in [N m].
+  Eigen::ArrayXd feedforward_torque_;
+
+  //! Scaling of the position gain of each servo.
+  Eigen::ArrayXd kp_scale_;
+
+  //! Scaling of the velocity gain of each servo.
+  Eigen::ArrayXd kd_scale_;
+
+  //! Maximum torque of each servo in [N m].
+  Eigen::ArrayXd maximum_torque_;
+
+  //! Position of each servo in [rev].
+  Eigen::ArrayXd position_;
+
+  //! Velocity of each servo in [rev] / [s].
+  Eigen::ArrayXd velocity_;
+
+  //! Torque of each servo in [N m].
+  Eigen::ArrayXd torque_;
 
   //! Mock IMU data
   ImuData imu_data_;
+
+  //! Random number generator for latencies and reply faults.
+  std::mt19937 rng_;
+
+  //! Distribution of latencies, built at reset in histogram mode.
+  std::piecewise_constant_distribution<double> latency_histogram_;
+
+  //! Mutex protecting parameters and the pending cycle.
+  std::mutex mutex_;
+
+  //! Condition variable to notify the background thread of a new cycle.
+  std::condition_variable cycle_condition_;
+
+  //! True if and only if a cycle is pending in the background thread.
+  bool ongoing_cycle_ = false;
+
+  //! Background thread exits when it is notified and this boolean is true.
+  std::atomic<bool> done_ = false;
+
+  //! Buffer of the pending cycle.
+  moteus::Data data_;
+
+  //! Callback of the pending cycle.
+  std::function<void(const moteus::Output&)> callback_;
+
+  //! Time when the pending cycle was requested.
+  std::chrono::steady_clock::time_point request_time_;
+
+  //! Background thread for cycles that complete after a latency.
+  std::thread thread_;
 };
 
 }  // namespace vulp::actuation
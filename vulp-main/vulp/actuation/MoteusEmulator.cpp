@@ -0,0 +1,198 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "vulp/actuation/MoteusEmulator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "vulp/actuation/moteus/command_parser.h"
+#include "vulp/actuation/moteus/protocol.h"
+
+namespace vulp::actuation {
+
+namespace {
+
+//! Standard gravity, in [m] / [s]².
+constexpr double kGravity = 9.81;
+
+/*! Get the value of a command register, or a default value.
+ *
+ * \param[in] value Decoded register value.
+ * \param[in] res Resolution of the register in the command frame.
+ * \param[in] default_value Value used when the register is absent or NaN.
+ *
+ * \return Register value.
+ */
+double value_or(double value, moteus::Resolution res, double default_value) {
+  if (res == moteus::Resolution::kIgnore || std::isnan(value)) {
+    return default_value;
+  }
+  return value;
+}
+
+}  // namespace
+
+MoteusEmulator::MoteusEmulator(const Parameters& params)
+    : params_(params), start_time_(std::chrono::steady_clock::now()) {
+  for (auto& servo : servos_) {
+    servo.mode = moteus::Mode::kStopped;
+    servo.position = 0.0;
+    servo.velocity = 0.0;
+    servo.torque = 0.0;
+    servo.q_current = 0.0;
+    servo.d_current = 0.0;
+    servo.voltage = params.voltage;
+    servo.temperature = params.temperature;
+  }
+}
+
+const moteus::QueryResult& MoteusEmulator::servo(int servo_id) const {
+  if (servo_id < 0 || servo_id >= kNbServoIds) {
+    throw std::out_of_range("Invalid servo ID: " + std::to_string(servo_id));
+  }
+  return servos_[servo_id];
+}
+
+double MoteusEmulator::time() const noexcept {
+  if (!params_.real_time) {
+    return simulated_time_;
+  }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start_time_)
+      .count();
+}
+
+CanTransport::Output MoteusEmulator::cycle(const Input& input) {
+  const double cycle_start = time();
+  for (auto& bus_end_time : bus_end_times_) {
+    bus_end_time.second = 0.0;
+  }
+
+  Output output;
+  double tx_time = 0.0;  // relative to the start of the cycle
+  for (const Frame& tx_frame : input.tx_can) {
+    const auto it = params_.bus_bitrates.find(tx_frame.bus);
+    const CanBitrates bitrates =
+        (it != params_.bus_bitrates.end()) ? it->second : CanBitrates();
+    tx_time += params_.tx_frame_latency;
+    double& bus_time = bus_end_times_[tx_frame.bus];
+    bus_time = std::max(bus_time, tx_time) +
+               can_fd_frame_duration(tx_frame.size, bitrates);
+
+    // Destination is in the low byte of the arbitration ID
+    const int servo_id = static_cast<int>(tx_frame.id & 0x7f);
+    moteus::QueryResult& state = servos_[servo_id];
+    const moteus::ServoCommand command =
+        moteus::ParseServoCommand(tx_frame.data, tx_frame.size);
+    step_servo(command, state);
+
+    if (!tx_frame.expect_reply || !command.query.any_set() ||
+        params_.silent_servos.count(servo_id) > 0 ||
+        output.rx_can_size >= input.rx_can.size()) {
+      continue;
+    }
+    Frame& rx_frame = input.rx_can[output.rx_can_size++];
+    rx_frame.id = static_cast<uint32_t>(servo_id << 8);
+    rx_frame.bus = tx_frame.bus;
+    rx_frame.expect_reply = false;
+    rx_frame.size = 0;
+    moteus::WriteCanFrame writer(rx_frame.data, &rx_frame.size);
+    moteus::EmitQueryResult(&writer, command.query, state);
+    bus_time += can_fd_frame_duration(rx_frame.size, bitrates);
+
+    // Servos pad their replies to a valid CAN-FD length with no-ops
+    const uint8_t length = can_fd_data_length(rx_frame.size);
+    while (rx_frame.size < length) {
+      writer.Write<int8_t>(moteus::Multiplex::kNop);
+    }
+  }
+
+  // Buses transmit in parallel
+  double bus_time = 0.0;
+  for (const auto& bus_end_time : bus_end_times_) {
+    if (bus_end_time.second <= 0.0) {
+      continue;  // bus unused at this cycle
+    }
+    const auto it = params_.bus_latency.find(bus_end_time.first);
+    const double latency =
+        (it != params_.bus_latency.end()) ? it->second : 0.0;
+    bus_time = std::max(bus_time, bus_end_time.second + latency);
+  }
+  double cycle_end = cycle_start + params_.cycle_latency + bus_time;
+  cycle_end = read_attitude(input, cycle_end, output);
+
+  last_cycle_duration_ = cycle_end - cycle_start;
+  if (params_.real_time) {
+    std::this_thread::sleep_until(
+        start_time_ + std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::duration<double>(cycle_end)));
+  } else {
+    simulated_time_ = cycle_end;
+  }
+  return output;
+}
+
+void MoteusEmulator::step_servo(const moteus::ServoCommand& command,
+                                moteus::QueryResult& state) const {
+  using moteus::Resolution;
+  double torque = 0.0;
+  if (command.mode == moteus::Mode::kPosition) {
+    const auto& target = command.position;
+    const auto& res = command.resolution;
+    const double position = value_or(target.position, res.position,
+                                     std::numeric_limits<double>::quiet_NaN());
+    const double velocity = value_or(target.velocity, res.velocity, 0.0);
+    const double kp_scale = value_or(target.kp_scale, res.kp_scale, 1.0);
+    const double kd_scale = value_or(target.kd_scale, res.kd_scale, 1.0);
+    torque = value_or(target.feedforward_torque, res.feedforward_torque, 0.0);
+    if (!std::isnan(position)) {  // NaN position: velocity control only
+      torque += params_.kp * kp_scale * (position - state.position);
+    }
+    torque += params_.kd * kd_scale * (velocity - state.velocity);
+    const double maximum_torque =
+        std::fabs(value_or(target.maximum_torque, res.maximum_torque,
+                           std::numeric_limits<double>::infinity()));
+    torque = std::clamp(torque, -maximum_torque, maximum_torque);
+    state.mode = moteus::Mode::kPosition;
+  } else {
+    state.mode = moteus::Mode::kStopped;
+  }
+
+  // Semi-implicit Euler integration
+  const double acceleration =
+      (torque - params_.friction * state.velocity) / params_.inertia;
+  state.velocity += acceleration * params_.dt;
+  state.position += state.velocity * params_.dt;
+  state.torque = torque;
+}
+
+double MoteusEmulator::read_attitude(const Input& input, double cycle_end,
+                                     Output& output) {
+  if (!input.request_attitude || input.attitude == nullptr ||
+      params_.attitude_rate <= 0.0) {
+    return cycle_end;
+  }
+
+  // The IMU produces estimates at regular times since the emulator started
+  long index = static_cast<long>(std::floor(cycle_end * params_.attitude_rate));
+  if (index <= last_attitude_index_) {
+    if (!input.wait_for_attitude) {
+      return cycle_end;  // no new estimate yet
+    }
+    index = last_attitude_index_ + 1;
+    cycle_end = index / params_.attitude_rate;
+  }
+  last_attitude_index_ = index;
+
+  *input.attitude = Attitude();
+  input.attitude->accel_mps2.z = static_cast<float>(kGravity);
+  output.attitude_present = true;
+  return cycle_end;
+}
+
+}  // namespace vulp::actuation
@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <map>
+#include <set>
+
+#include "vulp/actuation/BusTiming.h"
+#include "vulp/actuation/CanTransport.h"
+#include "vulp/actuation/moteus/Mode.h"
+#include "vulp/actuation/moteus/QueryResult.h"
+#include "vulp/actuation/moteus/ServoCommand.h"
+
+namespace vulp::actuation {
+
+/*! Transport that emulates moteus controllers and the pi3hat IMU.
+ *
+ * Each command frame is decoded the way a moteus controller would decode it.
+ * The emulated servo then applies its position command to a rotor with
+ * inertia and viscous friction for one time step, and replies to the query
+ * of the frame with a correctly encoded reply frame. Servos are addressed by
+ * their identifier only, so that any servo layout can be emulated.
+ *
+ * The duration of a cycle is modeled after the frames actually sent and
+ * received on each bus, as in \ref BusTiming, plus configurable latencies.
+ * Frames are handed over to buses in transmission order, so that the order
+ * of frames affects how long buses wait for their first frame.
+ * Cycles last that long in real time, or advance a simulated clock when real
+ * time is disabled, for instance in unit tests.
+ *
+ * Positions are in revolutions and torques in [N m], as in moteus registers.
+ */
+class MoteusEmulator : public CanTransport {
+ public:
+  //! Number of servo identifiers that fit in a CAN arbitration ID.
+  static constexpr int kNbServoIds = 128;
+
+  //! Emulator parameters.
+  struct Parameters {
+    /*! Bitrates of each bus, indexed by bus identifier.
+     *
+     * Buses that are not in this map use the default \ref CanBitrates.
+     */
+    std::map<int, CanBitrates> bus_bitrates;
+
+    //! Additional transfer latency of each bus per cycle, in [s].
+    std::map<int, double> bus_latency;
+
+    //! Host-side latency of each cycle, such as SPI transfers, in [s].
+    double cycle_latency = 0.0;
+
+    /*! Time to hand each transmitted frame over to its bus, in [s].
+     *
+     * Frames reach their buses one after the other, as over the SPI link of
+     * the pi3hat, so that a bus waits for its frames when they come late in
+     * the transmission order.
+     */
+    double tx_frame_latency = 0.0;
+
+    //! Frequency of attitude estimates from the IMU, in [Hz].
+    double attitude_rate = 1000.0;
+
+    /*! Wait for the modeled duration of each cycle.
+     *
+     * When false, cycles return immediately and advance a simulated clock by
+     * their modeled duration.
+     */
+    bool real_time = true;
+
+    //! Time step of the servo dynamics at each cycle, in [s].
+    double dt = 1e-3;
+
+    //! Position gain of servo controllers, in [N m] / [rev].
+    double kp = 10.0;
+
+    //! Velocity gain of servo controllers, in [N m] / ([rev] / [s]).
+    double kd = 0.5;
+
+    //! Inertia of each rotor, in [N m] / ([rev] / [s]²).
+    double inertia = 0.05;
+
+    //! Viscous friction of each rotor, in [N m] / ([rev] / [s]).
+    double friction = 0.01;
+
+    //! Servos that never reply, for instance to emulate a loose connector.
+    std::set<int> silent_servos;
+
+    //! Voltage reported by servos, in [V].
+    double voltage = 24.0;
+
+    //! Temperature reported by servos, in [°C].
+    double temperature = 30.0;
+  };
+
+  /*! Initialize emulator with all servos stopped at zero.
+   *
+   * \param[in] params Emulator parameters.
+   */
+  explicit MoteusEmulator(const Parameters& params);
+
+  /*! Run a communication cycle.
+   *
+   * \param[in] input Frames to send, receive buffer and attitude request.
+   *
+   * \return Number of received frames and attitude status.
+   */
+  Output cycle(const Input& input) override;
+
+  /*! Get the state of an emulated servo.
+   *
+   * \param[in] servo_id Servo identifier.
+   *
+   * \return Latest register values of the servo.
+   *
+   * \throw std::out_of_range if the identifier is not a valid servo ID.
+   */
+  const moteus::QueryResult& servo(int servo_id) const;
+
+  //! Modeled duration of the last cycle, in [s].
+  double last_cycle_duration() const noexcept { return last_cycle_duration_; }
+
+  //! Time since the emulator was created, in [s].
+  double time() const noexcept;
+
+ private:
+  /*! Apply a command to a servo for one time step.
+   *
+   * \param[in] command Command decoded from a frame.
+   * \param[in, out] state Register values of the servo.
+   */
+  void step_servo(const moteus::ServoCommand& command,
+                  moteus::QueryResult& state) const;
+
+  /*! Handle an attitude request.
+   *
+   * \param[in] input Cycle input.
+   * \param[in] cycle_end Time when the cycle ends without attitude, in [s].
+   * \param[out] output Cycle output, where the attitude status is set.
+   *
+   * \return Time when the cycle ends, in [s], later than \p cycle_end if the
+   *     cycle waits for a new attitude estimate.
+   */
+  double read_attitude(const Input& input, double cycle_end, Output& output);
+
+  //! Emulator parameters.
+  const Parameters params_;
+
+  //! Time when the emulator was created.
+  const std::chrono::steady_clock::time_point start_time_;
+
+  //! Simulated time in [s], used when real time is disabled.
+  double simulated_time_ = 0.0;
+
+  //! Register values of each servo, indexed by servo identifier.
+  std::array<moteus::QueryResult, kNbServoIds> servos_;
+
+  //! Time when each bus finishes its frames in the current cycle, in [s].
+  std::map<int, double> bus_end_times_;
+
+  //! Index of the last attitude estimate read, -1 if none was read.
+  long last_attitude_index_ = -1;
+
+  //! Modeled duration of the last cycle, in [s].
+  double last_cycle_duration_ = 0.0;
+};
+
+}  // namespace vulp::actuation
@@ -10,14 +10,111 @@
 
 #include "vulp/actuation/Pi3HatInterface.h"
 
+#include <chrono>
+#include <limits>
+#include <map>
+
 namespace vulp::actuation {
 
+namespace {
+
+//! Encoder specialized for the default position and query resolutions.
+using FixedEncoder =
+    moteus::FixedCommandEncoder<get_position_resolution, get_query_resolution>;
+
+//! Encoder specialized for cycles where slow query fields are skipped.
+using FastEncoder = moteus::FixedCommandEncoder<get_position_resolution,
+                                                get_fast_query_resolution>;
+
+/*! Encode a servo command with a fixed encoder, if it supports it.
+ *
+ * \param[in] command Servo command.
+ * \param[in] query Query sent with the command at this cycle.
+ * \param[out] data Frame data.
+ * \param[out] size Frame size.
+ *
+ * \return True if the command was encoded, false otherwise.
+ *
+ * \tparam Encoder Instance of \ref moteus::FixedCommandEncoder.
+ */
+template <typename Encoder>
+bool emit_fixed_command(const moteus::ServoCommand& command,
+                        const moteus::QueryCommand& query, uint8_t* data,
+                        uint8_t* size) {
+  if (!Encoder::Supports(command.resolution, query)) {
+    return false;
+  }
+  switch (command.mode) {
+    case moteus::Mode::kStopped: {
+      Encoder::EmitStop(data, size);
+      return true;
+    }
+    case moteus::Mode::kPosition:
+    case moteus::Mode::kZeroVelocity: {
+      Encoder::EmitPosition(command.position, data, size);
+      return true;
+    }
+    default: {
+      return false;  // the generic path will throw
+    }
+  }
+}
+
+/*! Write window statistics to a dictionary.
+ *
+ * \param[in] statistics Summary of statistics to write.
+ * \param[out] output Dictionary to write to.
+ */
+void write_statistics(const WindowSummary& statistics, Dictionary& output) {
+  output("last") = statistics.last;
+  output("mean") = statistics.mean;
+  output("max") = statistics.max;
+}
+
+}  // namespace
+
 Pi3HatInterface::Pi3HatInterface(const ServoLayout& layout, const int can_cpu,
-                                 const Pi3Hat::Configuration& pi3hat_config)
+                                 CanTransportFactory make_transport,
+                                 const std::map<int, CanBitrates>& bus_bitrates)
     : Interface(layout),
       can_cpu_(can_cpu),
-      pi3hat_config_(pi3hat_config),
-      can_thread_(std::bind(&Pi3HatInterface::run_can_thread, this)) {}
+      make_transport_(std::move(make_transport)),
+      bus_timing_(layout, get_position_resolution(), get_query_resolution(),
+                  bus_bitrates),
+      fast_bus_timing_(layout, get_position_resolution(),
+                       get_fast_query_resolution(), bus_bitrates),
+      decimated_cycle_duration_(bus_timing_.cycle_duration()),
+      can_thread_(std::bind(&Pi3HatInterface::run_can_thread, this)) {
+  slow_query_ages_.fill(QueryDecimator::kNeverReceived);
+  for (const auto& bus_load : bus_timing_.bus_loads()) {
+    const BusLoad& load = bus_load.second;
+    spdlog::info(
+        "CAN bus {}: {} servos, {} bytes sent and {} bytes received in {:.0f} "
+        "us per cycle",
+        bus_load.first, load.nb_servos, load.tx_bytes, load.rx_bytes,
+        1e6 * load.duration);
+  }
+  constexpr double kMaxImbalance = 1.5;
+  if (bus_timing_.imbalance() > kMaxImbalance) {
+    spdlog::warn(
+        "CAN bus {} dominates the cycle time: cycles take {:.0f} us on the "
+        "bus, versus {:.0f} us if servos were balanced across buses",
+        bus_timing_.busiest_bus(), 1e6 * bus_timing_.cycle_duration(),
+        1e6 * bus_timing_.balanced_cycle_duration());
+  }
+  update_tx_order(data().commands);
+}
+
+#ifdef VULP_WITH_PI3HAT
+Pi3HatInterface::Pi3HatInterface(const ServoLayout& layout, const int can_cpu,
+                                 const Pi3Hat::Configuration& pi3hat_config)
+    : Pi3HatInterface(
+          layout, can_cpu,
+          [pi3hat_config]() {
+            return std::make_unique<Pi3HatTransport>(pi3hat_config);
+          },
+          Pi3HatTransport::get_bus_bitrates(pi3hat_config)) {}
+#endif
 
 Pi3HatInterface::~Pi3HatInterface() {
   done_ = true;  // comes first
@@ -35,7 +132,18 @@ Pi3HatInterface::~Pi3HatInterface() {
   }
 }
 
-void Pi3HatInterface::reset(const Dictionary& config) {}
+void Pi3HatInterface::reset(const Dictionary& config) {
+  params_.configure(config);
+  decimated_cycle_duration_ = decimated_cycle_duration(
+      bus_timing_, fast_bus_timing_, params_.query_decimation);
+  if (params_.frequency * decimated_cycle_duration_ > 1.0) {
+    spdlog::warn(
+        "Frequency of {} Hz exceeds the CAN bus budget: cycles take at least "
+        "{:.0f} us on the bus on average, i.e. at most {:.0f} Hz",
+        params_.frequency, 1e6 * decimated_cycle_duration_,
+        1.0 / decimated_cycle_duration_);
+  }
+}
 
 void Pi3HatInterface::observe(Dictionary& observation) const {
   ImuData imu_data;
@@ -49,6 +157,40 @@ void Pi3HatInterface::observe(Dictionary& observation) const {
   observation("imu")("angular_velocity") = imu_data.angular_velocity_imu_in_imu;
   observation("imu")("linear_acceleration") =
       imu_data.linear_acceleration_imu_in_imu;
+  observation("imu")("age") =
+      latest_attitude_.received
+          ? std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                          latest_attitude_.time)
+                .count()
+          : std::numeric_limits<double>::quiet_NaN();
+
+  auto& can = observation("can");
+  can("measured_cycle_duration") = measured_cycle_duration_;
+  can("theoretical_cycle_duration") = decimated_cycle_duration_;
+  can("theoretical_full_cycle_duration") = bus_timing_.cycle_duration();
+  can("cycles") = metrics_.nb_cycles;
+  can("transport_errors") = metrics_.nb_transport_errors;
+  can("missing_attitudes") = metrics_.nb_missing_attitudes;
+  can("incomplete_cycles") = metrics_.nb_incomplete_cycles;
+  can("missing_replies") = metrics_.nb_missing_replies;
+  can("max_missing_reply_streak") = metrics_.max_missing_reply_streak;
+  can("tx_frames") = metrics_.tx_frames;
+  can("rx_frames") = metrics_.rx_frames;
+  can("expected_replies") = metrics_.expected_replies;
+  write_statistics(metrics_.transport_duration, can("transport_duration"));
+  write_statistics(metrics_.handoff_delay, can("handoff_delay"));
+  write_statistics(metrics_.callback_delay, can("callback_delay"));
+
+  // Number of cycles since voltage, temperature and fault were received, and
+  // number of consecutive cycles without reply
+  for (const auto& id_joint : servo_joint_map()) {
+    const int servo_id = id_joint.first;
+    if (0 <= servo_id && servo_id < QueryDecimator::kNbServoIds) {
+      auto& servo = observation("servo")(id_joint.second);
+      servo("slow_query_age") = slow_query_ages_[servo_id];
+      servo("missing_reply_streak") = metrics_.missing_reply_streak(servo_id);
+    }
+  }
 }
 
 void Pi3HatInterface::cycle(
@@ -64,31 +206,49 @@ void Pi3HatInterface::cycle(
   ongoing_can_cycle_ = true;
   data_ = data;
 
+  // The CAN thread is idle, we can exchange data with it
+  can_params_ = params_;
+  query_decimator_.set_period(params_.query_decimation);
+  slow_query_ages_ = query_decimator_.ages();
+  measured_cycle_duration_ = last_cycle_duration_;
+  latest_attitude_ = attitude_sample_;
+  metrics_ = can_metrics_.snapshot();
+
+  cycle_request_time_ = std::chrono::steady_clock::now();
   can_wait_condition_.notify_all();
 }
 
 void Pi3HatInterface::run_can_thread() {
-  vulp::utils::configure_cpu(can_cpu_);
-  vulp::utils::configure_scheduler(10);
-  pi3hat_.reset(new Pi3Hat({pi3hat_config_}));
+  if (can_cpu_ >= 0) {
+    vulp::utils::configure_cpu(can_cpu_);
+    vulp::utils::configure_scheduler(10);
+  }
+  transport_ = make_transport_();
+#ifdef __APPLE__
+  pthread_setname_np("can_thread");
+#else
   pthread_setname_np(pthread_self(), "can_thread");
+#endif
   while (!done_) {
     {
       std::unique_lock<std::mutex> lock(mutex_);
       if (!ongoing_can_cycle_) {
-        can_wait_condition_.wait(lock);
+        // The predicate catches notifications sent before we started waiting
+        can_wait_condition_.wait(
+            lock, [this]() { return done_ || ongoing_can_cycle_; });
         if (done_) {
           return;
         }
-        if (!ongoing_can_cycle_) {
-          continue;
-        }
       }
     }
     auto output = cycle_can_thread();
     std::function<void(const moteus::Output&)> callback_copy;
     {
       std::unique_lock<std::mutex> lock(mutex_);
+      can_metrics_.record_callback_delay(
+          std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                        transport_end_time_)
+              .count());
       ongoing_can_cycle_ = false;
       std::swap(callback_copy, callback_);
     }
@@ -97,24 +257,34 @@ void Pi3HatInterface::run_can_thread() {
 }
 
 moteus::Output Pi3HatInterface::cycle_can_thread() {
+  can_metrics_.start_cycle(std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() -
+                               cycle_request_time_)
+                               .count());
+  update_tx_order(data_.commands);
   tx_can_.resize(data_.commands.size());
-  int out_idx = 0;
-  for (const auto& cmd : data_.commands) {
-    const auto& query = cmd.query;
+  query_decimator_.next_cycle();
 
-    auto& can = tx_can_[out_idx++];
+  // Frames alternate between buses so that all buses transmit in parallel
+  for (size_t out_idx = 0; out_idx < tx_order_.size(); ++out_idx) {
+    const size_t cmd_idx = tx_order_[out_idx];
+    const auto& cmd = data_.commands[cmd_idx];
+    const auto query = query_decimator_.query(cmd.id, cmd.query);
+    reply_decoder_.set_query(cmd.id, query);
+
+    auto& can = tx_can_[out_idx];
 
     can.expect_reply = query.any_set();
     can.id = cmd.id | (can.expect_reply ? 0x8000 : 0x0000);
     can.size = 0;
+    can.bus = tx_buses_[cmd_idx];
+    can_metrics_.send_frame(cmd.id, can.expect_reply);
 
-    can.bus = [&]() {
-      const auto it = servo_bus_map().find(cmd.id);
-      if (it == servo_bus_map().end()) {
-        return 1;
-      }
-      return it->second;
-    }();
+    // Fast path: commands at the default resolutions use precomputed frames
+    if (emit_fixed_command<FixedEncoder>(cmd, query, can.data, &can.size) ||
+        emit_fixed_command<FastEncoder>(cmd, query, can.data, &can.size)) {
+      continue;
+    }
 
     moteus::WriteCanFrame write_frame(can.data, &can.size);
     switch (cmd.mode) {
@@ -131,34 +301,70 @@ moteus::Output Pi3HatInterface::cycle_can_thread() {
         throw std::logic_error("unsupported mode");
       }
     }
-    moteus::EmitQueryCommand(&write_frame, cmd.query);
+    moteus::EmitQueryCommand(&write_frame, query);
   }
 
   rx_can_.resize(data_.commands.size() * 2);
 
-  Pi3Hat::Input input;
+  CanTransport::Input input;
   input.tx_can = {tx_can_.data(), tx_can_.size()};
   input.rx_can = {rx_can_.data(), rx_can_.size()};
-  input.attitude = &attitude_;
-  input.request_attitude = true;
-  input.wait_for_attitude = true;  // we may revisit this later
+  input.attitude = &rx_attitude_;
+  input.request_attitude = (attitude_cycle_ == 0);
+  input.wait_for_attitude =
+      input.request_attitude && can_params_.wait_for_attitude;
+  const unsigned attitude_decimation =
+      (can_params_.attitude_decimation > 0) ? can_params_.attitude_decimation
+                                            : 1;
+  attitude_cycle_ = (attitude_cycle_ + 1) % attitude_decimation;
 
   moteus::Output result;
-  const auto pi3hat_output = pi3hat_->Cycle(input);
-  if (pi3hat_output.error) {
-    spdlog::error("pi3hat: {}", pi3hat_output.error);
-  }
-  for (size_t i = 0; i < pi3hat_output.rx_can_size && i < data_.replies.size();
-       ++i) {
-    const auto& can = rx_can_[i];
-    data_.replies[i].id = (can.id & 0x7f00) >> 8;
-    data_.replies[i].result = moteus::ParseQueryResult(can.data, can.size);
-    result.query_result_size = i + 1;
-  }
-  if (!pi3hat_output.attitude_present) {  // because we wait for attitude
+  const auto cycle_start = std::chrono::steady_clock::now();
+  const auto transport_output = transport_->cycle(input);
+  transport_end_time_ = std::chrono::steady_clock::now();
+  last_cycle_duration_ =
+      std::chrono::duration<double>(transport_end_time_ - cycle_start).count();
+  if (transport_output.error) {
+    spdlog::error("CAN transport reported an error");
+  }
+  result.query_result_size = reply_decoder_.decode(
+      rx_can_.data(), transport_output.rx_can_size, data_.replies);
+  for (size_t i = 0; i < result.query_result_size; ++i) {
+    query_decimator_.merge(data_.replies[i].id, data_.replies[i].result);
+    can_metrics_.receive_reply(data_.replies[i].id);
+  }
+  const bool missing_attitude =
+      input.wait_for_attitude && !transport_output.attitude_present;
+  if (transport_output.attitude_present) {
+    attitude_sample_.attitude = rx_attitude_;
+    attitude_sample_.time = transport_end_time_;
+    attitude_sample_.received = true;
+  } else if (missing_attitude) {
     spdlog::warn("Missing attitude data!");
   }
+  can_metrics_.end_cycle(last_cycle_duration_, transport_output.error,
+                         missing_attitude);
   return result;
 }
 
+void Pi3HatInterface::update_tx_order(
+    const moteus::Span<moteus::ServoCommand>& commands) {
+  bool same_servos = (tx_ids_.size() == commands.size());
+  for (size_t i = 0; same_servos && i < commands.size(); ++i) {
+    same_servos = (tx_ids_[i] == commands[i].id);
+  }
+  if (same_servos) {
+    return;
+  }
+
+  tx_ids_.clear();
+  tx_buses_.clear();
+  for (const auto& cmd : commands) {
+    const auto it = servo_bus_map().find(cmd.id);
+    tx_ids_.push_back(cmd.id);
+    tx_buses_.push_back((it != servo_bus_map().end()) ? it->second : 1);
+  }
+  tx_order_ = interleave_buses(tx_buses_);
+}
+
 }  // namespace vulp::actuation
@@ -10,13 +10,16 @@
 
 #pragma once
 
-#include <mjbots/pi3hat/pi3hat.h>
 #include <pthread.h>
 #include <spdlog/spdlog.h>
 
 #include <Eigen/Geometry>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <functional>
+#include <limits>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -26,23 +29,113 @@
 #include <utility>
 #include <vector>
 
+#include "vulp/actuation/BusTiming.h"
+#include "vulp/actuation/CanCycleMetrics.h"
+#include "vulp/actuation/CanTransport.h"
 #include "vulp/actuation/ImuData.h"
 #include "vulp/actuation/Interface.h"
+#include "vulp/actuation/QueryDecimator.h"
+#include "vulp/actuation/moteus/ReplyDecoder.h"
+#include "vulp/actuation/moteus/fixed_protocol.h"
 #include "vulp/actuation/moteus/protocol.h"
+#include "vulp/actuation/resolution.h"
+#include "vulp/utils/get_unsigned.h"
 #include "vulp/utils/realtime.h"
 
-namespace vulp::actuation {
+#ifdef VULP_WITH_PI3HAT
+#include "vulp/actuation/Pi3HatTransport.h"
+#endif
 
-using Pi3Hat = ::mjbots::pi3hat::Pi3Hat;
+namespace vulp::actuation {
 
 /*! Interface to moteus controllers.
  *
  * Internally it uses a background thread to operate the pi3hat, enabling the
  * main thread to perform work while servo communication is taking place.
+ * Frames go through a \ref CanTransport, which is the pi3hat on the robot
+ * and can be a \ref MoteusEmulator on other hosts.
  */
 class Pi3HatInterface : public Interface {
  public:
+  //! Interface parameters.
+  struct Parameters {
+    //! Keep default constructor.
+    Parameters() = default;
+
+    /*! Initialize from global configuration.
+     *
+     * \param[in] config Global configuration dictionary.
+     */
+    explicit Parameters(const Dictionary& config) { configure(config); }
+
+    /*! Configure from dictionary.
+     *
+     * \param[in] config Global configuration dictionary.
+     */
+    void configure(const Dictionary& config) {
+      if (!config.has("pi3hat")) {
+        spdlog::debug("No \"pi3hat\" runtime configuration");
+        return;
+      }
+      spdlog::info("Applying \"pi3hat\" runtime configuration...");
+
+      const auto& pi3hat = config("pi3hat");
+      attitude_decimation = utils::get_unsigned(pi3hat, "attitude_decimation",
+                                                attitude_decimation);
+      frequency = pi3hat.get<double>("frequency", frequency);
+      query_decimation =
+          utils::get_unsigned(pi3hat, "query_decimation", query_decimation);
+      wait_for_attitude =
+          pi3hat.get<bool>("wait_for_attitude", wait_for_attitude);
+    }
+
+    /*! Request attitude from the pi3hat every that many cycles.
+     *
+     * The latest attitude sample is reported in between, along with its age.
+     */
+    unsigned attitude_decimation = 1;
+
+    /*! Frequency of communication cycles in [Hz].
+     *
+     * Used at reset to check that cycles fit in the bus budget. Undefined by
+     * default, in which case the check is skipped.
+     */
+    double frequency = std::numeric_limits<double>::quiet_NaN();
+
+    /*! Query voltage, temperature and fault every that many cycles.
+     *
+     * Slow fields are queried round-robin across servos, and observations
+     * keep their last known values in between. Set to one to query all fields
+     * at every cycle.
+     */
+    unsigned query_decimation = 1;
+
+    /*! Wait for attitude on cycles where it is requested.
+     *
+     * When false, CAN cycles do not wait for the IMU, and the latest attitude
+     * sample is kept until a new one is available.
+     */
+    bool wait_for_attitude = true;
+  };
+
   /*! Configure interface and spawn CAN thread.
+   *
+   * \param[in] layout Servo layout.
+   * \param[in] can_cpu CPUID of the core to run the CAN thread on. If
+   *     negative, the CAN thread keeps the default CPU affinity and scheduler,
+   *     which does not require root privileges.
+   * \param[in] make_transport Function called from the CAN thread to create
+   *     the CAN transport.
+   * \param[in] bus_bitrates Bitrates of each bus, used to estimate the bus
+   *     load. Buses that are not in this map use the default \ref
+   *     CanBitrates.
+   */
+  Pi3HatInterface(const ServoLayout& layout, const int can_cpu,
+                  CanTransportFactory make_transport,
+                  const std::map<int, CanBitrates>& bus_bitrates = {});
+
+#ifdef VULP_WITH_PI3HAT
+  /*! Configure interface and spawn CAN thread operating the pi3hat.
    *
    * \param[in] layout Servo layout.
    * \param[in] can_cpu CPUID of the core to run the CAN thread on.
@@ -50,6 +143,7 @@ class Pi3HatInterface : public Interface {
    */
   Pi3HatInterface(const ServoLayout& layout, const int can_cpu,
                   const Pi3Hat::Configuration& pi3hat_config);
+#endif
 
   //! Stop CAN thread
   ~Pi3HatInterface();
@@ -87,20 +181,42 @@ class Pi3HatInterface : public Interface {
 
   /*! Execute one communication cycle on the CAN bus.
    *
-   * Also, request the latest filtered attitude from the pi3hat.
+   * Also, request the latest filtered attitude from the transport, every \ref
+   * Parameters::attitude_decimation cycles.
    */
   moteus::Output cycle_can_thread();
 
+  /*! Update the transmission order of commands if their servos changed.
+   *
+   * \param[in] commands Servo commands of the current cycle.
+   *
+   * The order is computed once by \ref interleave_buses, and only recomputed
+   * if the servo IDs of commands change from one cycle to the next.
+   */
+  void update_tx_order(const moteus::Span<moteus::ServoCommand>& commands);
+
+  //! Attitude sample with its reception time.
+  struct AttitudeSample {
+    //! Attitude read from the transport.
+    CanTransport::Attitude attitude;
+
+    //! Time when the attitude was received.
+    std::chrono::steady_clock::time_point time;
+
+    //! True if and only if an attitude has been received.
+    bool received = false;
+  };
+
   /*! Get orientation from the IMU frame to the world frame.
    *
    * This orientation is computed by the Unscented Kalman filter in
    * pi3hat/fw/ukf_filter.h.
    */
   Eigen::Quaterniond get_attitude() const noexcept {
-    const double w = attitude_.attitude.w;
-    const double x = attitude_.attitude.x;
-    const double y = attitude_.attitude.y;
-    const double z = attitude_.attitude.z;
+    const double w = latest_attitude_.attitude.attitude.w;
+    const double x = latest_attitude_.attitude.attitude.x;
+    const double y = latest_attitude_.attitude.attitude.y;
+    const double z = latest_attitude_.attitude.attitude.z;
     // These values were floats so the resulting quaternion is only
     // approximately normalized. We saw this property in d7fcaa97fa.
     return Eigen::Quaterniond(w, x, y, z).normalized();
@@ -112,9 +228,9 @@ class Pi3HatInterface : public Interface {
    * frame \f$ B \f$ to the world frame \f$ W \f$, expressed in the IMU frame.
    */
   Eigen::Vector3d get_angular_velocity() const noexcept {
-    const double omega_x = attitude_.rate_dps.x * M_PI / 180.;
-    const double omega_y = attitude_.rate_dps.y * M_PI / 180.;
-    const double omega_z = attitude_.rate_dps.z * M_PI / 180.;
+    const double omega_x = latest_attitude_.attitude.rate_dps.x * M_PI / 180.;
+    const double omega_y = latest_attitude_.attitude.rate_dps.y * M_PI / 180.;
+    const double omega_z = latest_attitude_.attitude.rate_dps.z * M_PI / 180.;
     return {omega_x, omega_y, omega_z};
   }
 
@@ -124,18 +240,36 @@ class Pi3HatInterface : public Interface {
    * B \f$ with respect to the world frame, expressed in the IMU frame.
    */
   Eigen::Vector3d get_linear_acceleration() const noexcept {
-    const double a_x = attitude_.accel_mps2.x;
-    const double a_y = attitude_.accel_mps2.y;
-    const double a_z = attitude_.accel_mps2.z;
+    const double a_x = latest_attitude_.attitude.accel_mps2.x;
+    const double a_y = latest_attitude_.attitude.accel_mps2.y;
+    const double a_z = latest_attitude_.attitude.accel_mps2.z;
     return {a_x, a_y, a_z};
   }
 
  private:
+  //! Interface parameters.
+  Parameters params_;
+
+  //! Copy of \ref params_ for the CAN thread, updated when a cycle starts.
+  Parameters can_params_;
+
   //! CPUID of the core to run the CAN thread on.
   const int can_cpu_;
 
-  // pi3hat configuration
-  const Pi3Hat::Configuration pi3hat_config_;
+  //! Function that creates the CAN transport, called from the CAN thread.
+  const CanTransportFactory make_transport_;
+
+  //! Bus load model for the servo layout and bus bitrates.
+  const BusTiming bus_timing_;
+
+  //! Bus load model on cycles where slow query fields are skipped.
+  const BusTiming fast_bus_timing_;
+
+  /*! Estimated cycle duration with the current query decimation, in [s].
+   *
+   * Average over a decimation period, updated upon reset.
+   */
+  double decimated_cycle_duration_;
 
   //! Mutex associated with \ref can_wait_condition_
   std::mutex mutex_;
@@ -147,7 +281,7 @@ class Pi3HatInterface : public Interface {
   bool ongoing_can_cycle_ = false;
 
   //! CAN thread exits when it is notified and this boolean is true.
-  bool done_ = false;
+  std::atomic<bool> done_ = false;
 
   //! Callback function called upon completion of a CAN cycle
   std::function<void(const moteus::Output&)> callback_;
@@ -155,19 +289,80 @@ class Pi3HatInterface : public Interface {
   //! Buffer to read commands from and write replies to.
   moteus::Data data_;
 
+  //! CAN transport, declared before the thread that creates it.
+  std::unique_ptr<CanTransport> transport_;
+
   //! Thread for CAN communication cycles
   std::thread can_thread_;
 
-  //! Internal Pi3Hat interface. Only use from the CAN thread.
-  std::unique_ptr<Pi3Hat> pi3hat_;
-
   // These are kept persistently so that no memory allocation is
   // required in steady state.
-  std::vector<::mjbots::pi3hat::CanFrame> tx_can_;
-  std::vector<::mjbots::pi3hat::CanFrame> rx_can_;
+  std::vector<CanTransport::Frame> tx_can_;
+  std::vector<CanTransport::Frame> rx_can_;
+
+  //! Servo IDs of the commands \ref tx_order_ was computed for.
+  std::vector<int> tx_ids_;
+
+  //! Bus of each command, in command order.
+  std::vector<int> tx_buses_;
+
+  //! Indices of commands in transmission order, interleaved across buses.
+  std::vector<size_t> tx_order_;
+
+  //! Decoder for servo replies. Only use from the CAN thread.
+  moteus::ReplyDecoder reply_decoder_;
+
+  //! Decimation of slow query fields. Only use from the CAN thread.
+  QueryDecimator query_decimator_;
+
+  /*! Ages of slow query fields at the end of the last cycle.
+   *
+   * Copied from \ref query_decimator_ when a new cycle starts, so that it can
+   * be read from the main thread while the CAN thread runs.
+   */
+  std::array<uint32_t, QueryDecimator::kNbServoIds> slow_query_ages_;
+
+  //! Duration of the last transport cycle in [s]. Only use from CAN thread.
+  double last_cycle_duration_ = 0.0;
+
+  /*! Duration of the last transport cycle in [s].
+   *
+   * Copied from \ref last_cycle_duration_ when a new cycle starts, so that it
+   * can be read from the main thread while the CAN thread runs.
+   */
+  double measured_cycle_duration_ = 0.0;
+
+  //! Time when the current cycle was requested by \ref cycle.
+  std::chrono::steady_clock::time_point cycle_request_time_;
+
+  //! Time when the last transport cycle ended. Only use from the CAN thread.
+  std::chrono::steady_clock::time_point transport_end_time_;
+
+  //! Metrics of CAN cycles. Only use from the CAN thread.
+  CanCycleMetrics can_metrics_;
+
+  /*! Metrics of CAN cycles at the end of the last cycle.
+   *
+   * Snapshot of \ref can_metrics_ taken when a new cycle starts, so that it
+   * can be read from the main thread while the CAN thread runs.
+   */
+  CanCycleSnapshot metrics_;
+
+  //! Attitude buffer for transport cycles. Only use from the CAN thread.
+  CanTransport::Attitude rx_attitude_;
+
+  //! Latest attitude sample. Only use from the CAN thread.
+  AttitudeSample attitude_sample_;
+
+  /*! Latest attitude sample at the end of the last cycle.
+   *
+   * Copied from \ref attitude_sample_ when a new cycle starts, so that it can
+   * be read from the main thread while the CAN thread runs.
+   */
+  AttitudeSample latest_attitude_;
 
-  //! Latest attitude read from the pi3hat
-  ::mjbots::pi3hat::Attitude attitude_;
+  //! Number of cycles since the last attitude request.
+  unsigned attitude_cycle_ = 0;
 };
 
 }  // namespace vulp::actuation
@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "vulp/actuation/Pi3HatTransport.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace vulp::actuation {
+
+Pi3HatTransport::Pi3HatTransport(const Pi3Hat::Configuration& config)
+    : pi3hat_(config) {}
+
+CanTransport::Output Pi3HatTransport::cycle(const Input& input) {
+  tx_can_.resize(input.tx_can.size());
+  rx_can_.resize(input.rx_can.size());
+  for (size_t i = 0; i < input.tx_can.size(); ++i) {
+    const Frame& frame = input.tx_can[i];
+    auto& pi3hat_frame = tx_can_[i];
+    pi3hat_frame.id = frame.id;
+    std::memcpy(pi3hat_frame.data, frame.data, frame.size);
+    pi3hat_frame.size = frame.size;
+    pi3hat_frame.bus = frame.bus;
+    pi3hat_frame.expect_reply = frame.expect_reply;
+  }
+
+  Pi3Hat::Input pi3hat_input;
+  pi3hat_input.tx_can = {tx_can_.data(), tx_can_.size()};
+  pi3hat_input.rx_can = {rx_can_.data(), rx_can_.size()};
+  pi3hat_input.attitude = &attitude_;
+  pi3hat_input.request_attitude = input.request_attitude;
+  pi3hat_input.wait_for_attitude = input.wait_for_attitude;
+  const auto pi3hat_output = pi3hat_.Cycle(pi3hat_input);
+
+  Output output;
+  output.error = pi3hat_output.error;
+  output.rx_can_size = std::min(pi3hat_output.rx_can_size, rx_can_.size());
+  for (size_t i = 0; i < output.rx_can_size; ++i) {
+    const auto& pi3hat_frame = rx_can_[i];
+    Frame& frame = input.rx_can[i];
+    frame.id = pi3hat_frame.id;
+    std::memcpy(frame.data, pi3hat_frame.data, pi3hat_frame.size);
+    frame.size = pi3hat_frame.size;
+    frame.bus = pi3hat_frame.bus;
+    frame.expect_reply = pi3hat_frame.expect_reply;
+  }
+  if (pi3hat_output.attitude_present && input.attitude != nullptr) {
+    Attitude& attitude = *input.attitude;
+    attitude.attitude.w = attitude_.attitude.w;
+    attitude.attitude.x = attitude_.attitude.x;
+    attitude.attitude.y = attitude_.attitude.y;
+    attitude.attitude.z = attitude_.attitude.z;
+    attitude.rate_dps.x = attitude_.rate_dps.x;
+    attitude.rate_dps.y = attitude_.rate_dps.y;
+    attitude.rate_dps.z = attitude_.rate_dps.z;
+    attitude.accel_mps2.x = attitude_.accel_mps2.x;
+    attitude.accel_mps2.y = attitude_.accel_mps2.y;
+    attitude.accel_mps2.z = attitude_.accel_mps2.z;
+    output.attitude_present = true;
+  }
+  return output;
+}
+
+std::map<int, CanBitrates> Pi3HatTransport::get_bus_bitrates(
+    const Pi3Hat::Configuration& config) {
+  constexpr int kNbBuses = 5;
+  std::map<int, CanBitrates> bus_bitrates;
+  for (int bus = 1; bus <= kNbBuses; ++bus) {
+    const auto& can_config = config.can[bus - 1];
+    CanBitrates& bitrates = bus_bitrates[bus];
+    bitrates.nominal = can_config.slow_bitrate;
+    bitrates.data = can_config.fast_bitrate;
+    bitrates.bitrate_switch =
+        can_config.fdcan_frame && can_config.bitrate_switch;
+  }
+  return bus_bitrates;
+}
+
+}  // namespace vulp::actuation
@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <mjbots/pi3hat/pi3hat.h>
+
+#include <map>
+#include <vector>
+
+#include "vulp/actuation/BusTiming.h"
+#include "vulp/actuation/CanTransport.h"
+
+namespace vulp::actuation {
+
+using Pi3Hat = ::mjbots::pi3hat::Pi3Hat;
+
+/*! Transport through the pi3hat.
+ *
+ * Frames and attitude are converted to and from the types of the pi3hat
+ * library. Conversion buffers are kept persistently so that no memory
+ * allocation is required in steady state.
+ */
+class Pi3HatTransport : public CanTransport {
+ public:
+  /*! Open the pi3hat.
+   *
+   * \param[in] config Configuration of the pi3hat.
+   */
+  explicit Pi3HatTransport(const Pi3Hat::Configuration& config);
+
+  /*! Run a communication cycle on the pi3hat.
+   *
+   * \param[in] input Frames to send, receive buffer and attitude request.
+   *
+   * \return Number of received frames and attitude status.
+   */
+  Output cycle(const Input& input) override;
+
+  /*! Get the bitrates of each CAN bus of the pi3hat.
+   *
+   * \param[in] config Configuration of the pi3hat.
+   *
+   * \return Bitrates indexed by bus identifier, for all five buses of the
+   *     pi3hat, so that \ref BusTiming counts buses without servos as
+   *     available.
+   */
+  static std::map<int, CanBitrates> get_bus_bitrates(
+      const Pi3Hat::Configuration& config);
+
+ private:
+  //! Internal pi3hat interface.
+  Pi3Hat pi3hat_;
+
+  //! Frames to send, in the format of the pi3hat library.
+  std::vector<::mjbots::pi3hat::CanFrame> tx_can_;
+
+  //! Received frames, in the format of the pi3hat library.
+  std::vector<::mjbots::pi3hat::CanFrame> rx_can_;
+
+  //! Attitude, in the format of the pi3hat library.
+  ::mjbots::pi3hat::Attitude attitude_;
+};
+
+}  // namespace vulp::actuation
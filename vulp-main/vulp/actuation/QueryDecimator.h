@@ -0,0 +1,190 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+#include "vulp/actuation/moteus/QueryCommand.h"
+#include "vulp/actuation/moteus/QueryResult.h"
+#include "vulp/actuation/moteus/Resolution.h"
+#include "vulp/actuation/resolution.h"
+
+namespace vulp::actuation {
+
+/*! Remove slowly-varying fields from a query.
+ *
+ * \param[in] query Full query.
+ *
+ * \return Same query without voltage, temperature and fault.
+ */
+constexpr moteus::QueryCommand remove_slow_fields(moteus::QueryCommand query) {
+  query.voltage = moteus::Resolution::kIgnore;
+  query.temperature = moteus::Resolution::kIgnore;
+  query.fault = moteus::Resolution::kIgnore;
+  return query;
+}
+
+/*! Query resolution settings on cycles where slow fields are skipped.
+ *
+ * \return Query resolution settings.
+ *
+ * This function is constexpr so that the corresponding frames can be
+ * generated at compile time, like those of \ref get_query_resolution.
+ */
+constexpr moteus::QueryCommand get_fast_query_resolution() {
+  return remove_slow_fields(get_query_resolution());
+}
+
+/*! Query slowly-varying servo fields every few cycles.
+ *
+ * Voltage, temperature and fault change slowly compared to position, velocity
+ * and torque. With a decimation period \f$N\f$, slow fields are queried from
+ * a servo once every \f$N\f$ cycles, in a round-robin fashion across servos so
+ * that the bus load is spread evenly. Replies are completed with the last
+ * known values of slow fields, whose age is tracked per servo.
+ *
+ * This class is not thread-safe: it is meant to be used from the CAN thread
+ * only.
+ */
+class QueryDecimator {
+ public:
+  //! Number of servo identifiers that fit in a CAN arbitration ID.
+  static constexpr int kNbServoIds = 128;
+
+  //! Age of slow fields that have never been received.
+  static constexpr uint32_t kNeverReceived =
+      std::numeric_limits<uint32_t>::max();
+
+  //! Initialize without decimation.
+  QueryDecimator() { reset(1); }
+
+  /*! Reset decimator and forget last known values.
+   *
+   * \param[in] period Slow fields are queried every \p period cycles. Period
+   *     values of zero or one disable decimation.
+   */
+  void reset(unsigned period) {
+    period_ = (period > 0) ? period : 1;
+    cycle_ = 0;
+    ages_.fill(kNeverReceived);
+    slow_fields_.fill(SlowFields());
+    requested_.fill(false);
+  }
+
+  /*! Update decimation period.
+   *
+   * \param[in] period New decimation period.
+   *
+   * Last known values are kept if the period does not change.
+   */
+  void set_period(unsigned period) {
+    if (((period > 0) ? period : 1) != period_) {
+      reset(period);
+    }
+  }
+
+  //! Decimation period.
+  unsigned period() const noexcept { return period_; }
+
+  //! Start a new communication cycle.
+  void next_cycle() {
+    ++cycle_;
+    for (auto& age : ages_) {
+      if (age != kNeverReceived) {
+        ++age;
+      }
+    }
+  }
+
+  /*! Get the query to send to a servo at the current cycle.
+   *
+   * \param[in] servo_id Servo identifier.
+   * \param[in] full_query Query with all fields.
+   *
+   * \return Full query if slow fields are due for this servo, otherwise the
+   *     same query without slow fields.
+   */
+  moteus::QueryCommand query(int servo_id,
+                             const moteus::QueryCommand& full_query) {
+    if (!is_valid(servo_id)) {
+      return full_query;
+    }
+    // Query slow fields until a first value is received
+    const bool is_due = (period_ <= 1) ||
+                        (cycle_ % period_ == servo_id % period_) ||
+                        (ages_[servo_id] == kNeverReceived);
+    requested_[servo_id] = is_due;
+    return is_due ? full_query : remove_slow_fields(full_query);
+  }
+
+  /*! Merge slow fields into a servo reply.
+   *
+   * \param[in] servo_id Servo identifier.
+   * \param[in, out] result Reply from the servo. If slow fields were queried,
+   *     they are saved as last known values. Otherwise, they are filled in
+   *     from the last known values.
+   */
+  void merge(int servo_id, moteus::QueryResult& result) {
+    if (!is_valid(servo_id)) {
+      return;
+    }
+    SlowFields& slow = slow_fields_[servo_id];
+    if (requested_[servo_id]) {
+      slow.voltage = result.voltage;
+      slow.temperature = result.temperature;
+      slow.fault = result.fault;
+      ages_[servo_id] = 0;
+    } else {
+      result.voltage = slow.voltage;
+      result.temperature = slow.temperature;
+      result.fault = slow.fault;
+    }
+  }
+
+  /*! Number of cycles since slow fields were last received from each servo.
+   *
+   * Ages are indexed by servo identifier, and equal to \ref kNeverReceived
+   * for servos whose slow fields have not been received yet.
+   */
+  const std::array<uint32_t, kNbServoIds>& ages() const noexcept {
+    return ages_;
+  }
+
+ private:
+  //! Last known values of slow fields.
+  struct SlowFields {
+    //! Voltage in [V].
+    double voltage = std::numeric_limits<double>::quiet_NaN();
+
+    //! Temperature in [°C].
+    double temperature = std::numeric_limits<double>::quiet_NaN();
+
+    //! Fault code.
+    int fault = 0;
+  };
+
+  //! Check whether a servo identifier fits in our arrays.
+  static bool is_valid(int servo_id) {
+    return 0 <= servo_id && servo_id < kNbServoIds;
+  }
+
+  //! Slow fields are queried every period cycles.
+  unsigned period_;
+
+  //! Index of the current cycle.
+  unsigned cycle_;
+
+  //! Cycles since slow fields were last received, by servo identifier.
+  std::array<uint32_t, kNbServoIds> ages_;
+
+  //! Last known slow fields, by servo identifier.
+  std::array<SlowFields, kNbServoIds> slow_fields_;
+
+  //! Whether slow fields were requested at the current cycle.
+  std::array<bool, kNbServoIds> requested_;
+};
+
+}  // namespace vulp::actuation
@@ -0,0 +1,343 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "tools/cpp/runfiles/runfiles.h"
+#include "vulp/actuation/BulletInterface.h"
+#include "vulp/actuation/BulletModelCache.h"
+#include "vulp/actuation/BulletWorldPool.h"
+
+using bazel::tools::cpp::runfiles::Runfiles;
+
+namespace vulp::actuation {
+
+namespace {
+
+//! Value of argv[0], used to locate runfiles from a cc_binary.
+std::string argv0;
+
+//! Make the servo layout of Upkie.
+ServoLayout make_upkie_layout() {
+  ServoLayout layout;
+  layout.add_servo(1, 1, "right_hip");
+  layout.add_servo(2, 1, "right_knee");
+  layout.add_servo(3, 1, "right_wheel");
+  layout.add_servo(4, 2, "left_hip");
+  layout.add_servo(5, 2, "left_knee");
+  layout.add_servo(6, 2, "left_wheel");
+  return layout;
+}
+
+/*! Make parameters to simulate Upkie on the floor plane.
+ *
+ * \return Interface parameters.
+ *
+ * \throw std::runtime_error If runfiles cannot be found.
+ */
+BulletInterface::Parameters make_upkie_params() {
+  std::string error;
+  std::unique_ptr<Runfiles> runfiles(Runfiles::Create(argv0, &error));
+  if (runfiles == nullptr) {
+    throw std::runtime_error("Could not find runfiles: " + error);
+  }
+  BulletInterface::Parameters params;
+  params.argv0 = argv0;
+  params.dt = 1.0 / 1000.0;
+  params.robot_urdf_path =
+      runfiles->Rlocation("upkie_description/urdf/upkie.urdf");
+  params.position_base_in_world = Eigen::Vector3d(0.0, 0.0, 0.6);
+  return params;
+}
+
+//! Create a Bullet interface simulating Upkie on the floor plane.
+std::unique_ptr<BulletInterface> make_upkie_interface() {
+  return std::make_unique<BulletInterface>(make_upkie_layout(),
+                                           make_upkie_params());
+}
+
+//! Names of the performance profiles, indexed by benchmark argument.
+const std::array<std::string, 3> kProfiles = {"default", "fast", "accurate"};
+
+/*! Hold all joints at zero with position commands.
+ *
+ * \param[in, out] interface Interface to command.
+ */
+void hold_joints(BulletInterface& interface) {
+  for (auto& command : interface.commands()) {
+    command.mode = moteus::Mode::kPosition;
+    command.position.position = 0.0;
+    command.position.velocity = 0.0;
+    command.position.kp_scale = 1.0;
+    command.position.kd_scale = 1.0;
+    command.position.maximum_torque = 10.0;
+  }
+}
+
+/*! Drop Upkie on the floor while holding its joints at zero.
+ *
+ * \param[in] params Interface parameters.
+ * \param[in] nb_cycles Number of cycles to simulate.
+ *
+ * \return Position of the base in the world frame after the last cycle.
+ */
+Eigen::Vector3d drop_upkie(const BulletInterface::Parameters& params,
+                           int nb_cycles) {
+  BulletInterface interface(make_upkie_layout(), params);
+  hold_joints(interface);
+  for (int i = 0; i < nb_cycles; ++i) {
+    interface.cycle(interface.data(), [](const moteus::Output& output) {});
+  }
+  return interface.transform_base_to_world().block<3, 1>(0, 3);
+}
+
+}  // namespace
+
+/*! Simulation steps per second of Upkie in the Bullet interface.
+ *
+ * The argument is zero for stopped servos, one for position commands, which
+ * go through \ref BulletInterface::compute_joint_torque at every step.
+ */
+static void BM_BulletCycle(benchmark::State& state) {
+  auto interface = make_upkie_interface();
+  if (state.range(0) != 0) {
+    hold_joints(*interface);
+  }
+  for (auto _ : state) {
+    interface->cycle(interface->data(), [](const moteus::Output& output) {
+      benchmark::DoNotOptimize(output);
+    });
+  }
+  state.counters["steps_per_second"] =
+      benchmark::Counter(state.iterations(), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_BulletCycle)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+
+/*! Cycles per second with physics substeps and position commands.
+ *
+ * The argument is the number of substeps per cycle. Compare with the
+ * position-mode case of \ref BM_BulletCycle to see the cost of substeps
+ * versus that of running full cycles at a higher frequency.
+ */
+static void BM_BulletSubsteps(benchmark::State& state) {
+  auto interface = make_upkie_interface();
+  Dictionary config;
+  config("bullet")("nb_substeps") = static_cast<int>(state.range(0));
+  interface->reset(config);
+  hold_joints(*interface);
+  for (auto _ : state) {
+    interface->cycle(interface->data(), [](const moteus::Output& output) {
+      benchmark::DoNotOptimize(output);
+    });
+  }
+  state.counters["steps_per_second"] =
+      benchmark::Counter(state.iterations(), benchmark::Counter::kIsRate);
+  state.counters["substeps_per_second"] = benchmark::Counter(
+      state.iterations() * state.range(0), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_BulletSubsteps)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->Unit(benchmark::kMicrosecond);
+
+/*! Cycles per second while monitoring the contacts of both wheel tires.
+ *
+ * The argument is the contact period, i.e. the number of cycles between two
+ * contact queries.
+ */
+static void BM_BulletContacts(benchmark::State& state) {
+  auto interface = make_upkie_interface();
+  Dictionary config;
+  config("bullet")("contact_period") = static_cast<int>(state.range(0));
+  config("bullet")("monitor")("contacts")("left_wheel_tire") = true;
+  config("bullet")("monitor")("contacts")("right_wheel_tire") = true;
+  interface->reset(config);
+  for (auto _ : state) {
+    interface->cycle(interface->data(), [](const moteus::Output& output) {
+      benchmark::DoNotOptimize(output);
+    });
+  }
+  state.counters["steps_per_second"] =
+      benchmark::Counter(state.iterations(), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_BulletContacts)->Arg(1)->Arg(10)->Unit(benchmark::kMicrosecond);
+
+/*! Cost of height scans around the robot standing on the floor.
+ *
+ * The argument is the number of rows and columns of the height scan grid,
+ * zero to disable it. Compare with zero to get the cost per scan.
+ */
+static void BM_BulletHeightScan(benchmark::State& state) {
+  auto interface = make_upkie_interface();
+  const int grid_size = static_cast<int>(state.range(0));
+  Dictionary config;
+  config("bullet")("height_scan")("nb_rows") = grid_size;
+  config("bullet")("height_scan")("nb_cols") = grid_size;
+  config("bullet")("height_scan")("spacing") = 0.05;  // [m]
+  interface->reset(config);
+  for (auto _ : state) {
+    interface->cycle(interface->data(), [](const moteus::Output& output) {
+      benchmark::DoNotOptimize(output);
+    });
+  }
+  state.counters["rays_per_second"] = benchmark::Counter(
+      state.iterations() * grid_size * grid_size, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_BulletHeightScan)
+    ->Arg(0)
+    ->Arg(8)
+    ->Arg(16)
+    ->Arg(32)
+    ->Unit(benchmark::kMicrosecond);
+
+/*! Control-loop latency with the simulated camera on and off.
+ *
+ * The argument is the camera period in cycles, zero to disable the camera.
+ * Images are rendered on the control-loop thread, so that cycles where the
+ * camera is due pay for rendering. The worst cycle duration is reported along
+ * with the average.
+ */
+static void BM_BulletCamera(benchmark::State& state) {
+  BulletInterface::Parameters params = make_upkie_params();
+  params.camera.period = static_cast<unsigned>(state.range(0));
+  BulletInterface interface(make_upkie_layout(), params);
+  hold_joints(interface);
+  double max_cycle_duration = 0.0;
+  for (auto _ : state) {
+    const auto start = std::chrono::steady_clock::now();
+    interface.cycle(interface.data(), [](const moteus::Output& output) {
+      benchmark::DoNotOptimize(output);
+    });
+    const std::chrono::duration<double, std::micro> cycle_duration =
+        std::chrono::steady_clock::now() - start;
+    max_cycle_duration = std::max(max_cycle_duration, cycle_duration.count());
+  }
+  state.counters["max_cycle_us"] = max_cycle_duration;
+  state.counters["steps_per_second"] =
+      benchmark::Counter(state.iterations(), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_BulletCamera)
+    ->Arg(0)
+    ->Arg(1)
+    ->Arg(10)
+    ->Unit(benchmark::kMicrosecond);
+
+/*! Step time versus accuracy of performance profiles.
+ *
+ * The argument indexes \ref kProfiles. Accuracy is reported as the error
+ * in base position, after dropping Upkie on the floor for one second, with
+ * respect to a reference run of the accurate profile with eight substeps.
+ */
+static void BM_BulletProfile(benchmark::State& state) {
+  constexpr int kNbCycles = 1000;
+  const std::string& profile = kProfiles.at(state.range(0));
+  Dictionary config;
+  config("bullet")("profile") = profile;
+
+  BulletInterface::Parameters reference_params = make_upkie_params();
+  reference_params.apply_profile("accurate");
+  reference_params.nb_substeps = 8;
+  BulletInterface::Parameters params = make_upkie_params();
+  params.configure(config);
+  const double position_error =
+      (drop_upkie(params, kNbCycles) - drop_upkie(reference_params, kNbCycles))
+          .norm();
+
+  BulletInterface interface(make_upkie_layout(), params);
+  hold_joints(interface);
+  for (auto _ : state) {
+    interface.cycle(interface.data(), [](const moteus::Output& output) {
+      benchmark::DoNotOptimize(output);
+    });
+  }
+  state.SetLabel(profile);
+  state.counters["position_error"] = position_error;
+  state.counters["steps_per_second"] =
+      benchmark::Counter(state.iterations(), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_BulletProfile)
+    ->Arg(0)
+    ->Arg(1)
+    ->Arg(2)
+    ->Unit(benchmark::kMicrosecond);
+
+/*! Latency of episode resets.
+ *
+ * The argument is zero to zero joint angles one at a time, one to restore
+ * the world state saved after loading.
+ */
+static void BM_BulletReset(benchmark::State& state) {
+  auto interface = make_upkie_interface();
+  Dictionary config;
+  config("bullet")("restore_snapshot") = (state.range(0) != 0);
+  for (auto _ : state) {
+    interface->reset(config);
+  }
+}
+BENCHMARK(BM_BulletReset)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+
+/*! Construction time of the Bullet interface.
+ *
+ * The argument is zero for a cold cache, cleared before each construction,
+ * and one for a warm cache, as when a process creates many simulators.
+ */
+static void BM_BulletConstruction(benchmark::State& state) {
+  const ServoLayout layout = make_upkie_layout();
+  const BulletInterface::Parameters params = make_upkie_params();
+  const bool warm_cache = (state.range(0) != 0);
+  BulletModelCache::clear();
+  if (warm_cache) {
+    BulletInterface warm_up(layout, params);
+  }
+  for (auto _ : state) {
+    if (!warm_cache) {
+      BulletModelCache::clear();
+    }
+    BulletInterface interface(layout, params);
+    benchmark::DoNotOptimize(interface);
+  }
+}
+BENCHMARK(BM_BulletConstruction)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+/*! Simulation steps per second of a pool of worlds.
+ *
+ * The argument is the number of worlds. Worlds are stepped one after the
+ * other, so that steps per second should stay close to that of a single
+ * world, the pool only saving the overhead of separate processes.
+ */
+static void BM_BulletWorldPool(benchmark::State& state) {
+  const size_t nb_worlds = static_cast<size_t>(state.range(0));
+  BulletWorldPool pool(make_upkie_layout(), make_upkie_params(), nb_worlds);
+  for (auto _ : state) {
+    pool.step_all();
+  }
+  state.counters["steps_per_second"] = benchmark::Counter(
+      state.iterations() * nb_worlds, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_BulletWorldPool)
+    ->RangeMultiplier(4)
+    ->Range(1, 16)
+    ->Unit(benchmark::kMicrosecond);
+
+}  // namespace vulp::actuation
+
+int main(int argc, char** argv) {
+  vulp::actuation::argv0 = argv[0];
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
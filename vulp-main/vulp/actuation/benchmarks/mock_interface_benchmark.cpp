@@ -0,0 +1,144 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+
+#include "vulp/actuation/MockInterface.h"
+
+namespace vulp::actuation {
+
+namespace {
+
+//! Make a servo layout with the servos of a two-legged wheeled robot.
+ServoLayout make_layout() {
+  ServoLayout layout;
+  layout.add_servo(1, 1, "left_hip");
+  layout.add_servo(2, 1, "left_knee");
+  layout.add_servo(3, 1, "left_wheel");
+  layout.add_servo(4, 2, "right_hip");
+  layout.add_servo(5, 2, "right_knee");
+  layout.add_servo(6, 2, "right_wheel");
+  return layout;
+}
+
+/*! Busy-wait for a given duration, as the spine does when it runs observers.
+ *
+ * \param[in] duration Duration in [s].
+ */
+void work_for(double duration) {
+  const auto deadline =
+      std::chrono::steady_clock::now() +
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::duration<double>(duration));
+  while (std::chrono::steady_clock::now() < deadline) {
+  }
+}
+
+/*! Run pipelined cycles the way the spine does.
+ *
+ * Each iteration works for some time, as the spine does when it observes and
+ * writes actions, then waits for the previous actuation cycle and starts a
+ * new one, as in \ref Spine::cycle_actuation.
+ *
+ * \param[in, out] state Benchmark state.
+ * \param[in, out] interface Actuation interface.
+ * \param[in] work_duration Duration of spine work at each cycle, in [s].
+ */
+void run_spine_cycles(benchmark::State& state, MockInterface& interface,
+                      double work_duration) {
+  std::future<moteus::Output> actuation_output;
+  for (auto _ : state) {
+    work_for(work_duration);
+    if (actuation_output.valid()) {
+      benchmark::DoNotOptimize(actuation_output.get());
+    }
+    auto promise = std::make_shared<std::promise<moteus::Output>>();
+    interface.cycle(interface.data(),
+                    [promise](const moteus::Output& output) {
+                      promise->set_value(output);
+                    });
+    actuation_output = promise->get_future();
+  }
+  if (actuation_output.valid()) {
+    actuation_output.wait();
+  }
+}
+
+}  // namespace
+
+/*! Period of spine cycles, whose actuation cycles are pipelined.
+ *
+ * Arguments are the fixed latency of actuation cycles and the duration of
+ * spine work, both in [us], with a latency of zero for synchronous cycles.
+ * When both are non-zero, the cycle period is their maximum rather than their
+ * sum.
+ */
+static void BM_SpinePipelining(benchmark::State& state) {
+  MockInterface::Parameters params;
+  params.latency = 1e-6 * state.range(0);
+  params.latency_mode = (state.range(0) > 0)
+                            ? MockInterface::LatencyMode::kFixed
+                            : MockInterface::LatencyMode::kSynchronous;
+  MockInterface interface(make_layout(), 1e-3, params);
+  run_spine_cycles(state, interface, 1e-6 * state.range(1));
+}
+BENCHMARK(BM_SpinePipelining)
+    ->ArgsProduct({{0, 200, 500}, {0, 300}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+/*! Same as \ref BM_SpinePipelining with latencies from a histogram.
+ *
+ * The histogram has most cycles at 300 to 400 us, and a tail up to 1 ms.
+ * The argument is the duration of spine work in [us].
+ */
+static void BM_SpineHistogramLatency(benchmark::State& state) {
+  MockInterface::Parameters params;
+  params.latency_mode = MockInterface::LatencyMode::kHistogram;
+  params.histogram_edges = {300e-6, 400e-6, 600e-6, 1000e-6};
+  params.histogram_counts = {90.0, 9.0, 1.0};
+  MockInterface interface(make_layout(), 1e-3, params);
+  run_spine_cycles(state, interface, 1e-6 * state.range(0));
+}
+BENCHMARK(BM_SpineHistogramLatency)
+    ->Arg(0)
+    ->Arg(300)
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+/*! Synchronous cycles with thousands of virtual servos.
+ *
+ * Arguments are the servo model, as in \ref MockInterface::ServoModel, and
+ * the number of servos. Items are servo updates, including reading commands
+ * and writing replies.
+ */
+static void BM_ServoModels(benchmark::State& state) {
+  ServoLayout layout;
+  for (int64_t servo_id = 1; servo_id <= state.range(1); ++servo_id) {
+    layout.add_servo(servo_id, 1 + servo_id % 4,
+                     "joint_" + std::to_string(servo_id));
+  }
+  MockInterface::Parameters params;
+  params.servo_model = static_cast<MockInterface::ServoModel>(state.range(0));
+  MockInterface interface(layout, 1e-3, params);
+  for (auto& command : interface.commands()) {
+    command.mode = moteus::Mode::kPosition;
+    command.position.position = 0.1;
+    command.position.velocity = 0.0;
+    command.position.maximum_torque = 10.0;
+  }
+  for (auto _ : state) {
+    interface.cycle(interface.data(), [](const moteus::Output& output) {
+      benchmark::DoNotOptimize(output);
+    });
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+BENCHMARK(BM_ServoModels)->ArgsProduct({{0, 1, 2}, {12, 1000, 4000}});
+
+}  // namespace vulp::actuation
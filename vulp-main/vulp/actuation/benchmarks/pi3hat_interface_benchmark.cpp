@@ -0,0 +1,162 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include <benchmark/benchmark.h>
+
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "vulp/actuation/BusTiming.h"
+#include "vulp/actuation/MoteusEmulator.h"
+#include "vulp/actuation/Pi3HatInterface.h"
+
+namespace vulp::actuation {
+
+namespace {
+
+/*! Make a servo layout with servos spread over two buses.
+ *
+ * \param[in] nb_servos Number of servos.
+ */
+ServoLayout make_layout(int nb_servos) {
+  ServoLayout layout;
+  for (int servo_id = 1; servo_id <= nb_servos; ++servo_id) {
+    const int bus = 1 + (servo_id - 1) % 2;
+    layout.add_servo(servo_id, bus, "joint_" + std::to_string(servo_id));
+  }
+  return layout;
+}
+
+/*! Make an interface whose CAN thread runs an emulator.
+ *
+ * \param[in] layout Servo layout.
+ * \param[in] params Emulator parameters.
+ */
+std::unique_ptr<Pi3HatInterface> make_interface(
+    const ServoLayout& layout, const MoteusEmulator::Parameters& params) {
+  constexpr int kNoCpu = -1;
+  return std::make_unique<Pi3HatInterface>(layout, kNoCpu, [params]() {
+    return std::make_unique<MoteusEmulator>(params);
+  });
+}
+
+/*! Start a cycle the way the spine does, then wait for its output.
+ *
+ * \param[in, out] interface Actuation interface.
+ */
+moteus::Output cycle_and_wait(Pi3HatInterface& interface) {
+  auto promise = std::make_shared<std::promise<moteus::Output>>();
+  interface.cycle(interface.data(), [promise](const moteus::Output& output) {
+    promise->set_value(output);
+  });
+  return promise->get_future().get();
+}
+
+//! Send position commands to all servos.
+void write_position_commands(Pi3HatInterface& interface) {
+  for (auto& command : interface.commands()) {
+    command.mode = moteus::Mode::kPosition;
+    command.position.position = 0.1;
+    command.position.velocity = 0.0;
+    command.position.maximum_torque = 10.0;
+  }
+}
+
+}  // namespace
+
+/*! Modeled cycle time of uneven layouts, with frames interleaved by bus.
+ *
+ * Arguments are the number of servos on buses 1 and 2. Frames reach their
+ * buses 10 us apart, so that frame order matters. Counters report the cycle
+ * duration from the emulator, that of the bus timing model, and its ratio to
+ * a balanced layout.
+ */
+static void BM_UnevenLayouts(benchmark::State& state) {
+  ServoLayout layout;
+  int servo_id = 1;
+  for (int bus = 1; bus <= 2; ++bus) {
+    for (int64_t i = 0; i < state.range(bus - 1); ++i, ++servo_id) {
+      layout.add_servo(servo_id, bus, "joint_" + std::to_string(servo_id));
+    }
+  }
+  const std::map<int, CanBitrates> bus_bitrates = {{1, CanBitrates()},
+                                                   {2, CanBitrates()}};
+  const BusTiming bus_timing(layout, get_position_resolution(),
+                             get_query_resolution(), bus_bitrates);
+
+  MoteusEmulator::Parameters params;
+  params.real_time = false;
+  params.tx_frame_latency = 10e-6;
+  MoteusEmulator* emulator = nullptr;
+  constexpr int kNoCpu = -1;
+  Pi3HatInterface interface(
+      layout, kNoCpu,
+      [&emulator, params]() {
+        auto new_emulator = std::make_unique<MoteusEmulator>(params);
+        emulator = new_emulator.get();
+        return new_emulator;
+      },
+      bus_bitrates);
+  Dictionary config;
+  config("pi3hat")("wait_for_attitude") = false;  // only measure buses
+  interface.reset(config);
+  write_position_commands(interface);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(cycle_and_wait(interface));
+  }
+  state.counters["cycle_us"] = 1e6 * emulator->last_cycle_duration();
+  state.counters["model_us"] = 1e6 * bus_timing.cycle_duration();
+  state.counters["imbalance"] = bus_timing.imbalance();
+}
+BENCHMARK(BM_UnevenLayouts)
+    ->Args({3, 3})
+    ->Args({4, 2})
+    ->Args({5, 1})
+    ->Args({6, 0})
+    ->UseRealTime();
+
+/*! Host-side cost of a cycle, from the spine to the CAN thread and back.
+ *
+ * The emulator does not wait for the modeled bus time, so that timings cover
+ * frame encoding, thread handoffs and reply decoding. The argument is the
+ * number of servos.
+ */
+static void BM_CycleRoundTrip(benchmark::State& state) {
+  MoteusEmulator::Parameters params;
+  params.real_time = false;
+  auto interface = make_interface(make_layout(state.range(0)), params);
+  write_position_commands(*interface);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(cycle_and_wait(*interface));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CycleRoundTrip)->Arg(2)->Arg(6)->Arg(12)->UseRealTime();
+
+/*! Cycle period with the emulated buses and IMU running in real time.
+ *
+ * Arguments are the attitude decimation and whether cycles wait for the
+ * attitude, as in the "pi3hat" runtime configuration.
+ */
+static void BM_AttitudeModes(benchmark::State& state) {
+  MoteusEmulator::Parameters params;
+  params.attitude_rate = 1000.0;
+  auto interface = make_interface(make_layout(6), params);
+  Dictionary config;
+  config("pi3hat")("attitude_decimation") =
+      static_cast<unsigned>(state.range(0));
+  config("pi3hat")("wait_for_attitude") = (state.range(1) != 0);
+  interface->reset(config);
+  write_position_commands(*interface);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(cycle_and_wait(*interface));
+  }
+}
+BENCHMARK(BM_AttitudeModes)
+    ->ArgsProduct({{1, 4}, {0, 1}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+}  // namespace vulp::actuation
@@ -25,4 +25,21 @@ struct PositionResolution {
   Resolution watchdog_timeout = Resolution::kFloat;
 };
 
+//! Check whether two position resolutions are the same.
+constexpr bool operator==(const PositionResolution& lhs,
+                          const PositionResolution& rhs) {
+  return lhs.position == rhs.position && lhs.velocity == rhs.velocity &&
+         lhs.feedforward_torque == rhs.feedforward_torque &&
+         lhs.kp_scale == rhs.kp_scale && lhs.kd_scale == rhs.kd_scale &&
+         lhs.maximum_torque == rhs.maximum_torque &&
+         lhs.stop_position == rhs.stop_position &&
+         lhs.watchdog_timeout == rhs.watchdog_timeout;
+}
+
+//! Check whether two position resolutions differ.
+constexpr bool operator!=(const PositionResolution& lhs,
+                          const PositionResolution& rhs) {
+  return !(lhs == rhs);
+}
+
 }  // namespace vulp::actuation::moteus
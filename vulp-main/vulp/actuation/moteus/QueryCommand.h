@@ -26,7 +26,7 @@ struct QueryCommand {
   Resolution temperature = Resolution::kInt8;
   Resolution fault = Resolution::kInt8;
 
-  bool any_set() const {
+  constexpr bool any_set() const {
     return mode != Resolution::kIgnore || position != Resolution::kIgnore ||
            velocity != Resolution::kIgnore || torque != Resolution::kIgnore ||
            q_current != Resolution::kIgnore ||
@@ -37,4 +37,18 @@ struct QueryCommand {
   }
 };
 
+//! Check whether two query commands are the same.
+constexpr bool operator==(const QueryCommand& lhs, const QueryCommand& rhs) {
+  return lhs.mode == rhs.mode && lhs.position == rhs.position &&
+         lhs.velocity == rhs.velocity && lhs.torque == rhs.torque &&
+         lhs.q_current == rhs.q_current && lhs.d_current == rhs.d_current &&
+         lhs.rezero_state == rhs.rezero_state && lhs.voltage == rhs.voltage &&
+         lhs.temperature == rhs.temperature && lhs.fault == rhs.fault;
+}
+
+//! Check whether two query commands differ.
+constexpr bool operator!=(const QueryCommand& lhs, const QueryCommand& rhs) {
+  return !(lhs == rhs);
+}
+
 }  // namespace vulp::actuation::moteus
@@ -0,0 +1,123 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "vulp/actuation/moteus/QueryCommand.h"
+#include "vulp/actuation/moteus/ServoCommand.h"
+#include "vulp/actuation/moteus/ServoReply.h"
+#include "vulp/actuation/moteus/Span.h"
+#include "vulp/actuation/moteus/fixed_protocol.h"
+#include "vulp/actuation/moteus/protocol.h"
+
+namespace vulp::actuation::moteus {
+
+/*! Decode all servo replies of a communication cycle in one pass.
+ *
+ * Reply layouts are computed once for each distinct query sent to servos, and
+ * each servo identifier is mapped to the layout of its latest query.
+ * Replies that match their expected layout are decoded at fixed offsets,
+ * while other frames are decoded by the generic \ref ParseQueryResult
+ * function. Servo identifiers are read from each frame, so that missing or
+ * reordered replies are decoded correctly.
+ */
+class ReplyDecoder {
+ public:
+  //! Number of servo identifiers that fit in a CAN arbitration ID.
+  static constexpr size_t kNbServoIds = 128;
+
+  //! Initialize decoder without any known layout.
+  ReplyDecoder() { servo_layout_.fill(kNoLayout); }
+
+  /*! Prepare reply layouts from the servo commands of a cycle.
+   *
+   * \param[in] commands Servo commands, whose queries servos reply to.
+   */
+  void configure(const Span<ServoCommand>& commands) {
+    for (const auto& command : commands) {
+      set_query(command.id, command.query);
+    }
+  }
+
+  /*! Set the query a servo replies to.
+   *
+   * \param[in] servo_id Servo identifier.
+   * \param[in] query Query command sent to the servo.
+   *
+   * Layouts are cached across cycles, so that this function only computes
+   * (and allocates) a new layout the first time it sees a query.
+   */
+  void set_query(int servo_id, const QueryCommand& query) {
+    if (servo_id < 0 || servo_id >= static_cast<int>(kNbServoIds)) {
+      return;
+    }
+    size_t index = 0;
+    while (index < queries_.size() && queries_[index] != query) {
+      ++index;
+    }
+    if (index == queries_.size()) {
+      if (index >= kMaxLayouts) {
+        servo_layout_[servo_id] = kNoLayout;  // use the generic parser
+        return;
+      }
+      queries_.push_back(query);
+      layouts_.push_back(MakeQueryResultLayout(query));
+    }
+    servo_layout_[servo_id] = static_cast<int8_t>(index);
+  }
+
+  /*! Decode received CAN frames into servo replies.
+   *
+   * \param[in] frames Received CAN frames.
+   * \param[in] nb_frames Number of received frames.
+   * \param[out] replies Servo replies, written in reception order.
+   *
+   * \return Number of replies written, at most the size of \p replies.
+   *
+   * \tparam Frame CAN frame type with `id`, `data` and `size` fields, for
+   *     instance `mjbots::pi3hat::CanFrame`.
+   */
+  template <typename Frame>
+  size_t decode(const Frame* frames, size_t nb_frames,
+                Span<ServoReply> replies) const {
+    size_t nb_replies = 0;
+    for (size_t i = 0; i < nb_frames && nb_replies < replies.size(); ++i) {
+      const Frame& frame = frames[i];
+      auto& reply = replies[nb_replies++];
+      reply.id = static_cast<int>((frame.id & 0x7f00) >> 8);
+      const int8_t index = servo_layout_[reply.id];
+      if (index != kNoLayout &&
+          MatchesLayout(layouts_[index].frame, frame.data, frame.size)) {
+        reply.result = ParseWithLayout(layouts_[index], frame.data);
+      } else {
+        reply.result = ParseQueryResult(frame.data, frame.size);
+      }
+    }
+    return nb_replies;
+  }
+
+  //! Number of distinct reply layouts.
+  size_t nb_layouts() const noexcept { return layouts_.size(); }
+
+ private:
+  //! Index of servos that have no known layout.
+  static constexpr int8_t kNoLayout = -1;
+
+  //! Maximum number of cached layouts.
+  static constexpr size_t kMaxLayouts = 127;
+
+  //! Map from servo identifier to index in \ref layouts_.
+  std::array<int8_t, kNbServoIds> servo_layout_;
+
+  //! Distinct queries from servo commands.
+  std::vector<QueryCommand> queries_;
+
+  //! Reply layouts, one for each query in \ref queries_.
+  std::vector<QueryLayout> layouts_;
+};
+
+}  // namespace vulp::actuation::moteus
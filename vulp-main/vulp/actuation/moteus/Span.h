@@ -10,6 +10,8 @@
 
 #pragma once
 
+#include <cstddef>
+
 namespace vulp::actuation::moteus {
 
 /*! Fixed-size array with runtime size information.
@@ -0,0 +1,151 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "vulp/actuation/moteus/ReplyDecoder.h"
+#include "vulp/actuation/moteus/fixed_protocol.h"
+#include "vulp/actuation/moteus/protocol.h"
+#include "vulp/actuation/resolution.h"
+
+namespace vulp::actuation::moteus {
+
+using Encoder =
+    FixedCommandEncoder<get_position_resolution, get_query_resolution>;
+using Parser = FixedQueryParser<get_query_resolution>;
+
+namespace {
+
+PositionCommand sample_position_command() {
+  PositionCommand command;
+  command.position = 0.123456;
+  command.velocity = -1.5;
+  command.kp_scale = 0.5;
+  command.kd_scale = 0.25;
+  command.maximum_torque = 16.0;
+  return command;
+}
+
+CanFrame sample_reply_frame() {
+  QueryResult result;
+  result.mode = Mode::kPosition;
+  result.position = 0.25;
+  result.velocity = -0.75;
+  result.torque = 1.5;
+  result.voltage = 18.5;
+  result.temperature = 42.0;
+  CanFrame frame;
+  WriteCanFrame writer(&frame);
+  EmitQueryResult(&writer, get_query_resolution(), result);
+  return frame;
+}
+
+//! Received frame, laid out like mjbots::pi3hat::CanFrame.
+struct RxFrame {
+  uint32_t id = 0;
+  uint8_t data[64] = {};
+  uint8_t size = 0;
+};
+
+//! Servo commands and reply frames of a cycle with a given number of servos.
+struct SampleCycle {
+  explicit SampleCycle(int nb_servos)
+      : commands(nb_servos), replies(nb_servos), frames(nb_servos) {
+    const CanFrame reply_frame = sample_reply_frame();
+    for (int i = 0; i < nb_servos; ++i) {
+      commands[i].id = i + 1;
+      commands[i].query = get_query_resolution();
+      std::copy(reply_frame.data, reply_frame.data + reply_frame.size,
+                frames[i].data);
+      frames[i].size = reply_frame.size;
+      frames[i].id = static_cast<uint32_t>((i + 1) << 8);
+    }
+  }
+
+  std::vector<ServoCommand> commands;
+  std::vector<ServoReply> replies;
+  std::vector<RxFrame> frames;
+};
+
+}  // namespace
+
+static void BM_EmitPositionCommandGeneric(benchmark::State& state) {
+  const PositionCommand command = sample_position_command();
+  const PositionResolution resolution = get_position_resolution();
+  const QueryCommand query = get_query_resolution();
+  CanFrame frame;
+  for (auto _ : state) {
+    frame.size = 0;
+    WriteCanFrame writer(&frame);
+    EmitPositionCommand(&writer, command, resolution);
+    EmitQueryCommand(&writer, query);
+    benchmark::DoNotOptimize(frame);
+  }
+  state.SetBytesProcessed(state.iterations() * frame.size);
+}
+BENCHMARK(BM_EmitPositionCommandGeneric);
+
+static void BM_EmitPositionCommandFixed(benchmark::State& state) {
+  const PositionCommand command = sample_position_command();
+  CanFrame frame;
+  for (auto _ : state) {
+    Encoder::EmitPosition(command, frame.data, &frame.size);
+    benchmark::DoNotOptimize(frame);
+  }
+  state.SetBytesProcessed(state.iterations() * frame.size);
+}
+BENCHMARK(BM_EmitPositionCommandFixed);
+
+static void BM_ParseQueryResultGeneric(benchmark::State& state) {
+  const CanFrame frame = sample_reply_frame();
+  for (auto _ : state) {
+    QueryResult result = ParseQueryResult(frame.data, frame.size);
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetBytesProcessed(state.iterations() * frame.size);
+}
+BENCHMARK(BM_ParseQueryResultGeneric);
+
+static void BM_ParseQueryResultFixed(benchmark::State& state) {
+  const CanFrame frame = sample_reply_frame();
+  for (auto _ : state) {
+    QueryResult result = Parser::Parse(frame.data, frame.size);
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetBytesProcessed(state.iterations() * frame.size);
+}
+BENCHMARK(BM_ParseQueryResultFixed);
+
+static void BM_DecodeRepliesGeneric(benchmark::State& state) {
+  SampleCycle cycle(state.range(0));
+  for (auto _ : state) {
+    for (size_t i = 0; i < cycle.frames.size(); ++i) {
+      const auto& frame = cycle.frames[i];
+      cycle.replies[i].id = (frame.id & 0x7f00) >> 8;
+      cycle.replies[i].result = ParseQueryResult(frame.data, frame.size);
+    }
+    benchmark::DoNotOptimize(cycle.replies.data());
+  }
+  state.SetItemsProcessed(state.iterations() * cycle.frames.size());
+}
+BENCHMARK(BM_DecodeRepliesGeneric)->Arg(6)->Arg(12)->Arg(24);
+
+static void BM_DecodeRepliesBatch(benchmark::State& state) {
+  SampleCycle cycle(state.range(0));
+  ReplyDecoder decoder;
+  decoder.configure({cycle.commands.data(), cycle.commands.size()});
+  for (auto _ : state) {
+    const size_t nb_replies =
+        decoder.decode(cycle.frames.data(), cycle.frames.size(),
+                       {cycle.replies.data(), cycle.replies.size()});
+    benchmark::DoNotOptimize(nb_replies);
+    benchmark::DoNotOptimize(cycle.replies.data());
+  }
+  state.SetItemsProcessed(state.iterations() * cycle.frames.size());
+}
+BENCHMARK(BM_DecodeRepliesBatch)->Arg(6)->Arg(12)->Arg(24);
+
+}  // namespace vulp::actuation::moteus
@@ -0,0 +1,171 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+#include "vulp/actuation/moteus/fixed_protocol.h"
+#include "vulp/actuation/moteus/protocol.h"
+
+/* @file
+ *
+ * Encoding and decoding throughput of the generic moteus protocol functions,
+ * for every register resolution. Benchmarks take resolutions as arguments,
+ * from 0 (int8) to 4 (ignored), and apply them to all registers of a frame.
+ */
+
+namespace vulp::actuation::moteus {
+
+namespace {
+
+//! Name of a resolution, used to label benchmarks.
+const char* resolution_name(Resolution res) {
+  switch (res) {
+    case Resolution::kInt8:
+      return "int8";
+    case Resolution::kInt16:
+      return "int16";
+    case Resolution::kInt32:
+      return "int32";
+    case Resolution::kFloat:
+      return "float";
+    case Resolution::kIgnore:
+      break;
+  }
+  return "ignore";
+}
+
+//! Position resolution with the same resolution for all registers.
+PositionResolution uniform_position_resolution(Resolution res) {
+  PositionResolution resolution;
+  resolution.position = res;
+  resolution.velocity = res;
+  resolution.feedforward_torque = res;
+  resolution.kp_scale = res;
+  resolution.kd_scale = res;
+  resolution.maximum_torque = res;
+  resolution.stop_position = res;
+  resolution.watchdog_timeout = res;
+  return resolution;
+}
+
+//! Query command with the same resolution for all registers.
+QueryCommand uniform_query(Resolution res) {
+  QueryCommand query;
+  query.mode = res;
+  query.position = res;
+  query.velocity = res;
+  query.torque = res;
+  query.q_current = res;
+  query.d_current = res;
+  query.rezero_state = res;
+  query.voltage = res;
+  query.temperature = res;
+  query.fault = res;
+  return query;
+}
+
+PositionCommand sample_position_command() {
+  PositionCommand command;
+  command.position = 0.123456;
+  command.velocity = -1.5;
+  command.feedforward_torque = 0.42;
+  command.kp_scale = 0.5;
+  command.kd_scale = 0.25;
+  command.maximum_torque = 16.0;
+  command.stop_position = 0.5;
+  command.watchdog_timeout = 0.1;
+  return command;
+}
+
+QueryResult sample_query_result() {
+  QueryResult result;
+  result.mode = Mode::kPosition;
+  result.position = 0.25;
+  result.velocity = -0.75;
+  result.torque = 1.5;
+  result.q_current = 2.0;
+  result.d_current = -0.1;
+  result.rezero_state = true;
+  result.voltage = 18.5;
+  result.temperature = 42.0;
+  result.fault = 0;
+  return result;
+}
+
+}  // namespace
+
+static void BM_EncodePositionCommand(benchmark::State& state) {
+  const auto position_res = static_cast<Resolution>(state.range(0));
+  const auto query_res = static_cast<Resolution>(state.range(1));
+  const PositionResolution resolution =
+      uniform_position_resolution(position_res);
+  const QueryCommand query = uniform_query(query_res);
+  const PositionCommand command = sample_position_command();
+  CanFrame frame;
+  for (auto _ : state) {
+    frame.size = 0;
+    WriteCanFrame writer(&frame);
+    EmitPositionCommand(&writer, command, resolution);
+    EmitQueryCommand(&writer, query);
+    benchmark::DoNotOptimize(frame);
+  }
+  state.SetBytesProcessed(state.iterations() * frame.size);
+  state.SetLabel(std::string(resolution_name(position_res)) + "/" +
+                 resolution_name(query_res));
+}
+BENCHMARK(BM_EncodePositionCommand)
+    ->ArgsProduct({{0, 1, 2, 3, 4}, {0, 1, 2, 3, 4}});
+
+static void BM_EncodeQueryResult(benchmark::State& state) {
+  const auto res = static_cast<Resolution>(state.range(0));
+  const QueryCommand query = uniform_query(res);
+  const QueryResult result = sample_query_result();
+  CanFrame frame;
+  for (auto _ : state) {
+    frame.size = 0;
+    WriteCanFrame writer(&frame);
+    EmitQueryResult(&writer, query, result);
+    benchmark::DoNotOptimize(frame);
+  }
+  state.SetBytesProcessed(state.iterations() * frame.size);
+  state.SetLabel(resolution_name(res));
+}
+BENCHMARK(BM_EncodeQueryResult)->DenseRange(0, 4);
+
+static void BM_DecodeQueryResult(benchmark::State& state) {
+  const auto res = static_cast<Resolution>(state.range(0));
+  const QueryCommand query = uniform_query(res);
+  CanFrame frame;
+  WriteCanFrame writer(&frame);
+  EmitQueryResult(&writer, query, sample_query_result());
+  for (auto _ : state) {
+    QueryResult result = ParseQueryResult(frame.data, frame.size);
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetBytesProcessed(state.iterations() * frame.size);
+  state.SetLabel(resolution_name(res));
+}
+BENCHMARK(BM_DecodeQueryResult)->DenseRange(0, 4);
+
+static void BM_DecodeQueryResultWithLayout(benchmark::State& state) {
+  const auto res = static_cast<Resolution>(state.range(0));
+  const QueryCommand query = uniform_query(res);
+  const QueryLayout layout = MakeQueryResultLayout(query);
+  CanFrame frame;
+  WriteCanFrame writer(&frame);
+  EmitQueryResult(&writer, query, sample_query_result());
+  for (auto _ : state) {
+    QueryResult result;
+    if (MatchesLayout(layout.frame, frame.data, frame.size)) {
+      result = ParseWithLayout(layout, frame.data);
+    }
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetBytesProcessed(state.iterations() * frame.size);
+  state.SetLabel(resolution_name(res));
+}
+BENCHMARK(BM_DecodeQueryResultWithLayout)->DenseRange(0, 4);
+
+}  // namespace vulp::actuation::moteus
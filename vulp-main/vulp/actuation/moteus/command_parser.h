@@ -0,0 +1,250 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include "vulp/actuation/moteus/Mode.h"
+#include "vulp/actuation/moteus/PositionResolution.h"
+#include "vulp/actuation/moteus/QueryCommand.h"
+#include "vulp/actuation/moteus/ServoCommand.h"
+#include "vulp/actuation/moteus/fixed_protocol.h"
+#include "vulp/actuation/moteus/protocol.h"
+
+namespace vulp::actuation::moteus {
+
+/*! Get the resolution of a write or read subframe.
+ *
+ * \param[in] cmd Multiplex command byte of the subframe.
+ *
+ * \return Resolution of the registers in the subframe.
+ */
+constexpr Resolution SubframeResolution(uint8_t cmd) {
+  switch ((cmd >> 2) & 0x03) {
+    case 0:
+      return Resolution::kInt8;
+    case 1:
+      return Resolution::kInt16;
+    case 2:
+      return Resolution::kInt32;
+    default:
+      break;
+  }
+  return Resolution::kFloat;
+}
+
+/*! Get a servo command where all registers are ignored.
+ *
+ * \return Stop command with no position register and an empty query.
+ */
+constexpr ServoCommand MakeIgnoredCommand() {
+  ServoCommand command;
+  command.resolution.position = Resolution::kIgnore;
+  command.resolution.velocity = Resolution::kIgnore;
+  command.resolution.feedforward_torque = Resolution::kIgnore;
+  command.resolution.kp_scale = Resolution::kIgnore;
+  command.resolution.kd_scale = Resolution::kIgnore;
+  command.resolution.maximum_torque = Resolution::kIgnore;
+  command.resolution.stop_position = Resolution::kIgnore;
+  command.resolution.watchdog_timeout = Resolution::kIgnore;
+  command.query.mode = Resolution::kIgnore;
+  command.query.position = Resolution::kIgnore;
+  command.query.velocity = Resolution::kIgnore;
+  command.query.torque = Resolution::kIgnore;
+  command.query.q_current = Resolution::kIgnore;
+  command.query.d_current = Resolution::kIgnore;
+  command.query.rezero_state = Resolution::kIgnore;
+  command.query.voltage = Resolution::kIgnore;
+  command.query.temperature = Resolution::kIgnore;
+  command.query.fault = Resolution::kIgnore;
+  return command;
+}
+
+/*! Decode the value of a written register into a servo command.
+ *
+ * \param[in] reg Register number.
+ * \param[in] data Frame data.
+ * \param[in] field Location of the register value in the frame.
+ * \param[in, out] command Servo command to update.
+ *
+ * Registers that are not part of position commands are skipped.
+ */
+inline void ParseWrittenRegister(uint32_t reg, const uint8_t* data,
+                                 const FieldLayout& field,
+                                 ServoCommand& command) {
+  PositionCommand& position = command.position;
+  PositionResolution& resolution = command.resolution;
+  switch (reg) {
+    case Register::kMode: {
+      command.mode =
+          static_cast<Mode>(MappedToInt(ReadField(data, field, kIntScaling)));
+      break;
+    }
+    case Register::kCommandPosition: {
+      position.position = ReadField(data, field, kPositionScaling);
+      resolution.position = field.resolution;
+      break;
+    }
+    case Register::kCommandVelocity: {
+      position.velocity = ReadField(data, field, kVelocityScaling);
+      resolution.velocity = field.resolution;
+      break;
+    }
+    case Register::kCommandFeedforwardTorque: {
+      position.feedforward_torque = ReadField(data, field, kTorqueScaling);
+      resolution.feedforward_torque = field.resolution;
+      break;
+    }
+    case Register::kCommandKpScale: {
+      position.kp_scale = ReadField(data, field, kPwmScaling);
+      resolution.kp_scale = field.resolution;
+      break;
+    }
+    case Register::kCommandKdScale: {
+      position.kd_scale = ReadField(data, field, kPwmScaling);
+      resolution.kd_scale = field.resolution;
+      break;
+    }
+    case Register::kCommandPositionMaxTorque: {
+      position.maximum_torque = ReadField(data, field, kTorqueScaling);
+      resolution.maximum_torque = field.resolution;
+      break;
+    }
+    case Register::kCommandStopPosition: {
+      position.stop_position = ReadField(data, field, kPositionScaling);
+      resolution.stop_position = field.resolution;
+      break;
+    }
+    case Register::kCommandTimeout: {
+      position.watchdog_timeout = ReadField(data, field, kTimeScaling);
+      resolution.watchdog_timeout = field.resolution;
+      break;
+    }
+    default: {
+      break;
+    }
+  }
+}
+
+/*! Record a read register into a query command.
+ *
+ * \param[in] reg Register number.
+ * \param[in] res Resolution requested for the register.
+ * \param[in, out] query Query command to update.
+ *
+ * Registers that are not part of query results are skipped.
+ */
+inline void ParseReadRegister(uint32_t reg, Resolution res,
+                              QueryCommand& query) {
+  switch (reg) {
+    case Register::kMode: {
+      query.mode = res;
+      break;
+    }
+    case Register::kPosition: {
+      query.position = res;
+      break;
+    }
+    case Register::kVelocity: {
+      query.velocity = res;
+      break;
+    }
+    case Register::kTorque: {
+      query.torque = res;
+      break;
+    }
+    case Register::kQCurrent: {
+      query.q_current = res;
+      break;
+    }
+    case Register::kDCurrent: {
+      query.d_current = res;
+      break;
+    }
+    case Register::kRezeroState: {
+      query.rezero_state = res;
+      break;
+    }
+    case Register::kVoltage: {
+      query.voltage = res;
+      break;
+    }
+    case Register::kTemperature: {
+      query.temperature = res;
+      break;
+    }
+    case Register::kFault: {
+      query.fault = res;
+      break;
+    }
+    default: {
+      break;
+    }
+  }
+}
+
+/*! Decode a command frame the way a moteus controller would.
+ *
+ * \param[in] data Frame data.
+ * \param[in] size Frame size in bytes.
+ *
+ * \return Servo command with the mode, position registers and query found in
+ *     the frame. Registers absent from the frame have the ignore resolution.
+ *     The servo identifier is not part of frame data and is left to zero.
+ *
+ * This function is the counterpart of \ref EmitPositionCommand, \ref
+ * EmitStopCommand and \ref EmitQueryCommand, and is meant to emulate servos.
+ * Parsing stops at the first malformed or unsupported subframe, keeping the
+ * registers decoded so far.
+ */
+inline ServoCommand ParseServoCommand(const uint8_t* data, size_t size) {
+  ServoCommand command = MakeIgnoredCommand();
+  size = std::min<size_t>(size, kMaxFrameSize);  // larger frames are not CAN-FD
+  size_t offset = 0;
+  while (offset < size) {
+    const uint8_t cmd = data[offset++];
+    if (cmd == Multiplex::kNop) {
+      continue;
+    }
+    if (cmd >= Multiplex::kReplyBase) {
+      break;  // not a write or read subframe
+    }
+    const bool is_write = (cmd < Multiplex::kReadBase);
+    const Resolution res = SubframeResolution(cmd);
+    size_t count = cmd & 0x03;
+    if (count == 0) {
+      if (offset >= size) {
+        break;
+      }
+      count = data[offset++];
+    }
+    if (offset >= size) {
+      break;
+    }
+    const uint8_t start_register = data[offset++];
+    if (start_register & 0x80) {
+      break;  // multi-byte register numbers are not used by vulp
+    }
+    if (!is_write) {
+      for (size_t i = 0; i < count; ++i) {
+        ParseReadRegister(start_register + i, res, command.query);
+      }
+      continue;
+    }
+    const size_t nb_bytes = ResolutionBytes(res);
+    if (offset + count * nb_bytes > size) {
+      break;
+    }
+    for (size_t i = 0; i < count; ++i) {
+      const FieldLayout field = {static_cast<uint8_t>(offset), res};
+      ParseWrittenRegister(start_register + i, data, field, command);
+      offset += nb_bytes;
+    }
+  }
+  return command;
+}
+
+}  // namespace vulp::actuation::moteus
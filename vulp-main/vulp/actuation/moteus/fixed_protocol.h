@@ -0,0 +1,650 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include "vulp/actuation/moteus/Mode.h"
+#include "vulp/actuation/moteus/PositionCommand.h"
+#include "vulp/actuation/moteus/PositionResolution.h"
+#include "vulp/actuation/moteus/QueryCommand.h"
+#include "vulp/actuation/moteus/QueryResult.h"
+#include "vulp/actuation/moteus/Resolution.h"
+#include "vulp/actuation/moteus/protocol.h"
+
+/* @file
+ *
+ * Encoders and decoders for moteus CAN-FD frames whose resolutions are known
+ * at compile time. Register groupings, byte offsets and scales are resolved
+ * by constexpr functions, so that encoding a frame boils down to copying a
+ * template and writing values at fixed offsets. Frames are bit-exact with
+ * those of the generic functions from protocol.h.
+ */
+
+namespace vulp::actuation::moteus {
+
+//! Maximum number of bytes in a CAN-FD frame.
+constexpr uint8_t kMaxFrameSize = 64;
+
+/*! Number of bytes used to encode a register at a given resolution.
+ *
+ * \param[in] res Register resolution.
+ *
+ * \return Size of the register value in bytes, zero if it is ignored.
+ */
+constexpr uint8_t ResolutionBytes(Resolution res) {
+  switch (res) {
+    case Resolution::kInt8:
+      return 1;
+    case Resolution::kInt16:
+      return 2;
+    case Resolution::kInt32:
+    case Resolution::kFloat:
+      return 4;
+    case Resolution::kIgnore:
+      break;
+  }
+  return 0;
+}
+
+//! Location of a register value in a frame.
+struct FieldLayout {
+  //! Offset of the value from the beginning of the frame, in bytes.
+  uint8_t offset = 0;
+
+  //! Resolution of the value.
+  Resolution resolution = Resolution::kIgnore;
+};
+
+/*! Template of a frame with fixed register groupings.
+ *
+ * The template holds all framing bytes (multiplex commands, counts and
+ * registers) at their final positions, with zeros in place of register values.
+ */
+struct FrameLayout {
+  //! Frame bytes, where only the framing bytes are set.
+  std::array<uint8_t, kMaxFrameSize> bytes = {};
+
+  //! Frame size in bytes.
+  uint8_t size = 0;
+
+  //! Offsets of framing bytes in the frame.
+  std::array<uint8_t, kMaxFrameSize> header_offsets = {};
+
+  //! Number of framing bytes in the frame.
+  uint8_t header_size = 0;
+
+  //! Append a framing byte to the template.
+  constexpr void AppendHeader(uint8_t byte) {
+    header_offsets[header_size++] = size;
+    bytes[size++] = byte;
+  }
+
+  /*! Reserve space for a register value.
+   *
+   * \return Location of the value in the frame.
+   */
+  constexpr FieldLayout AppendValue(Resolution res) {
+    FieldLayout field;
+    field.offset = size;
+    field.resolution = res;
+    size += ResolutionBytes(res);
+    return field;
+  }
+};
+
+/*! Lay out a sequence of consecutive registers in a frame.
+ *
+ * \param[in, out] frame Frame to append registers to.
+ * \param[in] base_command Multiplex base command (write, read or reply).
+ * \param[in] start_register First register of the sequence.
+ * \param[in] resolutions Resolutions of the registers in the sequence.
+ *
+ * \return Locations of register values in the frame.
+ *
+ * This function follows the same grouping heuristic as \ref WriteCombiner:
+ * consecutive registers with the same resolution are grouped in a single
+ * block, using the shorthand count formulation for blocks of up to three
+ * registers. Read commands only consist of framing bytes, whereas writes and
+ * replies are followed by register values.
+ */
+template <size_t N>
+constexpr std::array<FieldLayout, N> LayoutRegisters(
+    FrameLayout& frame, uint8_t base_command, uint8_t start_register,
+    const std::array<Resolution, N>& resolutions) {
+  std::array<FieldLayout, N> fields = {};
+  const bool has_values = (base_command != Multiplex::kReadBase);
+  Resolution current_resolution = Resolution::kIgnore;
+  for (size_t i = 0; i < N; ++i) {
+    const Resolution res = resolutions[i];
+    if (res != current_resolution && res != Resolution::kIgnore) {
+      size_t count = 1;
+      while (i + count < N && resolutions[i + count] == res) {
+        ++count;
+      }
+      const uint8_t command =
+          base_command + static_cast<uint8_t>(res) * uint8_t(0x04);
+      if (count <= 3) {
+        frame.AppendHeader(command + static_cast<uint8_t>(count));
+      } else {
+        frame.AppendHeader(command);
+        frame.AppendHeader(static_cast<uint8_t>(count));
+      }
+      frame.AppendHeader(static_cast<uint8_t>(start_register + i));
+    }
+    current_resolution = res;
+    if (has_values && res != Resolution::kIgnore) {
+      fields[i] = frame.AppendValue(res);
+    }
+  }
+  return fields;
+}
+
+//! Layout of a query, be it the command to a servo or its reply.
+struct QueryLayout {
+  //! Frame template of the query.
+  FrameLayout frame;
+
+  //! Location of the mode register.
+  FieldLayout mode;
+
+  //! Location of the position register.
+  FieldLayout position;
+
+  //! Location of the velocity register.
+  FieldLayout velocity;
+
+  //! Location of the torque register.
+  FieldLayout torque;
+
+  //! Location of the Q-phase current register.
+  FieldLayout q_current;
+
+  //! Location of the D-phase current register.
+  FieldLayout d_current;
+
+  //! Location of the rezero-state register.
+  FieldLayout rezero_state;
+
+  //! Location of the voltage register.
+  FieldLayout voltage;
+
+  //! Location of the temperature register.
+  FieldLayout temperature;
+
+  //! Location of the fault register.
+  FieldLayout fault;
+};
+
+/*! Append the layout of a query to a frame.
+ *
+ * \param[in, out] frame Frame to append the query to.
+ * \param[in] base_command Multiplex base command: 0x10 to lay out a query
+ *     command, 0x20 to lay out the corresponding reply.
+ * \param[in] query Query command.
+ *
+ * \return Locations of register values in the frame.
+ */
+constexpr QueryLayout AppendQueryLayout(FrameLayout& frame,
+                                        uint8_t base_command,
+                                        const QueryCommand& query) {
+  QueryLayout layout;
+  const auto first = LayoutRegisters<6>(
+      frame, base_command, Register::kMode,
+      {query.mode, query.position, query.velocity, query.torque,
+       query.q_current, query.d_current});
+  const auto second = LayoutRegisters<4>(
+      frame, base_command, Register::kRezeroState,
+      {query.rezero_state, query.voltage, query.temperature, query.fault});
+  layout.mode = first[0];
+  layout.position = first[1];
+  layout.velocity = first[2];
+  layout.torque = first[3];
+  layout.q_current = first[4];
+  layout.d_current = first[5];
+  layout.rezero_state = second[0];
+  layout.voltage = second[1];
+  layout.temperature = second[2];
+  layout.fault = second[3];
+  return layout;
+}
+
+/*! Compute the layout of a servo reply to a query command.
+ *
+ * \param[in] query Query command.
+ *
+ * \return Layout of the reply frame.
+ */
+constexpr QueryLayout MakeQueryResultLayout(const QueryCommand& query) {
+  FrameLayout frame;
+  QueryLayout layout = AppendQueryLayout(frame, 0x20, query);
+  layout.frame = frame;
+  return layout;
+}
+
+//! Layout of a position command followed by a query.
+struct PositionCommandLayout {
+  //! Frame template of the command.
+  FrameLayout frame;
+
+  //! Location of the target position register.
+  FieldLayout position;
+
+  //! Location of the target velocity register.
+  FieldLayout velocity;
+
+  //! Location of the feedforward torque register.
+  FieldLayout feedforward_torque;
+
+  //! Location of the proportional gain scale register.
+  FieldLayout kp_scale;
+
+  //! Location of the derivative gain scale register.
+  FieldLayout kd_scale;
+
+  //! Location of the maximum torque register.
+  FieldLayout maximum_torque;
+
+  //! Location of the stop position register.
+  FieldLayout stop_position;
+
+  //! Location of the watchdog timeout register.
+  FieldLayout watchdog_timeout;
+};
+
+/*! Compute the layout of a position command followed by a query.
+ *
+ * \param[in] resolution Resolution of position command registers.
+ * \param[in] query Query command appended to the position command.
+ *
+ * \return Layout of the command frame, equivalent to \ref EmitPositionCommand
+ *     followed by \ref EmitQueryCommand.
+ */
+constexpr PositionCommandLayout MakePositionCommandLayout(
+    const PositionResolution& resolution, const QueryCommand& query) {
+  FrameLayout frame;
+  frame.AppendHeader(Multiplex::kWriteInt8 | 0x01);
+  frame.AppendHeader(Register::kMode);
+  frame.AppendHeader(static_cast<uint8_t>(Mode::kPosition));
+  const auto fields = LayoutRegisters<8>(
+      frame, 0x00, Register::kCommandPosition,
+      {resolution.position, resolution.velocity, resolution.feedforward_torque,
+       resolution.kp_scale, resolution.kd_scale, resolution.maximum_torque,
+       resolution.stop_position, resolution.watchdog_timeout});
+  AppendQueryLayout(frame, 0x10, query);
+
+  PositionCommandLayout layout;
+  layout.frame = frame;
+  layout.position = fields[0];
+  layout.velocity = fields[1];
+  layout.feedforward_torque = fields[2];
+  layout.kp_scale = fields[3];
+  layout.kd_scale = fields[4];
+  layout.maximum_torque = fields[5];
+  layout.stop_position = fields[6];
+  layout.watchdog_timeout = fields[7];
+  return layout;
+}
+
+/*! Compute the layout of a stop command followed by a query.
+ *
+ * \param[in] query Query command appended to the stop command.
+ *
+ * \return Layout of the command frame, equivalent to \ref EmitStopCommand
+ *     followed by \ref EmitQueryCommand. It has no register value.
+ */
+constexpr FrameLayout MakeStopCommandLayout(const QueryCommand& query) {
+  FrameLayout frame;
+  frame.AppendHeader(Multiplex::kWriteInt8 | 0x01);
+  frame.AppendHeader(Register::kMode);
+  frame.AppendHeader(static_cast<uint8_t>(Mode::kStopped));
+  AppendQueryLayout(frame, 0x10, query);
+  return frame;
+}
+
+/*! Write a value at a fixed offset with a compile-time resolution.
+ *
+ * \param[out] data Pointer to the value in the frame.
+ * \param[in] value Value to write.
+ * \param[in] scaling Scales of the register for integer resolutions.
+ *
+ * Values are saturated the same way as in \ref WriteCanFrame::WriteMapped.
+ */
+template <Resolution Res>
+inline void WriteFixed(uint8_t* data, double value, const Scaling& scaling) {
+  static_assert(Res != Resolution::kIgnore, "Cannot write ignored register");
+  if constexpr (Res == Resolution::kInt8) {
+    const int8_t raw = Saturate<int8_t>(value, scaling.int8);
+    std::memcpy(data, &raw, sizeof(raw));
+  } else if constexpr (Res == Resolution::kInt16) {
+    const int16_t raw = Saturate<int16_t>(value, scaling.int16);
+    std::memcpy(data, &raw, sizeof(raw));
+  } else if constexpr (Res == Resolution::kInt32) {
+    const int32_t raw = Saturate<int32_t>(value, scaling.int32);
+    std::memcpy(data, &raw, sizeof(raw));
+  } else /* Res == Resolution::kFloat */ {
+    const float raw = static_cast<float>(value);
+    std::memcpy(data, &raw, sizeof(raw));
+  }
+}
+
+/*! Read a value at a fixed offset with a compile-time resolution.
+ *
+ * \param[in] data Pointer to the value in the frame.
+ * \param[in] scaling Scales of the register for integer resolutions.
+ *
+ * \return Decoded value, NaN for the reserved minimum of integer types.
+ *
+ * Values are decoded the same way as in \ref MultiplexParser::ReadMapped.
+ */
+template <Resolution Res>
+inline double ReadFixed(const uint8_t* data, const Scaling& scaling) {
+  static_assert(Res != Resolution::kIgnore, "Cannot read ignored register");
+  if constexpr (Res == Resolution::kFloat) {
+    float raw;
+    std::memcpy(&raw, data, sizeof(raw));
+    return raw;
+  } else {
+    using T = std::conditional_t<
+        Res == Resolution::kInt8, int8_t,
+        std::conditional_t<Res == Resolution::kInt16, int16_t, int32_t>>;
+    const double scale = (Res == Resolution::kInt8)    ? scaling.int8
+                         : (Res == Resolution::kInt16) ? scaling.int16
+                                                       : scaling.int32;
+    T raw;
+    std::memcpy(&raw, data, sizeof(raw));
+    if (raw == std::numeric_limits<T>::min()) {
+      return std::numeric_limits<double>::quiet_NaN();
+    }
+    return static_cast<double>(raw) * scale;
+  }
+}
+
+/*! Read a value at a fixed offset with a runtime resolution.
+ *
+ * \param[in] data Frame data.
+ * \param[in] field Location of the value in the frame.
+ * \param[in] scaling Scales of the register for integer resolutions.
+ *
+ * \return Decoded value, NaN for the reserved minimum of integer types.
+ */
+inline double ReadField(const uint8_t* data, const FieldLayout& field,
+                        const Scaling& scaling) {
+  switch (field.resolution) {
+    case Resolution::kInt8:
+      return ReadFixed<Resolution::kInt8>(data + field.offset, scaling);
+    case Resolution::kInt16:
+      return ReadFixed<Resolution::kInt16>(data + field.offset, scaling);
+    case Resolution::kInt32:
+      return ReadFixed<Resolution::kInt32>(data + field.offset, scaling);
+    case Resolution::kFloat:
+      return ReadFixed<Resolution::kFloat>(data + field.offset, scaling);
+    case Resolution::kIgnore:
+      break;
+  }
+  return 0.0;
+}
+
+/*! Check whether a frame matches a layout.
+ *
+ * \param[in] frame Expected frame layout.
+ * \param[in] data Frame data.
+ * \param[in] size Frame size in bytes.
+ *
+ * \return True if and only if the frame has the expected framing bytes,
+ *     with trailing bytes (such as CAN-FD padding) all being no-ops.
+ */
+inline bool MatchesLayout(const FrameLayout& frame, const uint8_t* data,
+                          size_t size) {
+  if (size < frame.size) {
+    return false;
+  }
+  for (uint8_t i = 0; i < frame.header_size; ++i) {
+    const uint8_t offset = frame.header_offsets[i];
+    if (data[offset] != frame.bytes[offset]) {
+      return false;
+    }
+  }
+  for (size_t offset = frame.size; offset < size; ++offset) {
+    if (data[offset] != Multiplex::kNop) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*! Decode a servo reply known to match a layout computed at runtime.
+ *
+ * \param[in] layout Layout of the reply, see \ref MakeQueryResultLayout.
+ * \param[in] data Frame data, checked beforehand by \ref MatchesLayout.
+ *
+ * \return Decoded query result, same as \ref ParseQueryResult.
+ */
+inline QueryResult ParseWithLayout(const QueryLayout& layout,
+                                   const uint8_t* data) {
+  QueryResult result;
+  if (layout.mode.resolution != Resolution::kIgnore) {
+    result.mode = static_cast<Mode>(
+        MappedToInt(ReadField(data, layout.mode, kIntScaling)));
+  }
+  if (layout.position.resolution != Resolution::kIgnore) {
+    result.position = ReadField(data, layout.position, kPositionScaling);
+  }
+  if (layout.velocity.resolution != Resolution::kIgnore) {
+    result.velocity = ReadField(data, layout.velocity, kVelocityScaling);
+  }
+  if (layout.torque.resolution != Resolution::kIgnore) {
+    result.torque = ReadField(data, layout.torque, kTorqueScaling);
+  }
+  if (layout.q_current.resolution != Resolution::kIgnore) {
+    result.q_current = ReadField(data, layout.q_current, kCurrentScaling);
+  }
+  if (layout.d_current.resolution != Resolution::kIgnore) {
+    result.d_current = ReadField(data, layout.d_current, kCurrentScaling);
+  }
+  if (layout.rezero_state.resolution != Resolution::kIgnore) {
+    const double rezero_state =
+        ReadField(data, layout.rezero_state, kIntScaling);
+    result.rezero_state = MappedToInt(rezero_state) != 0;
+  }
+  if (layout.voltage.resolution != Resolution::kIgnore) {
+    result.voltage = ReadField(data, layout.voltage, kVoltageScaling);
+  }
+  if (layout.temperature.resolution != Resolution::kIgnore) {
+    result.temperature =
+        ReadField(data, layout.temperature, kTemperatureScaling);
+  }
+  if (layout.fault.resolution != Resolution::kIgnore) {
+    result.fault = MappedToInt(ReadField(data, layout.fault, kIntScaling));
+  }
+  return result;
+}
+
+/*! Encoder for servo commands with compile-time resolutions.
+ *
+ * \tparam GetResolution Constexpr function returning the resolution of
+ *     position commands, for instance \ref get_position_resolution.
+ * \tparam GetQuery Constexpr function returning the query command appended
+ *     to every command, for instance \ref get_query_resolution.
+ *
+ * Frames are bit-exact with those of \ref EmitPositionCommand (or \ref
+ * EmitStopCommand) followed by \ref EmitQueryCommand.
+ */
+template <PositionResolution (*GetResolution)(), QueryCommand (*GetQuery)()>
+class FixedCommandEncoder {
+ public:
+  //! Resolution of position commands.
+  static constexpr PositionResolution kResolution = GetResolution();
+
+  //! Query command appended to commands.
+  static constexpr QueryCommand kQuery = GetQuery();
+
+  //! Layout of position command frames.
+  static constexpr PositionCommandLayout kPositionLayout =
+      MakePositionCommandLayout(kResolution, kQuery);
+
+  //! Layout of stop command frames.
+  static constexpr FrameLayout kStopLayout = MakeStopCommandLayout(kQuery);
+
+  static_assert(kPositionLayout.frame.size <= kMaxFrameSize,
+                "Position command does not fit in a CAN-FD frame");
+
+  /*! Check whether a servo command can be encoded by this encoder.
+   *
+   * \param[in] resolution Resolution of the position command.
+   * \param[in] query Query command of the servo.
+   */
+  static constexpr bool Supports(const PositionResolution& resolution,
+                                 const QueryCommand& query) {
+    return resolution == kResolution && query == kQuery;
+  }
+
+  /*! Encode a position command followed by the query.
+   *
+   * \param[in] command Position command.
+   * \param[out] data Frame data, at least 64 bytes long.
+   * \param[out] size Frame size in bytes.
+   */
+  static void EmitPosition(const PositionCommand& command, uint8_t* data,
+                           uint8_t* size) {
+    constexpr const PositionCommandLayout& L = kPositionLayout;
+    std::memcpy(data, L.frame.bytes.data(), L.frame.size);
+    Write<L.position.resolution>(data, L.position, command.position,
+                                 kPositionScaling);
+    Write<L.velocity.resolution>(data, L.velocity, command.velocity,
+                                 kVelocityScaling);
+    Write<L.feedforward_torque.resolution>(data, L.feedforward_torque,
+                                           command.feedforward_torque,
+                                           kTorqueScaling);
+    Write<L.kp_scale.resolution>(data, L.kp_scale, command.kp_scale,
+                                 kPwmScaling);
+    Write<L.kd_scale.resolution>(data, L.kd_scale, command.kd_scale,
+                                 kPwmScaling);
+    Write<L.maximum_torque.resolution>(data, L.maximum_torque,
+                                       command.maximum_torque, kTorqueScaling);
+    Write<L.stop_position.resolution>(data, L.stop_position,
+                                      command.stop_position, kPositionScaling);
+    Write<L.watchdog_timeout.resolution>(
+        data, L.watchdog_timeout, command.watchdog_timeout, kTimeScaling);
+    *size = L.frame.size;
+  }
+
+  /*! Encode a stop command followed by the query.
+   *
+   * \param[out] data Frame data, at least 64 bytes long.
+   * \param[out] size Frame size in bytes.
+   */
+  static void EmitStop(uint8_t* data, uint8_t* size) {
+    std::memcpy(data, kStopLayout.bytes.data(), kStopLayout.size);
+    *size = kStopLayout.size;
+  }
+
+ private:
+  //! Write a register value if its resolution is not ignored.
+  template <Resolution Res>
+  static void Write(uint8_t* data, const FieldLayout& field, double value,
+                    const Scaling& scaling) {
+    if constexpr (Res != Resolution::kIgnore) {
+      WriteFixed<Res>(data + field.offset, value, scaling);
+    }
+  }
+};
+
+/*! Decoder for servo replies with compile-time resolutions.
+ *
+ * \tparam GetQuery Constexpr function returning the query command servos
+ *     reply to, for instance \ref get_query_resolution.
+ *
+ * Frames that do not match the expected layout are decoded by the generic
+ * \ref ParseQueryResult function.
+ */
+template <QueryCommand (*GetQuery)()>
+class FixedQueryParser {
+ public:
+  //! Query command servos reply to.
+  static constexpr QueryCommand kQuery = GetQuery();
+
+  //! Layout of reply frames.
+  static constexpr QueryLayout kLayout = MakeQueryResultLayout(kQuery);
+
+  /*! Check whether a frame matches the expected reply layout.
+   *
+   * \param[in] data Frame data.
+   * \param[in] size Frame size in bytes.
+   *
+   * \return True if and only if the frame has the expected framing bytes,
+   *     with trailing bytes (such as CAN-FD padding) all being no-ops.
+   */
+  static bool Matches(const uint8_t* data, size_t size) {
+    return MatchesLayout(kLayout.frame, data, size);
+  }
+
+  /*! Decode a servo reply.
+   *
+   * \param[in] data Frame data.
+   * \param[in] size Frame size in bytes.
+   *
+   * \return Decoded query result, same as \ref ParseQueryResult.
+   */
+  static QueryResult Parse(const uint8_t* data, size_t size) {
+    if (!Matches(data, size)) {
+      return ParseQueryResult(data, size);
+    }
+    return ParseMatching(data);
+  }
+
+  /*! Decode a servo reply known to match the expected layout.
+   *
+   * \param[in] data Frame data.
+   *
+   * \return Decoded query result.
+   */
+  static QueryResult ParseMatching(const uint8_t* data) {
+    constexpr const QueryLayout& L = kLayout;
+    QueryResult result;
+    if constexpr (L.mode.resolution != Resolution::kIgnore) {
+      result.mode = static_cast<Mode>(MappedToInt(
+          ReadFixed<L.mode.resolution>(data + L.mode.offset, kIntScaling)));
+    }
+    Read<L.position.resolution>(data, L.position, kPositionScaling,
+                                result.position);
+    Read<L.velocity.resolution>(data, L.velocity, kVelocityScaling,
+                                result.velocity);
+    Read<L.torque.resolution>(data, L.torque, kTorqueScaling, result.torque);
+    Read<L.q_current.resolution>(data, L.q_current, kCurrentScaling,
+                                 result.q_current);
+    Read<L.d_current.resolution>(data, L.d_current, kCurrentScaling,
+                                 result.d_current);
+    if constexpr (L.rezero_state.resolution != Resolution::kIgnore) {
+      const double rezero_state = ReadFixed<L.rezero_state.resolution>(
+          data + L.rezero_state.offset, kIntScaling);
+      result.rezero_state = MappedToInt(rezero_state) != 0;
+    }
+    Read<L.voltage.resolution>(data, L.voltage, kVoltageScaling,
+                               result.voltage);
+    Read<L.temperature.resolution>(data, L.temperature, kTemperatureScaling,
+                                   result.temperature);
+    if constexpr (L.fault.resolution != Resolution::kIgnore) {
+      result.fault = MappedToInt(
+          ReadFixed<L.fault.resolution>(data + L.fault.offset, kIntScaling));
+    }
+    return result;
+  }
+
+ private:
+  //! Read a register value if its resolution is not ignored.
+  template <Resolution Res>
+  static void Read(const uint8_t* data, const FieldLayout& field,
+                   const Scaling& scaling, double& value) {
+    if constexpr (Res != Resolution::kIgnore) {
+      value = ReadFixed<Res>(data + field.offset, scaling);
+    }
+  }
+};
+
+}  // namespace vulp::actuation::moteus
@@ -0,0 +1,304 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "vulp/actuation/moteus/command_parser.h"
+#include "vulp/actuation/moteus/fixed_protocol.h"
+#include "vulp/actuation/moteus/protocol.h"
+
+/* @file
+ *
+ * Round-trip fuzz target for the moteus protocol. Each input is interpreted
+ * as a query command, a query result and a position command:
+ *
+ * - Arbitrary bytes are parsed as a reply frame and as a command frame, which
+ *   must not crash.
+ * - The query result is encoded then decoded, and decoded values must match
+ *   the original ones up to the register resolution.
+ * - Replies decoded by \ref ParseWithLayout must be identical to those
+ *   decoded by \ref ParseQueryResult.
+ * - Position commands followed by their query must either fit in a CAN-FD
+ *   frame, or be rejected by the frame writer. Frames that fit must decode
+ *   to the same mode, resolutions and query with \ref ParseServoCommand.
+ */
+
+namespace vulp::actuation::moteus {
+
+namespace {
+
+//! Consume fuzzer bytes, yielding zeros once the input is exhausted.
+class FuzzInput {
+ public:
+  FuzzInput(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+  //! Next input byte.
+  uint8_t byte() { return (offset_ < size_) ? data_[offset_++] : 0; }
+
+  //! Next register resolution.
+  Resolution resolution() { return static_cast<Resolution>(byte() % 5); }
+
+  //! Next register value, including special and out-of-range values.
+  double value() {
+    switch (byte() % 6) {
+      case 0:
+        return std::numeric_limits<double>::quiet_NaN();
+      case 1:
+        return (byte() & 1) ? std::numeric_limits<double>::infinity()
+                            : -std::numeric_limits<double>::infinity();
+      case 2: {
+        double raw = 0.0;
+        for (size_t i = 0; i < sizeof(raw); ++i) {
+          reinterpret_cast<uint8_t*>(&raw)[i] = byte();
+        }
+        return raw;
+      }
+      default: {
+        const int16_t raw = static_cast<int16_t>((byte() << 8) | byte());
+        return raw / 256.0;
+      }
+    }
+  }
+
+ private:
+  //! Input data.
+  const uint8_t* data_;
+
+  //! Input size in bytes.
+  size_t size_;
+
+  //! Offset of the next byte to consume.
+  size_t offset_ = 0;
+};
+
+//! Abort with a message, so that the fuzzer records the input.
+void check(bool condition, const char* message) {
+  if (!condition) {
+    std::fprintf(stderr, "Check failed: %s\n", message);
+    std::abort();
+  }
+}
+
+//! Check whether two decoded values are identical, NaNs included.
+bool same_value(double a, double b) {
+  return (std::isnan(a) && std::isnan(b)) || a == b;
+}
+
+/*! Check whether a decoded value matches the value that was encoded.
+ *
+ * \param[in] original Value before encoding.
+ * \param[in] decoded Value after decoding.
+ * \param[in] res Resolution of the register.
+ * \param[in] scaling Scales of the register for integer resolutions.
+ */
+bool matches_encoded(double original, double decoded, Resolution res,
+                     const Scaling& scaling) {
+  if (res == Resolution::kFloat) {
+    return same_value(static_cast<float>(original), decoded);
+  }
+  if (!std::isfinite(original)) {
+    return std::isnan(decoded);
+  }
+  const double scale = (res == Resolution::kInt8)    ? scaling.int8
+                       : (res == Resolution::kInt16) ? scaling.int16
+                                                     : scaling.int32;
+  const double max_raw = (res == Resolution::kInt8)
+                             ? std::numeric_limits<int8_t>::max()
+                         : (res == Resolution::kInt16)
+                             ? std::numeric_limits<int16_t>::max()
+                             : std::numeric_limits<int32_t>::max();
+  const double expected_raw =
+      std::fmax(-max_raw, std::fmin(max_raw, std::trunc(original / scale)));
+  return std::fabs(decoded / scale - expected_raw) < 1e-3;
+}
+
+//! Check that a reply decodes to the same result with both parsers.
+void check_same_results(const QueryResult& a, const QueryResult& b) {
+  check(a.mode == b.mode, "mode");
+  check(same_value(a.position, b.position), "position");
+  check(same_value(a.velocity, b.velocity), "velocity");
+  check(same_value(a.torque, b.torque), "torque");
+  check(same_value(a.q_current, b.q_current), "q_current");
+  check(same_value(a.d_current, b.d_current), "d_current");
+  check(a.rezero_state == b.rezero_state, "rezero_state");
+  check(same_value(a.voltage, b.voltage), "voltage");
+  check(same_value(a.temperature, b.temperature), "temperature");
+  check(a.fault == b.fault, "fault");
+}
+
+//! Arbitrary bytes parsed as a reply or command must not crash parsers.
+void fuzz_parse(const uint8_t* data, size_t size) {
+  const size_t frame_size = (size < kMaxFrameSize) ? size : kMaxFrameSize;
+  ParseQueryResult(data, frame_size);
+  ParseServoCommand(data, frame_size);
+}
+
+//! Encode then decode a query result.
+void fuzz_query_result(FuzzInput& input) {
+  QueryCommand query;
+  query.mode = input.resolution();
+  query.position = input.resolution();
+  query.velocity = input.resolution();
+  query.torque = input.resolution();
+  query.q_current = input.resolution();
+  query.d_current = input.resolution();
+  query.rezero_state = input.resolution();
+  query.voltage = input.resolution();
+  query.temperature = input.resolution();
+  query.fault = input.resolution();
+
+  QueryResult result;
+  const int nb_modes = static_cast<int>(Mode::kNumModes);
+  result.mode = static_cast<Mode>(input.byte() % nb_modes);
+  result.position = input.value();
+  result.velocity = input.value();
+  result.torque = input.value();
+  result.q_current = input.value();
+  result.d_current = input.value();
+  result.rezero_state = input.byte() & 1;
+  result.voltage = input.value();
+  result.temperature = input.value();
+  result.fault = input.byte() % 128;
+
+  CanFrame frame;
+  WriteCanFrame writer(&frame);
+  EmitQueryResult(&writer, query, result);
+  check(frame.size <= kMaxFrameSize, "reply fits in a CAN-FD frame");
+
+  const QueryLayout layout = MakeQueryResultLayout(query);
+  check(layout.frame.size == frame.size, "reply layout size");
+  check(MatchesLayout(layout.frame, frame.data, frame.size),
+        "reply matches its layout");
+
+  const QueryResult decoded = ParseQueryResult(frame.data, frame.size);
+  check_same_results(decoded, ParseWithLayout(layout, frame.data));
+
+  if (query.mode != Resolution::kIgnore) {
+    check(decoded.mode == result.mode, "mode round trip");
+  }
+  if (query.position != Resolution::kIgnore) {
+    check(matches_encoded(result.position, decoded.position, query.position,
+                          kPositionScaling),
+          "position round trip");
+  }
+  if (query.velocity != Resolution::kIgnore) {
+    check(matches_encoded(result.velocity, decoded.velocity, query.velocity,
+                          kVelocityScaling),
+          "velocity round trip");
+  }
+  if (query.torque != Resolution::kIgnore) {
+    check(matches_encoded(result.torque, decoded.torque, query.torque,
+                          kTorqueScaling),
+          "torque round trip");
+  }
+  if (query.q_current != Resolution::kIgnore) {
+    check(matches_encoded(result.q_current, decoded.q_current, query.q_current,
+                          kCurrentScaling),
+          "q_current round trip");
+  }
+  if (query.d_current != Resolution::kIgnore) {
+    check(matches_encoded(result.d_current, decoded.d_current, query.d_current,
+                          kCurrentScaling),
+          "d_current round trip");
+  }
+  if (query.rezero_state != Resolution::kIgnore) {
+    check(decoded.rezero_state == result.rezero_state,
+          "rezero_state round trip");
+  }
+  if (query.voltage != Resolution::kIgnore) {
+    check(matches_encoded(result.voltage, decoded.voltage, query.voltage,
+                          kVoltageScaling),
+          "voltage round trip");
+  }
+  if (query.temperature != Resolution::kIgnore) {
+    check(matches_encoded(result.temperature, decoded.temperature,
+                          query.temperature, kTemperatureScaling),
+          "temperature round trip");
+  }
+  if (query.fault != Resolution::kIgnore) {
+    check(decoded.fault == result.fault, "fault round trip");
+  }
+}
+
+//! Encode a position command followed by a query.
+void fuzz_position_command(FuzzInput& input) {
+  PositionResolution resolution;
+  resolution.position = input.resolution();
+  resolution.velocity = input.resolution();
+  resolution.feedforward_torque = input.resolution();
+  resolution.kp_scale = input.resolution();
+  resolution.kd_scale = input.resolution();
+  resolution.maximum_torque = input.resolution();
+  resolution.stop_position = input.resolution();
+  resolution.watchdog_timeout = input.resolution();
+
+  PositionCommand command;
+  command.position = input.value();
+  command.velocity = input.value();
+  command.feedforward_torque = input.value();
+  command.kp_scale = input.value();
+  command.kd_scale = input.value();
+  command.maximum_torque = input.value();
+  command.stop_position = input.value();
+  command.watchdog_timeout = input.value();
+
+  QueryCommand query;
+  query.mode = input.resolution();
+  query.position = input.resolution();
+  query.velocity = input.resolution();
+  query.torque = input.resolution();
+  query.q_current = input.resolution();
+  query.d_current = input.resolution();
+  query.rezero_state = input.resolution();
+  query.voltage = input.resolution();
+  query.temperature = input.resolution();
+  query.fault = input.resolution();
+
+  CanFrame frame;
+  WriteCanFrame writer(&frame);
+  try {
+    EmitPositionCommand(&writer, command, resolution);
+    EmitQueryCommand(&writer, query);
+  } catch (const std::runtime_error&) {
+    // Some resolution combinations do not fit in a frame, in which case the
+    // writer throws rather than overflowing its buffer
+    check(frame.size <= kMaxFrameSize, "writer stops at frame size");
+    return;
+  }
+
+  FrameLayout layout;
+  AppendQueryLayout(layout, Multiplex::kReadBase, query);
+  check(layout.size <= frame.size, "query layout size");
+  check(std::memcmp(layout.bytes.data(), frame.data + frame.size - layout.size,
+                    layout.size) == 0,
+        "query matches its layout");
+
+  const ServoCommand parsed = ParseServoCommand(frame.data, frame.size);
+  check(parsed.mode == Mode::kPosition, "command mode");
+  check(parsed.resolution == resolution, "command resolutions");
+  check(parsed.query == query, "command query");
+  if (resolution.position != Resolution::kIgnore) {
+    check(matches_encoded(command.position, parsed.position.position,
+                          resolution.position, kPositionScaling),
+          "position command round trip");
+  }
+}
+
+}  // namespace
+
+}  // namespace vulp::actuation::moteus
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  using vulp::actuation::moteus::FuzzInput;
+  vulp::actuation::moteus::fuzz_parse(data, size);
+  FuzzInput input(data, size);
+  vulp::actuation::moteus::fuzz_query_result(input);
+  vulp::actuation::moteus::fuzz_position_command(input);
+  return 0;
+}
@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <vector>
+
+/* @file
+ *
+ * Run a libFuzzer target as a regular test: each input from the corpus is
+ * fed to the target, followed by a fixed number of pseudo-random inputs.
+ *
+ * Usage: run_corpus [corpus_file_or_directory...]
+ */
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+namespace {
+
+//! Number of pseudo-random inputs run after the corpus.
+constexpr int kNbRandomInputs = 10000;
+
+//! Maximum size of pseudo-random inputs, in bytes.
+constexpr size_t kMaxRandomSize = 128;
+
+//! Feed the content of a file to the fuzz target.
+void run_file(const std::filesystem::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  const std::vector<uint8_t> input((std::istreambuf_iterator<char>(file)),
+                                   std::istreambuf_iterator<char>());
+  LLVMFuzzerTestOneInput(input.data(), input.size());
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int nb_files = 0;
+  for (int i = 1; i < argc; ++i) {
+    const std::filesystem::path path(argv[i]);
+    if (std::filesystem::is_directory(path)) {
+      for (const auto& entry : std::filesystem::directory_iterator(path)) {
+        if (entry.is_regular_file()) {
+          run_file(entry.path());
+          ++nb_files;
+        }
+      }
+    } else if (std::filesystem::is_regular_file(path)) {
+      run_file(path);
+      ++nb_files;
+    } else {
+      std::fprintf(stderr, "Corpus path not found: %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  std::mt19937 rng(42);  // fixed seed so that failures are reproducible
+  std::uniform_int_distribution<size_t> size_distribution(0, kMaxRandomSize);
+  std::uniform_int_distribution<int> byte_distribution(0, 255);
+  std::vector<uint8_t> input;
+  for (int i = 0; i < kNbRandomInputs; ++i) {
+    input.resize(size_distribution(rng));
+    for (auto& byte : input) {
+      byte = static_cast<uint8_t>(byte_distribution(rng));
+    }
+    LLVMFuzzerTestOneInput(input.data(), input.size());
+  }
+
+  std::printf("Ran %d corpus files and %d random inputs\n", nb_files,
+              kNbRandomInputs);
+  return 0;
+}
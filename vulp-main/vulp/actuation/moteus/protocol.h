@@ -16,6 +16,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <limits>
+#include <stdexcept>
 #include <tuple>
 
 #include "vulp/actuation/moteus/Data.h"
@@ -23,6 +24,7 @@
 #include "vulp/actuation/moteus/Output.h"
 #include "vulp/actuation/moteus/PositionCommand.h"
 #include "vulp/actuation/moteus/PositionResolution.h"
+#include "vulp/actuation/moteus/QueryCommand.h"
 #include "vulp/actuation/moteus/QueryResult.h"
 #include "vulp/actuation/moteus/Resolution.h"
 #include "vulp/actuation/moteus/ServoCommand.h"
@@ -122,6 +124,49 @@ enum Register : uint32_t {
   kRezero = 0x130,
 };
 
+/*! Scales of a register mapped to integers, for each integer resolution.
+ *
+ * A register value is divided by its scale before being saturated to an
+ * integer of the selected resolution, and multiplied by it when decoded.
+ */
+struct Scaling {
+  //! Scale applied to registers encoded as 8-bit integers.
+  double int8;
+
+  //! Scale applied to registers encoded as 16-bit integers.
+  double int16;
+
+  //! Scale applied to registers encoded as 32-bit integers.
+  double int32;
+};
+
+constexpr Scaling kIntScaling = {1.0, 1.0, 1.0};
+constexpr Scaling kPositionScaling = {0.01, 0.0001, 0.00001};
+constexpr Scaling kVelocityScaling = {0.1, 0.00025, 0.00001};
+constexpr Scaling kTorqueScaling = {0.5, 0.01, 0.001};
+constexpr Scaling kPwmScaling = {1.0 / 127.0, 1.0 / 32767.0,
+                                 1.0 / 2147483647.0};
+constexpr Scaling kVoltageScaling = {0.5, 0.1, 0.001};
+constexpr Scaling kTemperatureScaling = {1.0, 0.1, 0.001};
+constexpr Scaling kTimeScaling = {0.01, 0.001, 0.000001};
+constexpr Scaling kCurrentScaling = {1.0, 0.1, 0.001};
+
+/*! Convert a decoded register value to an integer.
+ *
+ * \param[in] value Decoded value, NaN if the register was unset.
+ *
+ * \return Value truncated to an integer, or the minimum integer if the value
+ *     is NaN or out of range.
+ */
+inline int MappedToInt(double value) {
+  constexpr double kMin = std::numeric_limits<int>::min();
+  constexpr double kMax = std::numeric_limits<int>::max();
+  if (!(kMin <= value && value <= kMax)) {
+    return std::numeric_limits<int>::min();
+  }
+  return static_cast<int>(value);
+}
+
 template <typename T>
 T Saturate(double value, double scale) {
   if (!std::isfinite(value)) {
@@ -195,32 +240,44 @@ class WriteCanFrame {
     }
   }
 
+  void WriteMapped(double value, const Scaling& scaling, Resolution res) {
+    WriteMapped(value, scaling.int8, scaling.int16, scaling.int32, res);
+  }
+
+  void WriteInt(int value, Resolution res) {
+    WriteMapped(value, kIntScaling, res);
+  }
+
   void WritePosition(double value, Resolution res) {
-    WriteMapped(value, 0.01, 0.0001, 0.00001, res);
+    WriteMapped(value, kPositionScaling, res);
   }
 
   void WriteVelocity(double value, Resolution res) {
-    WriteMapped(value, 0.1, 0.00025, 0.00001, res);
+    WriteMapped(value, kVelocityScaling, res);
   }
 
   void WriteTorque(double value, Resolution res) {
-    WriteMapped(value, 0.5, 0.01, 0.001, res);
+    WriteMapped(value, kTorqueScaling, res);
   }
 
   void WritePwm(double value, Resolution res) {
-    WriteMapped(value, 1.0 / 127.0, 1.0 / 32767.0, 1.0 / 2147483647.0, res);
+    WriteMapped(value, kPwmScaling, res);
   }
 
   void WriteVoltage(double value, Resolution res) {
-    WriteMapped(value, 0.5, 0.1, 0.001, res);
+    WriteMapped(value, kVoltageScaling, res);
   }
 
-  void WriteTemperature(float value, Resolution res) {
-    WriteMapped(value, 1.0, 0.1, 0.001, res);
+  void WriteTemperature(double value, Resolution res) {
+    WriteMapped(value, kTemperatureScaling, res);
   }
 
-  void WriteTime(float value, Resolution res) {
-    WriteMapped(value, 0.01, 0.001, 0.000001, res);
+  void WriteTime(double value, Resolution res) {
+    WriteMapped(value, kTimeScaling, res);
+  }
+
+  void WriteCurrent(double value, Resolution res) {
+    WriteMapped(value, kCurrentScaling, res);
   }
 
  private:
@@ -423,6 +480,10 @@ class MultiplexParser {
     return value;
   }
 
+  double ReadMapped(Resolution res, const Scaling& scaling) {
+    return ReadMapped(res, scaling.int8, scaling.int16, scaling.int32);
+  }
+
   double ReadMapped(Resolution res, double int8_scale, double int16_scale,
                     double int32_scale) {
     switch (res) {
@@ -446,39 +507,33 @@ class MultiplexParser {
   }
 
   int ReadInt(Resolution res) {
-    return static_cast<int>(ReadMapped(res, 1.0, 1.0, 1.0));
+    return MappedToInt(ReadMapped(res, kIntScaling));
   }
 
   double ReadPosition(Resolution res) {
-    return ReadMapped(res, 0.01, 0.0001, 0.00001);
+    return ReadMapped(res, kPositionScaling);
   }
 
   double ReadVelocity(Resolution res) {
-    return ReadMapped(res, 0.1, 0.00025, 0.00001);
+    return ReadMapped(res, kVelocityScaling);
   }
 
-  double ReadTorque(Resolution res) {
-    return ReadMapped(res, 0.5, 0.01, 0.001);
-  }
+  double ReadTorque(Resolution res) { return ReadMapped(res, kTorqueScaling); }
 
-  double ReadPwm(Resolution res) {
-    return ReadMapped(res, 1.0 / 127.0, 1.0 / 32767.0, 1.0 / 2147483647.0);
-  }
+  double ReadPwm(Resolution res) { return ReadMapped(res, kPwmScaling); }
 
   double ReadVoltage(Resolution res) {
-    return ReadMapped(res, 0.5, 0.1, 0.001);
+    return ReadMapped(res, kVoltageScaling);
   }
 
   double ReadTemperature(Resolution res) {
-    return ReadMapped(res, 1.0, 0.1, 0.001);
+    return ReadMapped(res, kTemperatureScaling);
   }
 
-  double ReadTime(Resolution res) {
-    return ReadMapped(res, 0.01, 0.001, 0.000001);
-  }
+  double ReadTime(Resolution res) { return ReadMapped(res, kTimeScaling); }
 
   double ReadCurrent(Resolution res) {
-    return ReadMapped(res, 1.0, 0.1, 0.001);
+    return ReadMapped(res, kCurrentScaling);
   }
 
   void Ignore(Resolution res) { offset_ += ResolutionSize(res); }
@@ -591,6 +646,66 @@ inline void EmitQueryCommand(WriteCanFrame* frame,
   }
 }
 
+/*! Encode the reply of a servo to a query command.
+ *
+ * \param[out] frame Frame to write the reply to.
+ * \param[in] command Query command the servo replies to.
+ * \param[in] result Register values of the servo.
+ *
+ * Registers are grouped the same way as in \ref EmitQueryCommand, which is
+ * how moteus controllers lay out their replies. This function is useful to
+ * emulate servos, for instance in tests.
+ */
+inline void EmitQueryResult(WriteCanFrame* frame, const QueryCommand& command,
+                            const QueryResult& result) {
+  {
+    WriteCombiner<6> combiner(frame, 0x20, Register::kMode,
+                              {
+                                  command.mode,
+                                  command.position,
+                                  command.velocity,
+                                  command.torque,
+                                  command.q_current,
+                                  command.d_current,
+                              });
+    if (combiner.MaybeWrite()) {
+      frame->WriteInt(static_cast<int>(result.mode), command.mode);
+    }
+    if (combiner.MaybeWrite()) {
+      frame->WritePosition(result.position, command.position);
+    }
+    if (combiner.MaybeWrite()) {
+      frame->WriteVelocity(result.velocity, command.velocity);
+    }
+    if (combiner.MaybeWrite()) {
+      frame->WriteTorque(result.torque, command.torque);
+    }
+    if (combiner.MaybeWrite()) {
+      frame->WriteCurrent(result.q_current, command.q_current);
+    }
+    if (combiner.MaybeWrite()) {
+      frame->WriteCurrent(result.d_current, command.d_current);
+    }
+  }
+  {
+    WriteCombiner<4> combiner(frame, 0x20, Register::kRezeroState,
+                              {command.rezero_state, command.voltage,
+                               command.temperature, command.fault});
+    if (combiner.MaybeWrite()) {
+      frame->WriteInt(result.rezero_state ? 1 : 0, command.rezero_state);
+    }
+    if (combiner.MaybeWrite()) {
+      frame->WriteVoltage(result.voltage, command.voltage);
+    }
+    if (combiner.MaybeWrite()) {
+      frame->WriteTemperature(result.temperature, command.temperature);
+    }
+    if (combiner.MaybeWrite()) {
+      frame->WriteInt(result.fault, command.fault);
+    }
+  }
+}
+
 inline QueryResult ParseQueryResult(const uint8_t* data, size_t size) {
   MultiplexParser parser(data, size);
 
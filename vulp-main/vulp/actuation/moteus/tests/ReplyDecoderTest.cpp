@@ -0,0 +1,166 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "vulp/actuation/moteus/ReplyDecoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "vulp/actuation/moteus/protocol.h"
+#include "vulp/actuation/resolution.h"
+
+namespace vulp::actuation::moteus {
+
+namespace {
+
+//! Received frame, laid out like mjbots::pi3hat::CanFrame.
+struct RxFrame {
+  uint32_t id = 0;
+  uint8_t data[64] = {};
+  uint8_t size = 0;
+};
+
+QueryResult sample_result(int servo_id) {
+  QueryResult result;
+  result.mode = Mode::kPosition;
+  result.position = 0.01 * servo_id;
+  result.velocity = -0.5;
+  result.torque = 0.25 * servo_id;
+  result.voltage = 18.5;
+  result.temperature = 40.0 + servo_id;
+  result.fault = 0;
+  return result;
+}
+
+RxFrame make_reply(int servo_id, const QueryCommand& query) {
+  RxFrame frame;
+  frame.id = static_cast<uint32_t>(servo_id << 8);
+  CanFrame can_frame;
+  WriteCanFrame writer(&can_frame);
+  EmitQueryResult(&writer, query, sample_result(servo_id));
+  std::copy(can_frame.data, can_frame.data + can_frame.size, frame.data);
+  frame.size = can_frame.size;
+  return frame;
+}
+
+void expect_same_result(const QueryResult& expected,
+                        const QueryResult& result) {
+  ASSERT_EQ(expected.mode, result.mode);
+  ASSERT_EQ(expected.rezero_state, result.rezero_state);
+  ASSERT_EQ(expected.fault, result.fault);
+  const auto expect_same = [](double a, double b) {
+    if (std::isnan(a)) {
+      ASSERT_TRUE(std::isnan(b));
+    } else {
+      ASSERT_DOUBLE_EQ(a, b);
+    }
+  };
+  expect_same(expected.position, result.position);
+  expect_same(expected.velocity, result.velocity);
+  expect_same(expected.torque, result.torque);
+  expect_same(expected.q_current, result.q_current);
+  expect_same(expected.d_current, result.d_current);
+  expect_same(expected.voltage, result.voltage);
+  expect_same(expected.temperature, result.temperature);
+}
+
+}  // namespace
+
+class ReplyDecoderTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    for (int servo_id : {1, 2, 3, 4, 5, 6}) {
+      ServoCommand command;
+      command.id = servo_id;
+      command.query = get_query_resolution();
+      commands_.push_back(command);
+    }
+    replies_.resize(commands_.size());
+    decoder_.configure({commands_.data(), commands_.size()});
+  }
+
+  //! Decode frames and return the number of replies.
+  size_t decode(const std::vector<RxFrame>& frames) {
+    return decoder_.decode(frames.data(), frames.size(),
+                           {replies_.data(), replies_.size()});
+  }
+
+  //! Expect the reply at a given index to be the decoding of a frame.
+  void expect_reply(size_t index, const RxFrame& frame) {
+    ASSERT_EQ(replies_[index].id, static_cast<int>(frame.id >> 8));
+    expect_same_result(ParseQueryResult(frame.data, frame.size),
+                       replies_[index].result);
+  }
+
+  std::vector<ServoCommand> commands_;
+  std::vector<ServoReply> replies_;
+  ReplyDecoder decoder_;
+};
+
+TEST_F(ReplyDecoderTest, SingleLayoutForDefaultQuery) {
+  ASSERT_EQ(decoder_.nb_layouts(), 1);
+}
+
+TEST_F(ReplyDecoderTest, DecodesAllReplies) {
+  std::vector<RxFrame> frames;
+  for (const auto& command : commands_) {
+    frames.push_back(make_reply(command.id, command.query));
+  }
+  ASSERT_EQ(decode(frames), commands_.size());
+  for (size_t i = 0; i < commands_.size(); ++i) {
+    expect_reply(i, frames[i]);
+  }
+}
+
+TEST_F(ReplyDecoderTest, ReorderedAndMissingReplies) {
+  const QueryCommand query = get_query_resolution();
+  std::vector<RxFrame> frames = {make_reply(5, query), make_reply(2, query),
+                                 make_reply(6, query)};
+  ASSERT_EQ(decode(frames), 3);
+  expect_reply(0, frames[0]);
+  expect_reply(1, frames[1]);
+  expect_reply(2, frames[2]);
+}
+
+TEST_F(ReplyDecoderTest, UnexpectedLayoutFallsBack) {
+  QueryCommand other_query;
+  other_query.position = Resolution::kFloat;
+  other_query.temperature = Resolution::kFloat;
+  std::vector<RxFrame> frames = {make_reply(3, other_query),
+                                 make_reply(42, get_query_resolution())};
+  std::fill(frames[0].data + frames[0].size, frames[0].data + 64,
+            Multiplex::kNop);
+  frames[0].size = 64;
+  ASSERT_EQ(decode(frames), 2);
+  expect_reply(0, frames[0]);
+  expect_reply(1, frames[1]);  // unknown servo
+}
+
+TEST_F(ReplyDecoderTest, DistinctQueries) {
+  commands_[1].query.q_current = Resolution::kFloat;
+  commands_[4].query.q_current = Resolution::kFloat;
+  decoder_.configure({commands_.data(), commands_.size()});
+  ASSERT_EQ(decoder_.nb_layouts(), 2);
+
+  std::vector<RxFrame> frames;
+  for (const auto& command : commands_) {
+    frames.push_back(make_reply(command.id, command.query));
+  }
+  ASSERT_EQ(decode(frames), commands_.size());
+  for (size_t i = 0; i < commands_.size(); ++i) {
+    expect_reply(i, frames[i]);
+  }
+}
+
+TEST_F(ReplyDecoderTest, RepliesAreBoundedByBuffer) {
+  std::vector<RxFrame> frames;
+  for (int i = 0; i < 10; ++i) {
+    frames.push_back(make_reply(1, get_query_resolution()));
+  }
+  ASSERT_EQ(decode(frames), replies_.size());
+}
+
+}  // namespace vulp::actuation::moteus
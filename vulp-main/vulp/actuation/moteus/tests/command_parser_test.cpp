@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "vulp/actuation/moteus/command_parser.h"
+
+#include <cmath>
+
+#include "gtest/gtest.h"
+#include "vulp/actuation/moteus/protocol.h"
+#include "vulp/actuation/resolution.h"
+
+namespace vulp::actuation::moteus {
+
+namespace {
+
+constexpr PositionResolution get_integer_resolution() {
+  PositionResolution resolution;
+  resolution.position = Resolution::kInt32;
+  resolution.velocity = Resolution::kInt32;
+  resolution.feedforward_torque = Resolution::kInt16;
+  resolution.kp_scale = Resolution::kInt16;
+  resolution.kd_scale = Resolution::kInt16;
+  resolution.maximum_torque = Resolution::kInt16;
+  resolution.stop_position = Resolution::kInt32;
+  resolution.watchdog_timeout = Resolution::kInt16;
+  return resolution;
+}
+
+PositionCommand sample_position_command() {
+  PositionCommand command;
+  command.position = 0.125;
+  command.velocity = -1.5;
+  command.feedforward_torque = 0.5;
+  command.kp_scale = 0.5;
+  command.kd_scale = 0.25;
+  command.maximum_torque = 16.0;
+  command.stop_position = 0.75;
+  command.watchdog_timeout = 0.1;
+  return command;
+}
+
+}  // namespace
+
+TEST(CommandParser, DefaultPositionCommand) {
+  const PositionCommand command = sample_position_command();
+  CanFrame frame;
+  WriteCanFrame writer(&frame);
+  EmitPositionCommand(&writer, command, get_position_resolution());
+  EmitQueryCommand(&writer, get_query_resolution());
+
+  const ServoCommand parsed = ParseServoCommand(frame.data, frame.size);
+  ASSERT_EQ(parsed.mode, Mode::kPosition);
+  ASSERT_EQ(parsed.resolution, get_position_resolution());
+  ASSERT_EQ(parsed.query, get_query_resolution());
+  ASSERT_FLOAT_EQ(parsed.position.position, command.position);
+  ASSERT_FLOAT_EQ(parsed.position.velocity, command.velocity);
+  ASSERT_FLOAT_EQ(parsed.position.kp_scale, command.kp_scale);
+  ASSERT_FLOAT_EQ(parsed.position.kd_scale, command.kd_scale);
+  ASSERT_FLOAT_EQ(parsed.position.maximum_torque, command.maximum_torque);
+}
+
+TEST(CommandParser, IntegerPositionCommand) {
+  const PositionCommand command = sample_position_command();
+  CanFrame frame;
+  WriteCanFrame writer(&frame);
+  EmitPositionCommand(&writer, command, get_integer_resolution());
+
+  const ServoCommand parsed = ParseServoCommand(frame.data, frame.size);
+  ASSERT_EQ(parsed.mode, Mode::kPosition);
+  ASSERT_EQ(parsed.resolution, get_integer_resolution());
+  ASSERT_FALSE(parsed.query.any_set());
+  ASSERT_NEAR(parsed.position.position, command.position, 1e-5);
+  ASSERT_NEAR(parsed.position.velocity, command.velocity, 1e-5);
+  ASSERT_NEAR(parsed.position.feedforward_torque, command.feedforward_torque,
+              0.01);
+  ASSERT_NEAR(parsed.position.kp_scale, command.kp_scale, 1e-4);
+  ASSERT_NEAR(parsed.position.kd_scale, command.kd_scale, 1e-4);
+  ASSERT_NEAR(parsed.position.maximum_torque, command.maximum_torque, 0.01);
+  ASSERT_NEAR(parsed.position.stop_position, command.stop_position, 1e-5);
+  ASSERT_NEAR(parsed.position.watchdog_timeout, command.watchdog_timeout,
+              1e-3);
+}
+
+TEST(CommandParser, StopCommand) {
+  CanFrame frame;
+  WriteCanFrame writer(&frame);
+  EmitStopCommand(&writer);
+  EmitQueryCommand(&writer, get_query_resolution());
+
+  const ServoCommand parsed = ParseServoCommand(frame.data, frame.size);
+  ASSERT_EQ(parsed.mode, Mode::kStopped);
+  ASSERT_EQ(parsed.resolution, MakeIgnoredCommand().resolution);
+  ASSERT_EQ(parsed.query, get_query_resolution());
+}
+
+TEST(CommandParser, SkipsPadding) {
+  CanFrame frame;
+  WriteCanFrame writer(&frame);
+  EmitStopCommand(&writer);
+  while (frame.size < 16) {
+    writer.Write<int8_t>(Multiplex::kNop);
+  }
+  const ServoCommand parsed = ParseServoCommand(frame.data, frame.size);
+  ASSERT_EQ(parsed.mode, Mode::kStopped);
+  ASSERT_FALSE(parsed.query.any_set());
+}
+
+TEST(CommandParser, TruncatedFrameKeepsDecodedRegisters) {
+  const PositionCommand command = sample_position_command();
+  CanFrame frame;
+  WriteCanFrame writer(&frame);
+  EmitPositionCommand(&writer, command, get_position_resolution());
+  EmitQueryCommand(&writer, get_query_resolution());
+
+  // Cut the frame in the middle of the position command block
+  const ServoCommand parsed = ParseServoCommand(frame.data, 8);
+  ASSERT_EQ(parsed.mode, Mode::kPosition);
+  ASSERT_EQ(parsed.resolution.position, Resolution::kIgnore);
+  ASSERT_FALSE(parsed.query.any_set());
+}
+
+}  // namespace vulp::actuation::moteus
@@ -0,0 +1,248 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "vulp/actuation/moteus/fixed_protocol.h"
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "vulp/actuation/moteus/protocol.h"
+#include "vulp/actuation/resolution.h"
+
+namespace vulp::actuation::moteus {
+
+namespace {
+
+constexpr double kNaN = std::numeric_limits<double>::quiet_NaN();
+
+constexpr PositionResolution get_integer_resolution() {
+  PositionResolution resolution;
+  resolution.position = Resolution::kInt32;
+  resolution.velocity = Resolution::kInt32;
+  resolution.feedforward_torque = Resolution::kInt16;
+  resolution.kp_scale = Resolution::kInt8;
+  resolution.kd_scale = Resolution::kInt8;
+  resolution.maximum_torque = Resolution::kInt16;
+  resolution.stop_position = Resolution::kInt32;
+  resolution.watchdog_timeout = Resolution::kInt16;
+  return resolution;
+}
+
+constexpr QueryCommand get_full_query() {
+  QueryCommand query;
+  query.mode = Resolution::kInt8;
+  query.position = Resolution::kFloat;
+  query.velocity = Resolution::kFloat;
+  query.torque = Resolution::kFloat;
+  query.q_current = Resolution::kFloat;
+  query.d_current = Resolution::kInt16;
+  query.rezero_state = Resolution::kInt8;
+  query.voltage = Resolution::kInt16;
+  query.temperature = Resolution::kInt16;
+  query.fault = Resolution::kInt8;
+  return query;
+}
+
+std::vector<PositionCommand> sample_position_commands() {
+  std::vector<PositionCommand> commands(4);
+  commands[1].position = 0.123456;
+  commands[1].velocity = -1.5;
+  commands[1].feedforward_torque = 0.42;
+  commands[1].kp_scale = 0.5;
+  commands[1].kd_scale = 0.25;
+  commands[1].maximum_torque = 16.0;
+  commands[1].stop_position = 0.5;
+  commands[1].watchdog_timeout = 0.1;
+  commands[2].position = kNaN;
+  commands[2].velocity = 1e9;  // saturates integer resolutions
+  commands[2].maximum_torque = -1e9;
+  commands[3].position = -42.0;
+  commands[3].kp_scale = 3.0;  // saturates int8 resolution
+  commands[3].stop_position = kNaN;
+  return commands;
+}
+
+std::vector<QueryResult> sample_query_results() {
+  std::vector<QueryResult> results(3);
+  results[1].mode = Mode::kPosition;
+  results[1].position = 0.25;
+  results[1].velocity = -0.75;
+  results[1].torque = 1.5;
+  results[1].q_current = 2.0;
+  results[1].d_current = -0.1;
+  results[1].rezero_state = true;
+  results[1].voltage = 18.5;
+  results[1].temperature = 42.0;
+  results[1].fault = 33;
+  results[2].mode = Mode::kFault;
+  results[2].position = -1e9;
+  results[2].velocity = 1e9;
+  return results;
+}
+
+void expect_same_value(double expected, double value) {
+  if (std::isnan(expected)) {
+    ASSERT_TRUE(std::isnan(value));
+  } else {
+    ASSERT_EQ(expected, value);
+  }
+}
+
+void expect_same_result(const QueryResult& expected,
+                        const QueryResult& result) {
+  ASSERT_EQ(expected.mode, result.mode);
+  expect_same_value(expected.position, result.position);
+  expect_same_value(expected.velocity, result.velocity);
+  expect_same_value(expected.torque, result.torque);
+  expect_same_value(expected.q_current, result.q_current);
+  expect_same_value(expected.d_current, result.d_current);
+  ASSERT_EQ(expected.rezero_state, result.rezero_state);
+  expect_same_value(expected.voltage, result.voltage);
+  expect_same_value(expected.temperature, result.temperature);
+  ASSERT_EQ(expected.fault, result.fault);
+}
+
+template <typename Encoder>
+void expect_bit_exact_position_commands() {
+  for (const auto& command : sample_position_commands()) {
+    CanFrame expected;
+    WriteCanFrame writer(&expected);
+    EmitPositionCommand(&writer, command, Encoder::kResolution);
+    EmitQueryCommand(&writer, Encoder::kQuery);
+
+    CanFrame frame;
+    Encoder::EmitPosition(command, frame.data, &frame.size);
+    ASSERT_EQ(frame.size, expected.size);
+    for (unsigned i = 0; i < frame.size; ++i) {
+      ASSERT_EQ(frame.data[i], expected.data[i]) << "at byte " << i;
+    }
+  }
+}
+
+template <typename Parser>
+void expect_bit_exact_query_results() {
+  for (const auto& result : sample_query_results()) {
+    CanFrame frame;
+    WriteCanFrame writer(&frame);
+    EmitQueryResult(&writer, Parser::kQuery, result);
+    ASSERT_TRUE(Parser::Matches(frame.data, frame.size));
+    expect_same_result(ParseQueryResult(frame.data, frame.size),
+                       Parser::Parse(frame.data, frame.size));
+  }
+}
+
+}  // namespace
+
+TEST(FixedProtocol, ReplyLayoutOfDefaultQuery) {
+  constexpr QueryLayout layout = MakeQueryResultLayout(get_query_resolution());
+
+  // mode (int16) + 3 x int32 + 3 x int8, plus two framing bytes per block
+  static_assert(layout.frame.size == 2 + 2 + 2 + 3 * 4 + 2 + 3);
+  ASSERT_EQ(layout.frame.header_size, 6);
+  ASSERT_EQ(layout.mode.offset, 2);
+  ASSERT_EQ(layout.position.offset, 6);
+  ASSERT_EQ(layout.velocity.offset, 10);
+  ASSERT_EQ(layout.torque.offset, 14);
+  ASSERT_EQ(layout.q_current.resolution, Resolution::kIgnore);
+  ASSERT_EQ(layout.voltage.offset, 20);
+  ASSERT_EQ(layout.fault.offset, 22);
+}
+
+TEST(FixedProtocol, LongFormBlocks) {
+  PositionResolution resolution;
+  resolution.position = Resolution::kInt16;
+  resolution.velocity = Resolution::kInt16;
+  resolution.feedforward_torque = Resolution::kInt16;
+  resolution.kp_scale = Resolution::kInt16;
+  resolution.kd_scale = Resolution::kInt16;
+  resolution.maximum_torque = Resolution::kIgnore;
+  resolution.stop_position = Resolution::kIgnore;
+  resolution.watchdog_timeout = Resolution::kIgnore;
+  QueryCommand query;
+  const PositionCommandLayout layout =
+      MakePositionCommandLayout(resolution, query);
+
+  // Mode write (3 bytes) then write int16 command, count and register
+  ASSERT_EQ(layout.frame.bytes[3], Multiplex::kWriteInt16);
+  ASSERT_EQ(layout.frame.bytes[4], 5);
+  ASSERT_EQ(layout.frame.bytes[5], Register::kCommandPosition);
+  ASSERT_EQ(layout.position.offset, 6);
+  ASSERT_EQ(layout.kd_scale.offset, 14);
+}
+
+TEST(FixedProtocol, DefaultPositionCommandsAreBitExact) {
+  using Encoder =
+      FixedCommandEncoder<get_position_resolution, get_query_resolution>;
+  expect_bit_exact_position_commands<Encoder>();
+}
+
+TEST(FixedProtocol, IntegerPositionCommandsAreBitExact) {
+  using Encoder = FixedCommandEncoder<get_integer_resolution, get_full_query>;
+  expect_bit_exact_position_commands<Encoder>();
+}
+
+TEST(FixedProtocol, StopCommandIsBitExact) {
+  using Encoder =
+      FixedCommandEncoder<get_position_resolution, get_query_resolution>;
+  CanFrame expected;
+  WriteCanFrame writer(&expected);
+  EmitStopCommand(&writer);
+  EmitQueryCommand(&writer, get_query_resolution());
+
+  CanFrame frame;
+  Encoder::EmitStop(frame.data, &frame.size);
+  ASSERT_EQ(frame.size, expected.size);
+  for (unsigned i = 0; i < frame.size; ++i) {
+    ASSERT_EQ(frame.data[i], expected.data[i]) << "at byte " << i;
+  }
+}
+
+TEST(FixedProtocol, EncoderSupports) {
+  using Encoder =
+      FixedCommandEncoder<get_position_resolution, get_query_resolution>;
+  ASSERT_TRUE(
+      Encoder::Supports(get_position_resolution(), get_query_resolution()));
+  ASSERT_FALSE(Encoder::Supports(get_integer_resolution(), get_full_query()));
+}
+
+TEST(FixedProtocol, DefaultQueryResultsAreBitExact) {
+  expect_bit_exact_query_results<FixedQueryParser<get_query_resolution>>();
+}
+
+TEST(FixedProtocol, FullQueryResultsAreBitExact) {
+  expect_bit_exact_query_results<FixedQueryParser<get_full_query>>();
+}
+
+TEST(FixedProtocol, PaddedReplyMatches) {
+  using Parser = FixedQueryParser<get_query_resolution>;
+  QueryResult result = sample_query_results()[1];
+  CanFrame frame;
+  WriteCanFrame writer(&frame);
+  EmitQueryResult(&writer, Parser::kQuery, result);
+  while (frame.size < 32) {
+    writer.Write<int8_t>(Multiplex::kNop);
+  }
+  ASSERT_TRUE(Parser::Matches(frame.data, frame.size));
+  expect_same_result(ParseQueryResult(frame.data, frame.size),
+                     Parser::Parse(frame.data, frame.size));
+}
+
+TEST(FixedProtocol, UnexpectedReplyFallsBack) {
+  using Parser = FixedQueryParser<get_query_resolution>;
+  QueryResult result = sample_query_results()[1];
+  CanFrame frame;
+  WriteCanFrame writer(&frame);
+  EmitQueryResult(&writer, get_full_query(), result);
+  ASSERT_FALSE(Parser::Matches(frame.data, frame.size));
+  expect_same_result(ParseQueryResult(frame.data, frame.size),
+                     Parser::Parse(frame.data, frame.size));
+
+  // Truncated replies fall back as well
+  ASSERT_FALSE(Parser::Matches(frame.data, 5));
+  expect_same_result(ParseQueryResult(frame.data, 5),
+                     Parser::Parse(frame.data, 5));
+}
+
+}  // namespace vulp::actuation::moteus
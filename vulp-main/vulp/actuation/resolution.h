@@ -13,9 +13,10 @@ namespace vulp::actuation {
  * \return Query resolution settings.
  *
  * For now these settings are common to all interfaces but we can easily turn
- * them into parameters.
+ * them into parameters. This function is constexpr so that reply decoders can
+ * be generated at compile time, see \ref moteus::FixedQueryParser.
  */
-inline actuation::moteus::QueryCommand get_query_resolution() {
+constexpr actuation::moteus::QueryCommand get_query_resolution() {
   using actuation::moteus::Resolution;
   actuation::moteus::QueryCommand query;
   query.mode = Resolution::kInt16;
@@ -36,9 +37,10 @@ inline actuation::moteus::QueryCommand get_query_resolution() {
  * \return Resolution settings.
  *
  * For now these settings are common to all interfaces but we can easily turn
- * them into parameters.
+ * them into parameters. This function is constexpr so that command encoders
+ * can be generated at compile time, see \ref moteus::FixedCommandEncoder.
  */
-inline actuation::moteus::PositionResolution get_position_resolution() {
+constexpr actuation::moteus::PositionResolution get_position_resolution() {
   using actuation::moteus::Resolution;
   actuation::moteus::PositionResolution resolution;
   resolution.position = Resolution::kFloat;
@@ -0,0 +1,103 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "vulp/actuation/BulletCamera.h"
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tools/cpp/runfiles/runfiles.h"
+
+namespace vulp::actuation {
+
+using bazel::tools::cpp::runfiles::Runfiles;
+
+class BulletCameraTest : public ::testing::Test {
+ protected:
+  //! Set up a new test fixture
+  void SetUp() override {
+    std::string error;
+    std::unique_ptr<Runfiles> runfiles(Runfiles::CreateForTest(&error));
+    ASSERT_NE(runfiles, nullptr);
+    urdf_path_ = runfiles->Rlocation("upkie_description/urdf/upkie.urdf");
+    params_.period = 2;
+    params_.width = 32;
+    params_.height = 24;
+  }
+
+  //! Time step in seconds
+  double dt_ = 1.0 / 1000.0;
+
+  //! Camera parameters
+  BulletCamera::Parameters params_;
+
+  //! Path to the robot URDF
+  std::string urdf_path_;
+};
+
+TEST_F(BulletCameraTest, TicksAreDecimated) {
+  BulletCamera camera(params_, dt_, urdf_path_, {});
+  ASSERT_TRUE(camera.tick());
+  ASSERT_FALSE(camera.tick());
+  ASSERT_TRUE(camera.tick());
+
+  params_.period = 0;
+  camera.reset(params_);
+  ASSERT_FALSE(camera.tick());
+  ASSERT_FALSE(camera.tick());
+}
+
+TEST_F(BulletCameraTest, RendersCapturedSnapshot) {
+  BulletCamera camera(params_, dt_, urdf_path_, {});
+  ASSERT_EQ(camera.latest_image(), nullptr);
+
+  const std::vector<int> joint_indices = {-1, 0};
+  const std::vector<double> joint_angles = {0.0, 0.1};
+  for (int cycle = 0; cycle < 3; ++cycle) {
+    if (camera.tick()) {
+      camera.capture(Eigen::Matrix4d::Identity(), joint_indices, joint_angles);
+    }
+  }
+
+  const BulletCameraImage* image = camera.latest_image();
+  ASSERT_NE(image, nullptr);
+  ASSERT_DOUBLE_EQ(image->time, 2 * dt_);
+  ASSERT_EQ(image->width, params_.width);
+  ASSERT_EQ(image->height, params_.height);
+  ASSERT_EQ(image->rgba.size(), 4 * params_.width * params_.height);
+}
+
+TEST_F(BulletCameraTest, ImagesHeldByReadersAreNotOverwritten) {
+  BulletCamera camera(params_, dt_, urdf_path_, {});
+  const std::vector<int> joint_indices;
+  const std::vector<double> joint_angles;
+  ASSERT_TRUE(camera.tick());
+  camera.capture(Eigen::Matrix4d::Identity(), joint_indices, joint_angles);
+  const BulletCameraImage* first_image = camera.latest_image();
+  ASSERT_NE(first_image, nullptr);
+  ASSERT_DOUBLE_EQ(first_image->time, 0.0);
+
+  // Render twice without reading, so that both other buffers get written
+  for (int capture = 0; capture < 2; ++capture) {
+    camera.tick();
+    ASSERT_TRUE(camera.tick());
+    camera.capture(Eigen::Matrix4d::Identity(), joint_indices, joint_angles);
+  }
+  ASSERT_DOUBLE_EQ(first_image->time, 0.0);
+
+  const BulletCameraImage* latest_image = camera.latest_image();
+  ASSERT_NE(latest_image, first_image);
+  ASSERT_DOUBLE_EQ(latest_image->time, 4 * dt_);
+  ASSERT_EQ(camera.latest_image(), latest_image);
+}
+
+TEST_F(BulletCameraTest, InvalidImageSize) {
+  params_.width = 0;
+  ASSERT_THROW(BulletCamera(params_, dt_, urdf_path_, {}),
+               std::invalid_argument);
+}
+
+}  // namespace vulp::actuation
@@ -2,9 +2,11 @@
 // Copyright 2022 Stéphane Caron
 // Copyright 2023 Inria
 
+#include <algorithm>
 #include <limits>
 #include <map>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -223,6 +225,58 @@ TEST_F(BulletInterfaceTest, ComputeJointFeedforwardTorque) {
   ASSERT_NEAR(right_wheel_reply.result.torque, 0.42, 1e-3);
 }
 
+TEST_F(BulletInterfaceTest, CommandsInAnyOrder) {
+  std::reverse(commands_.begin(), commands_.end());
+  for (auto& command : commands_) {
+    command.mode = moteus::Mode::kPosition;
+    command.position.position = std::numeric_limits<double>::quiet_NaN();
+    command.position.velocity = (command.id == 6) ? 1.0 : 0.0;  // left_wheel
+    command.position.maximum_torque = 1.0;
+  }
+  for (int i = 0; i < 3; ++i) {
+    interface_->cycle(data_, [](const moteus::Output& output) {});
+  }
+
+  const auto& servo_reply = interface_->servo_reply();
+  for (const auto& reply : replies_) {
+    const std::string& joint_name =
+        interface_->servo_layout().joint_name(reply.id);
+    ASSERT_EQ(reply.result.mode, moteus::Mode::kPosition);
+    ASSERT_DOUBLE_EQ(reply.result.velocity,
+                     servo_reply.at(joint_name).result.velocity);
+  }
+  ASSERT_GT(servo_reply.at("left_wheel").result.velocity, 0.1);
+  ASSERT_NEAR(servo_reply.at("right_wheel").result.velocity, 0.0, 1e-3);
+  ASSERT_THROW(interface_->compute_joint_torque("tail", 0.0, 0.0, 0.0, 1.0,
+                                                1.0, 1.0),
+               std::out_of_range);
+}
+
+TEST_F(BulletInterfaceTest, StopCommandsBrakeJoints) {
+  for (auto& command : data_.commands) {
+    command.mode = moteus::Mode::kPosition;
+    command.position.position = std::numeric_limits<double>::quiet_NaN();
+    command.position.velocity = 1.0;  // rev/s
+    command.position.maximum_torque = 1.0;
+  }
+  for (int i = 0; i < 10; ++i) {
+    interface_->cycle(data_, [](const moteus::Output& output) {});
+  }
+  ASSERT_GT(interface_->servo_reply().at("left_wheel").result.velocity, 0.1);
+
+  // Stopped joints switch back to velocity controllers with zero targets
+  for (auto& command : data_.commands) {
+    command.mode = moteus::Mode::kStopped;
+  }
+  for (int i = 0; i < 10; ++i) {
+    interface_->cycle(data_, [](const moteus::Output& output) {});
+  }
+  for (const auto& reply : replies_) {
+    ASSERT_EQ(reply.result.mode, moteus::Mode::kStopped);
+    ASSERT_NEAR(reply.result.velocity, 0.0, 1e-2);
+  }
+}
+
 TEST_F(BulletInterfaceTest, JointRepliesHaveTemperature) {
   interface_->cycle(data_, [](const moteus::Output& output) {});
   for (const auto& pair : interface_->servo_reply()) {
@@ -298,6 +352,102 @@ TEST_F(BulletInterfaceTest, MonitorContacts) {
   ASSERT_EQ(observation("bullet")("contact")("right_wheel_tire")
                 .get<int>("num_contact_points"),
             0);
+
+  // Wheels roll freely in the air, so that contact wrenches are zero
+  const auto& left_tire = observation("bullet")("contact")("left_wheel_tire");
+  ASSERT_DOUBLE_EQ(left_tire.get<double>("normal_force"), 0.0);
+  ASSERT_TRUE(left_tire.get<Eigen::Vector3d>("centroid").isZero());
+  ASSERT_TRUE(left_tire.get<Eigen::Vector3d>("force").isZero());
+  ASSERT_TRUE(left_tire.get<Eigen::Vector3d>("torque").isZero());
+}
+
+TEST_F(BulletInterfaceTest, ContactWrenchesOnFloor) {
+  std::string error;
+  std::unique_ptr<Runfiles> runfiles(Runfiles::CreateForTest(&error));
+  ASSERT_NE(runfiles, nullptr);
+  Dictionary config;
+  config("bullet")("gui") = false;
+  BulletInterface::Parameters params(config);
+  params.dt = dt_;
+  params.robot_urdf_path =
+      runfiles->Rlocation("upkie_description/urdf/upkie.urdf");
+  ServoLayout layout;
+  layout.add_servo(1, 1, "right_hip");
+  layout.add_servo(2, 1, "right_knee");
+  layout.add_servo(3, 1, "right_wheel");
+  layout.add_servo(4, 2, "left_hip");
+  layout.add_servo(5, 2, "left_knee");
+  layout.add_servo(6, 2, "left_wheel");
+  BulletInterface interface(layout, params);
+  config("bullet")("monitor")("contacts")("left_wheel_tire") = true;
+  config("bullet")("monitor")("contacts")("right_wheel_tire") = true;
+  config("bullet")("reset")("position_base_in_world") =
+      Eigen::Vector3d(0.0, 0.0, 0.6);
+  interface.reset(config);
+  for (auto& command : interface.commands()) {
+    command.mode = moteus::Mode::kPosition;
+    command.position.position = 0.0;
+    command.position.velocity = 0.0;
+    command.position.maximum_torque = 10.0;
+  }
+
+  // Let the robot land on its wheels, then average normal forces
+  constexpr int kNbLandingCycles = 200;
+  constexpr int kNbAveragedCycles = 100;
+  double average_normal_force = 0.0;
+  Dictionary observation;
+  for (int i = 0; i < kNbLandingCycles + kNbAveragedCycles; ++i) {
+    interface.cycle(interface.data(), [](const moteus::Output& output) {});
+    if (i >= kNbLandingCycles) {
+      interface.observe(observation);
+      for (const auto& tire : {"left_wheel_tire", "right_wheel_tire"}) {
+        average_normal_force +=
+            observation("bullet")("contact")(tire).get<double>(
+                "normal_force") /
+            kNbAveragedCycles;
+      }
+    }
+  }
+
+  const double weight = 9.81 * interface.compute_robot_mass();
+  ASSERT_GT(weight, 0.0);
+  ASSERT_NEAR(average_normal_force, weight, 0.25 * weight);
+  for (const auto& tire : {"left_wheel_tire", "right_wheel_tire"}) {
+    const auto& contact = observation("bullet")("contact")(tire);
+    ASSERT_GT(contact.get<int>("num_contact_points"), 0);
+    ASSERT_GT(contact.get<Eigen::Vector3d>("force").z(), 0.0);
+
+    // Contact points are on the floor, where the centroid is too
+    ASSERT_NEAR(contact.get<Eigen::Vector3d>("centroid").z(), 0.0, 1e-2);
+  }
+}
+
+TEST_F(BulletInterfaceTest, ContactPeriod) {
+  Dictionary config;
+  config("bullet")("contact_period") = 0;
+  ASSERT_THROW(interface_->reset(config), std::invalid_argument);
+
+  config("bullet")("contact_period") = 3;
+  config("bullet")("monitor")("contacts")("left_wheel_tire") = true;
+  config("bullet")("monitor")("contacts")("left_wheel") = true;
+  interface_->reset(config);
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_NO_THROW(
+        interface_->cycle(data_, [](const moteus::Output& output) {}));
+  }
+
+  Dictionary observation;
+  interface_->observe(observation);
+  ASSERT_TRUE(observation("bullet")("contact").has("left_wheel_tire"));
+  ASSERT_TRUE(observation("bullet")("contact").has("left_wheel"));
+}
+
+TEST_F(BulletInterfaceTest, UnknownContactLinkThrows) {
+  Dictionary config;
+  config("bullet")("monitor")("contacts")("left_wheel_tyre") = true;
+  ASSERT_THROW(interface_->reset(config), std::invalid_argument);
+  ASSERT_NO_THROW(
+      interface_->cycle(data_, [](const moteus::Output& output) {}));
 }
 
 TEST_F(BulletInterfaceTest, MonitorIMU) {
@@ -355,4 +505,198 @@ TEST_F(BulletInterfaceTest, MonitorBaseState) {
   ASSERT_NEAR(base_orientation.z(), 0.0, 1e-20);
 }
 
+TEST_F(BulletInterfaceTest, Substeps) {
+  Dictionary config;
+  config("bullet")("nb_substeps") = 4;
+  interface_->reset(config);
+
+  Dictionary observation;
+  interface_->cycle(data_, [](const moteus::Output& output) {});
+  interface_->cycle(data_, [](const moteus::Output& output) {});
+  interface_->observe(observation);
+
+  // Eight semi-implicit Euler steps of dt / 4 (see MonitorBaseState)
+  Eigen::Vector3d base_position = observation("bullet")("base")("position");
+  const double substep = dt_ / 4;
+  ASSERT_NEAR(base_position.z(), 36 * -9.81 * std::pow(substep, 2.0), 1e-6);
+}
+
+TEST_F(BulletInterfaceTest, SubstepsRecomputeTorques) {
+  Dictionary config;
+  config("bullet")("nb_substeps") = 8;
+  interface_->reset(config);
+  for (auto& command : data_.commands) {
+    command.mode = moteus::Mode::kPosition;
+    command.position.position = std::numeric_limits<double>::quiet_NaN();
+    command.position.velocity = 1.0;  // rev/s
+    command.position.maximum_torque = 1.0;
+  }
+  for (int i = 0; i < 100; ++i) {
+    interface_->cycle(data_, [](const moteus::Output& output) {});
+  }
+
+  // Wheels reach their target velocity without kinetic friction
+  const auto& right_wheel = interface_->servo_reply().at("right_wheel").result;
+  ASSERT_NEAR(right_wheel.velocity, 1.0, 5e-2);
+}
+
+TEST_F(BulletInterfaceTest, SubstepsReplyStartOfCycle) {
+  Dictionary config;
+  config("bullet")("nb_substeps") = 8;
+  interface_->reset(config);
+  for (auto& command : data_.commands) {
+    command.mode = moteus::Mode::kPosition;
+    command.position.position = std::numeric_limits<double>::quiet_NaN();
+    command.position.velocity = 1.0;  // rev/s
+    command.position.maximum_torque = 1.0;
+  }
+
+  // Joints are at rest at the beginning of the first cycle, although
+  // substeps accelerate them afterwards
+  interface_->cycle(data_, [](const moteus::Output& output) {});
+  for (const auto& reply : data_.replies) {
+    ASSERT_DOUBLE_EQ(reply.result.velocity, 0.0);
+  }
+  const auto& right_wheel = interface_->servo_reply().at("right_wheel").result;
+  ASSERT_DOUBLE_EQ(right_wheel.velocity, 0.0);
+
+  // Joints have moved by the beginning of the next cycle
+  interface_->cycle(data_, [](const moteus::Output& output) {});
+  ASSERT_GT(interface_->servo_reply().at("right_wheel").result.velocity, 0.0);
+}
+
+TEST_F(BulletInterfaceTest, ZeroSubstepsThrows) {
+  Dictionary config;
+  config("bullet")("nb_substeps") = 0;
+  ASSERT_THROW(interface_->reset(config), std::invalid_argument);
+  ASSERT_NO_THROW(
+      interface_->cycle(data_, [](const moteus::Output& output) {}));
+}
+
+TEST_F(BulletInterfaceTest, HeightScan) {
+  Dictionary config;
+  config("bullet")("height_scan")("nb_rows") = 3;
+  config("bullet")("height_scan")("nb_cols") = 4;
+  config("bullet")("height_scan")("ray_depth") = 1.5;
+  interface_->reset(config);
+  interface_->cycle(data_, [](const moteus::Output& output) {});
+
+  // There is no floor, so that all rays hit nothing
+  Dictionary observation;
+  interface_->observe(observation);
+  const auto height_scan =
+      observation("bullet")("height_scan").as<std::vector<double>>();
+  ASSERT_EQ(height_scan.size(), 12);
+  for (const double height : height_scan) {
+    ASSERT_DOUBLE_EQ(height, -1.5);
+  }
+
+  // Disabling the scan removes it from observations
+  config("bullet")("height_scan")("nb_rows") = 0;
+  interface_->reset(config);
+  interface_->observe(observation);
+  ASSERT_FALSE(observation("bullet").has("height_scan"));
+
+  config("bullet")("height_scan")("period") = 0;
+  ASSERT_THROW(interface_->reset(config), std::invalid_argument);
+}
+
+TEST_F(BulletInterfaceTest, CameraDisabledByDefault) {
+  ASSERT_EQ(interface_->camera_image(), nullptr);
+
+  // The camera is not created upon reset
+  Dictionary config;
+  config("bullet")("camera")("period") = 10;
+  ASSERT_NO_THROW(interface_->reset(config));
+  ASSERT_NO_THROW(
+      interface_->cycle(data_, [](const moteus::Output& output) {}));
+  ASSERT_EQ(interface_->camera_image(), nullptr);
+}
+
+TEST_F(BulletInterfaceTest, PerformanceProfiles) {
+  Dictionary config;
+  config("bullet")("profile") = "fast";
+  BulletInterface::Parameters params(config);
+  ASSERT_EQ(params.profile, "fast");
+  ASSERT_EQ(params.solver_iterations, 10);
+  ASSERT_TRUE(params.implicit_cylinders);
+  ASSERT_TRUE(params.sleeping_environment);
+  ASSERT_FALSE(params.self_collision);
+
+  // Explicit settings override those of the profile
+  config("bullet")("profile") = "accurate";
+  config("bullet")("solver_iterations") = 42;
+  params.configure(config);
+  ASSERT_EQ(params.solver_iterations, 42);
+  ASSERT_TRUE(params.self_collision);
+  ASSERT_FALSE(params.implicit_cylinders);
+
+  const int default_iterations = interface_->solver_iterations();
+  ASSERT_NO_THROW(interface_->reset(config));
+  ASSERT_NO_THROW(
+      interface_->cycle(data_, [](const moteus::Output& output) {}));
+  ASSERT_EQ(interface_->solver_iterations(), 42);
+
+  // Switching back restores the engine default rather than keeping 42
+  Dictionary default_config;
+  default_config("bullet")("profile") = "default";
+  ASSERT_NO_THROW(interface_->reset(default_config));
+  ASSERT_EQ(interface_->solver_iterations(), default_iterations);
+  ASSERT_GT(default_iterations, 0);
+}
+
+TEST_F(BulletInterfaceTest, UnknownProfileThrows) {
+  Dictionary config;
+  config("bullet")("profile") = "warp_speed";
+  ASSERT_THROW(BulletInterface::Parameters{config}, std::invalid_argument);
+  ASSERT_THROW(interface_->reset(config), std::invalid_argument);
+}
+
+TEST_F(BulletInterfaceTest, ResetRestoresJointAngles) {
+  for (const bool restore_snapshot : {true, false}) {
+    for (auto& command : data_.commands) {
+      command.mode = moteus::Mode::kPosition;
+      command.position.position = 0.1;  // rev
+      command.position.velocity = 0.0;
+      command.position.maximum_torque = 1.0;
+    }
+    for (int i = 0; i < 100; ++i) {
+      interface_->cycle(data_, [](const moteus::Output& output) {});
+    }
+    ASSERT_GT(interface_->servo_reply().at("left_knee").result.position,
+              0.01);
+
+    Dictionary config;
+    config("bullet")("restore_snapshot") = restore_snapshot;
+    interface_->reset(config);
+    for (auto& command : data_.commands) {
+      command.mode = moteus::Mode::kStopped;
+    }
+    interface_->cycle(data_, [](const moteus::Output& output) {});
+    for (const auto& reply : replies_) {
+      ASSERT_NEAR(reply.result.position, 0.0, 1e-6);
+    }
+  }
+}
+
+TEST_F(BulletInterfaceTest, ResetNoise) {
+  Dictionary config;
+  config("bullet")("reset")("position_base_in_world") =
+      Eigen::Vector3d(0.0, 0.0, 1.0);
+  config("bullet")("reset")("position_noise") = Eigen::Vector3d(0.1, 0.2, 0.);
+  config("bullet")("reset")("yaw_noise") = 0.5;
+
+  interface_->reset(config);
+  const Eigen::Matrix4d T = interface_->transform_base_to_world();
+  interface_->reset(config);
+  const Eigen::Matrix4d T_next = interface_->transform_base_to_world();
+
+  ASSERT_LE(std::abs(T(0, 3)), 0.1);
+  ASSERT_LE(std::abs(T(1, 3)), 0.2);
+  ASSERT_DOUBLE_EQ(T(2, 3), 1.0);
+  ASSERT_NEAR(T(2, 2), 1.0, 1e-7);  // only yaw is randomized
+  ASSERT_LE(std::abs(std::atan2(T(1, 0), T(0, 0))), 0.5);
+  ASSERT_FALSE(T.isApprox(T_next));
+}
+
 }  // namespace vulp::actuation
@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "vulp/actuation/BulletModelCache.h"
+
+#include <memory>
+#include <string>
+
+#include "RobotSimulator/b3RobotSimulatorClientAPI.h"
+#include "gtest/gtest.h"
+#include "tools/cpp/runfiles/runfiles.h"
+
+namespace vulp::actuation {
+
+using bazel::tools::cpp::runfiles::Runfiles;
+
+class BulletModelCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    std::string error;
+    std::unique_ptr<Runfiles> runfiles(Runfiles::CreateForTest(&error));
+    ASSERT_NE(runfiles, nullptr);
+    urdf_path_ = runfiles->Rlocation("upkie_description/urdf/upkie.urdf");
+
+    bullet_ = std::make_unique<b3RobotSimulatorClientAPI>();
+    ASSERT_TRUE(bullet_->connect(eCONNECT_DIRECT));
+    robot_ = bullet_->loadURDF(urdf_path_);
+    BulletModelCache::clear();
+  }
+
+  void TearDown() override { BulletModelCache::clear(); }
+
+  //! Path to the robot URDF
+  std::string urdf_path_;
+
+  //! Bullet client
+  std::unique_ptr<b3RobotSimulatorClientAPI> bullet_;
+
+  //! Robot identifier
+  int robot_;
+};
+
+TEST_F(BulletModelCacheTest, JointTable) {
+  const auto table =
+      BulletModelCache::joint_table(*bullet_, robot_, urdf_path_);
+  ASSERT_EQ(table->size(), bullet_->getNumJoints(robot_));
+  ASSERT_EQ(table->maximum_torque.size(), table->size());
+
+  b3JointInfo joint_info;
+  const int left_wheel = table->joint_index.at("left_wheel");
+  bullet_->getJointInfo(robot_, left_wheel, &joint_info);
+  ASSERT_EQ(std::string(joint_info.m_jointName), "left_wheel");
+  ASSERT_EQ(table->u_index[left_wheel], joint_info.m_uIndex);
+  ASSERT_DOUBLE_EQ(table->maximum_torque[left_wheel],
+                   joint_info.m_jointMaxForce);
+
+  const int imu = table->link_index.at("imu");
+  bullet_->getJointInfo(robot_, imu, &joint_info);
+  ASSERT_EQ(std::string(joint_info.m_linkName), "imu");
+}
+
+TEST_F(BulletModelCacheTest, TablesAreSharedUntilCleared) {
+  const auto table =
+      BulletModelCache::joint_table(*bullet_, robot_, urdf_path_);
+
+  // Another simulator loading the same model gets the same table
+  b3RobotSimulatorClientAPI other_bullet;
+  ASSERT_TRUE(other_bullet.connect(eCONNECT_DIRECT));
+  const int other_robot = other_bullet.loadURDF(urdf_path_);
+  ASSERT_EQ(BulletModelCache::joint_table(other_bullet, other_robot,
+                                          urdf_path_),
+            table);
+
+  BulletModelCache::clear();
+  const auto new_table =
+      BulletModelCache::joint_table(*bullet_, robot_, urdf_path_);
+  ASSERT_NE(new_table, table);
+  ASSERT_EQ(new_table->joint_index, table->joint_index);
+  other_bullet.disconnect();
+}
+
+}  // namespace vulp::actuation
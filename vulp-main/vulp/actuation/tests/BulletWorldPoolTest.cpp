@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "vulp/actuation/BulletWorldPool.h"
+
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "tools/cpp/runfiles/runfiles.h"
+
+namespace vulp::actuation {
+
+using bazel::tools::cpp::runfiles::Runfiles;
+
+class BulletWorldPoolTest : public ::testing::Test {
+ protected:
+  //! Set up a new test fixture
+  void SetUp() override {
+    layout_.add_servo(1, 1, "right_hip");
+    layout_.add_servo(2, 1, "right_knee");
+    layout_.add_servo(3, 1, "right_wheel");
+    layout_.add_servo(4, 2, "left_hip");
+    layout_.add_servo(5, 2, "left_knee");
+    layout_.add_servo(6, 2, "left_wheel");
+
+    std::string error;
+    std::unique_ptr<Runfiles> runfiles(Runfiles::CreateForTest(&error));
+    ASSERT_NE(runfiles, nullptr);
+
+    params_.dt = 1.0 / 1000.0;
+    params_.floor = false;  // wheels roll freely during testing
+    params_.robot_urdf_path =
+        runfiles->Rlocation("upkie_description/urdf/upkie.urdf");
+  }
+
+  //! Servo layout of each world
+  ServoLayout layout_;
+
+  //! Interface parameters of each world
+  BulletInterface::Parameters params_;
+};
+
+TEST_F(BulletWorldPoolTest, WorldsAreIndependent) {
+  BulletWorldPool pool(layout_, params_, 3);
+  ASSERT_EQ(pool.size(), 3);
+
+  for (auto& command : pool.world(1).commands()) {
+    command.mode = moteus::Mode::kPosition;
+    command.position.position = std::numeric_limits<double>::quiet_NaN();
+    command.position.velocity = 1.0;  // rev/s
+    command.position.maximum_torque = 1.0;
+  }
+  for (int i = 0; i < 20; ++i) {
+    pool.step_all();
+  }
+
+  for (size_t index = 0; index < pool.size(); ++index) {
+    ASSERT_EQ(pool.output(index).query_result_size, layout_.size());
+    const auto& left_wheel = pool.world(index).servo_reply().at("left_wheel");
+    if (index == 1) {
+      ASSERT_GT(left_wheel.result.velocity, 0.1);
+    } else {
+      ASSERT_NEAR(left_wheel.result.velocity, 0.0, 1e-3);
+    }
+  }
+  ASSERT_TRUE(pool.world(0).transform_base_to_world().isApprox(
+      pool.world(2).transform_base_to_world()));
+}
+
+TEST_F(BulletWorldPoolTest, ResetSubset) {
+  BulletWorldPool pool(layout_, params_, 3);
+  for (int i = 0; i < 20; ++i) {
+    pool.step_all();
+  }
+  pool.reset_subset({0, 2}, Dictionary{});
+
+  // Worlds fall freely, except those that were just reset
+  ASSERT_DOUBLE_EQ(pool.world(0).transform_base_to_world()(2, 3), 0.0);
+  ASSERT_LT(pool.world(1).transform_base_to_world()(2, 3), -1e-3);
+  ASSERT_DOUBLE_EQ(pool.world(2).transform_base_to_world()(2, 3), 0.0);
+}
+
+TEST_F(BulletWorldPoolTest, InvalidArguments) {
+  ASSERT_THROW(BulletWorldPool(layout_, params_, 0), std::invalid_argument);
+
+  BulletWorldPool pool(layout_, params_, 2);
+  ASSERT_THROW(pool.world(2), std::out_of_range);
+  ASSERT_THROW(pool.reset_subset({0, 2}, Dictionary{}), std::out_of_range);
+  ASSERT_THROW(pool.reset_subset({1, 1}, Dictionary{}),
+               std::invalid_argument);
+
+  params_.gui = true;
+  ASSERT_THROW(BulletWorldPool(layout_, params_, 1), std::invalid_argument);
+}
+
+TEST_F(BulletWorldPoolTest, StepErrorsReachCaller) {
+  BulletWorldPool pool(layout_, params_, 4);
+  pool.world(3).commands()[0].mode = moteus::Mode::kVoltage;
+  ASSERT_THROW(pool.step_all(), std::runtime_error);
+
+  // The pool is still usable afterwards
+  pool.world(3).commands()[0].mode = moteus::Mode::kStopped;
+  ASSERT_NO_THROW(pool.step_all());
+}
+
+}  // namespace vulp::actuation
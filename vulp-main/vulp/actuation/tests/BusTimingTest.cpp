@@ -0,0 +1,174 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "vulp/actuation/BusTiming.h"
+
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "vulp/actuation/QueryDecimator.h"
+#include "vulp/actuation/resolution.h"
+#include "vulp/actuation/tests/coffee_machine_layout.h"
+
+namespace vulp::actuation {
+
+TEST(BusTiming, DataLengths) {
+  ASSERT_EQ(can_fd_data_length(0), 0);
+  ASSERT_EQ(can_fd_data_length(8), 8);
+  ASSERT_EQ(can_fd_data_length(9), 12);
+  ASSERT_EQ(can_fd_data_length(17), 20);
+  ASSERT_EQ(can_fd_data_length(25), 32);
+  ASSERT_EQ(can_fd_data_length(33), 48);
+  ASSERT_EQ(can_fd_data_length(49), 64);
+  ASSERT_EQ(can_fd_data_length(64), 64);
+  ASSERT_THROW(can_fd_data_length(65), std::out_of_range);
+}
+
+TEST(BusTiming, FrameDuration) {
+  CanBitrates bitrates;
+  const double empty = can_fd_frame_duration(0, bitrates);
+  const double full = can_fd_frame_duration(64, bitrates);
+  ASSERT_GT(empty, 0.0);
+  ASSERT_GT(full, empty);
+
+  // Padded payloads take as long as the frame they are padded to
+  ASSERT_DOUBLE_EQ(can_fd_frame_duration(49, bitrates), full);
+
+  // A 64-byte frame at 1 Mbps / 5 Mbps takes about 200 us
+  ASSERT_GT(full, 150e-6);
+  ASSERT_LT(full, 250e-6);
+
+  // Without bitrate switching, everything goes at the nominal bitrate
+  bitrates.bitrate_switch = false;
+  ASSERT_GT(can_fd_frame_duration(64, bitrates), 3 * full);
+}
+
+TEST(BusTiming, DefaultFrameSizes) {
+  const auto sizes =
+      compute_frame_sizes(get_position_resolution(), get_query_resolution());
+  ASSERT_EQ(sizes.reply_payload, 23);
+  ASSERT_EQ(sizes.reply_length, 24);
+  ASSERT_LE(sizes.command_payload, sizes.command_length);
+  ASSERT_LE(sizes.command_length, 64);
+}
+
+TEST(BusTiming, AggregatePerBus) {
+  const ServoLayout layout = get_coffee_machine_layout();
+  const BusTiming timing(layout, get_position_resolution(),
+                         get_query_resolution());
+  const auto& sizes = timing.frame_sizes();
+  size_t nb_servos = 0;
+  for (const auto& bus_load : timing.bus_loads()) {
+    const BusLoad& load = bus_load.second;
+    ASSERT_EQ(load.tx_bytes, load.nb_servos * sizes.command_length);
+    ASSERT_EQ(load.rx_bytes, load.nb_servos * sizes.reply_length);
+    ASSERT_LE(load.duration, timing.cycle_duration());
+    nb_servos += load.nb_servos;
+  }
+  ASSERT_EQ(nb_servos, layout.size());
+  ASSERT_GT(timing.max_frequency(), 1000.0);  // pi3hat spines run at 1 kHz
+}
+
+TEST(BusTiming, SlowerBusDominates) {
+  ServoLayout layout;
+  layout.add_servo(1, 1, "left");
+  layout.add_servo(2, 2, "right");
+  CanBitrates slow_bitrates;
+  slow_bitrates.data = 2e6;
+  const BusTiming timing(layout, get_position_resolution(),
+                         get_query_resolution(), {{2, slow_bitrates}});
+  const auto& loads = timing.bus_loads();
+  ASSERT_GT(loads.at(2).duration, loads.at(1).duration);
+  ASSERT_DOUBLE_EQ(timing.cycle_duration(), loads.at(2).duration);
+}
+
+TEST(BusTiming, ImbalancedLayout) {
+  ServoLayout layout;
+  layout.add_servo(1, 1, "left_hip");
+  layout.add_servo(2, 1, "left_knee");
+  layout.add_servo(3, 1, "left_wheel");
+  layout.add_servo(4, 2, "right_hip");
+  const BusTiming timing(layout, get_position_resolution(),
+                         get_query_resolution());
+  ASSERT_EQ(timing.busiest_bus(), 1);
+  ASSERT_DOUBLE_EQ(timing.balanced_cycle_duration(),
+                   0.5 * (timing.bus_loads().at(1).duration +
+                          timing.bus_loads().at(2).duration));
+  ASSERT_DOUBLE_EQ(timing.imbalance(), 1.5);
+
+  const BusTiming balanced(get_coffee_machine_layout(),
+                           get_position_resolution(), get_query_resolution());
+  ASSERT_DOUBLE_EQ(balanced.imbalance(), 1.0);
+
+  // All servos on one of two available buses (6 + 0)
+  ServoLayout single_bus_layout;
+  for (int servo_id = 1; servo_id <= 6; ++servo_id) {
+    single_bus_layout.add_servo(servo_id, 1,
+                                "joint_" + std::to_string(servo_id));
+  }
+  const std::map<int, CanBitrates> two_buses = {{1, CanBitrates()},
+                                                {2, CanBitrates()}};
+  const BusTiming single_bus(single_bus_layout, get_position_resolution(),
+                             get_query_resolution(), two_buses);
+  ASSERT_EQ(single_bus.busiest_bus(), 1);
+  ASSERT_DOUBLE_EQ(single_bus.balanced_cycle_duration(),
+                   0.5 * single_bus.cycle_duration());
+  ASSERT_DOUBLE_EQ(single_bus.imbalance(), 2.0);
+
+  // Available buses are the union of layout buses and configured ones: bus 2
+  // has no bitrate entry and bus 3 has no servo (6 + 0 + 0)
+  const BusTiming disjoint_buses(single_bus_layout, get_position_resolution(),
+                                 get_query_resolution(),
+                                 {{2, CanBitrates()}, {3, CanBitrates()}});
+  ASSERT_DOUBLE_EQ(disjoint_buses.imbalance(), 3.0);
+
+    // Without bitrates, only buses of the layout are available
+  const BusTiming single_bus_only(single_bus_layout, get_position_resolution(),
+                                  get_query_resolution());
+  ASSERT_DOUBLE_EQ(single_bus_only.imbalance(), 1.0);
+
+  const BusTiming empty(ServoLayout(), get_position_resolution(),
+                        get_query_resolution());
+  ASSERT_EQ(empty.busiest_bus(), 0);
+  ASSERT_DOUBLE_EQ(empty.imbalance(), 1.0);
+}
+
+TEST(BusTiming, DecimatedCycleDuration) {
+  const ServoLayout layout = get_coffee_machine_layout();
+  const BusTiming full(layout, get_position_resolution(),
+                       get_query_resolution());
+  const BusTiming fast(layout, get_position_resolution(),
+                       get_fast_query_resolution());
+  ASSERT_LT(fast.cycle_duration(), full.cycle_duration());
+
+  // Without decimation, all cycles send the full query
+  ASSERT_DOUBLE_EQ(decimated_cycle_duration(full, fast, 0),
+                   full.cycle_duration());
+  ASSERT_DOUBLE_EQ(decimated_cycle_duration(full, fast, 1),
+                   full.cycle_duration());
+
+  // Slow fields are spread over the decimation period
+  const int bus = full.busiest_bus();
+  const double fast_duration = fast.bus_loads().at(bus).duration;
+  const double full_duration = full.bus_loads().at(bus).duration;
+  ASSERT_DOUBLE_EQ(decimated_cycle_duration(full, fast, 4),
+                   fast_duration + 0.25 * (full_duration - fast_duration));
+  ASSERT_LT(decimated_cycle_duration(full, fast, 100),
+            decimated_cycle_duration(full, fast, 4));
+  ASSERT_GT(decimated_cycle_duration(full, fast, 100), fast.cycle_duration());
+}
+
+TEST(BusTiming, InterleaveBuses) {
+  // Busiest bus first, then buses in turn, keeping order within each bus
+  const std::vector<size_t> expected = {2, 0, 1, 3, 4, 5};
+  ASSERT_EQ(interleave_buses({1, 2, 3, 3, 1, 3}), expected);
+
+  const std::vector<size_t> identity = {0, 1, 2};
+  ASSERT_EQ(interleave_buses({4, 4, 4}), identity);
+  ASSERT_TRUE(interleave_buses({}).empty());
+}
+
+}  // namespace vulp::actuation
@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "vulp/actuation/CanCycleMetrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace vulp::actuation {
+
+TEST(WindowStatistics, EmptyIsNaN) {
+  const WindowStatistics statistics;
+  ASSERT_EQ(statistics.count(), 0);
+  ASSERT_TRUE(std::isnan(statistics.last()));
+  ASSERT_TRUE(std::isnan(statistics.mean()));
+  ASSERT_TRUE(std::isnan(statistics.max()));
+}
+
+TEST(WindowStatistics, SlidingWindow) {
+  WindowStatistics statistics(3);
+  statistics.add(1.0);
+  statistics.add(2.0);
+  ASSERT_EQ(statistics.count(), 2);  // window not full yet
+  ASSERT_DOUBLE_EQ(statistics.mean(), 1.5);
+  ASSERT_DOUBLE_EQ(statistics.max(), 2.0);
+
+  statistics.add(6.0);
+  statistics.add(100.0);
+  ASSERT_EQ(statistics.count(), 3);
+  ASSERT_DOUBLE_EQ(statistics.last(), 100.0);
+  ASSERT_DOUBLE_EQ(statistics.mean(), 36.0);
+  ASSERT_DOUBLE_EQ(statistics.max(), 100.0);
+
+  // The spike is reported until it leaves the window
+  statistics.add(0.0);
+  statistics.add(2.0);
+  ASSERT_DOUBLE_EQ(statistics.mean(), 34.0);
+  ASSERT_DOUBLE_EQ(statistics.max(), 100.0);
+  statistics.add(1.0);
+  ASSERT_DOUBLE_EQ(statistics.mean(), 1.0);
+  ASSERT_DOUBLE_EQ(statistics.max(), 2.0);
+}
+
+TEST(WindowStatistics, MatchesBruteForceWindow) {
+  constexpr size_t kWindow = 5;
+  WindowStatistics statistics(kWindow);
+  std::vector<double> samples;
+  for (int i = 0; i < 100; ++i) {
+    const double value = std::sin(0.7 * i) + 0.01 * i;
+    statistics.add(value);
+    samples.push_back(value);
+    const size_t count = std::min(samples.size(), kWindow);
+    const auto begin = samples.end() - count;
+    ASSERT_EQ(statistics.count(), count);
+    ASSERT_NEAR(statistics.mean(),
+                std::accumulate(begin, samples.end(), 0.0) / count, 1e-12);
+    ASSERT_DOUBLE_EQ(statistics.max(), *std::max_element(begin, samples.end()));
+  }
+}
+
+TEST(CanCycleMetrics, CompleteCycle) {
+  CanCycleMetrics metrics;
+  metrics.start_cycle(1e-6);
+  metrics.send_frame(1, true);
+  metrics.send_frame(2, true);
+  metrics.send_frame(3, false);
+  metrics.receive_reply(2);
+  metrics.receive_reply(1);
+  metrics.end_cycle(300e-6, false, false);
+  metrics.record_callback_delay(2e-6);
+
+  ASSERT_EQ(metrics.nb_cycles, 1);
+  ASSERT_EQ(metrics.tx_frames, 3);
+  ASSERT_EQ(metrics.rx_frames, 2);
+  ASSERT_EQ(metrics.expected_replies, 2);
+  ASSERT_EQ(metrics.nb_incomplete_cycles, 0);
+  ASSERT_EQ(metrics.nb_missing_replies, 0);
+  ASSERT_DOUBLE_EQ(metrics.transport_duration.last(), 300e-6);
+  ASSERT_DOUBLE_EQ(metrics.handoff_delay.last(), 1e-6);
+  ASSERT_DOUBLE_EQ(metrics.callback_delay.last(), 2e-6);
+}
+
+TEST(CanCycleMetrics, Snapshot) {
+  CanCycleMetrics metrics(2);
+  for (int cycle = 0; cycle < 3; ++cycle) {
+    metrics.start_cycle(0.0);
+    metrics.send_frame(1, true);
+    metrics.end_cycle(1e-4 * (cycle + 1), false, false);
+  }
+
+  const CanCycleSnapshot snapshot = metrics.snapshot();
+  ASSERT_EQ(snapshot.nb_cycles, 3);
+  ASSERT_EQ(snapshot.missing_reply_streak(1), 3);
+  ASSERT_EQ(snapshot.transport_duration.count, 2);
+  ASSERT_DOUBLE_EQ(snapshot.transport_duration.last, 3e-4);
+  ASSERT_DOUBLE_EQ(snapshot.transport_duration.mean, 2.5e-4);
+  ASSERT_DOUBLE_EQ(snapshot.transport_duration.max, 3e-4);
+  ASSERT_TRUE(std::isnan(snapshot.callback_delay.mean));
+}
+
+TEST(CanCycleMetrics, MissingReplyStreaks) {
+  CanCycleMetrics metrics;
+  for (int cycle = 0; cycle < 5; ++cycle) {
+    metrics.start_cycle(0.0);
+    metrics.send_frame(1, true);
+    metrics.send_frame(2, true);
+    metrics.receive_reply(1);
+    if (cycle == 4) {
+      metrics.receive_reply(2);
+    }
+    metrics.end_cycle(0.0, cycle == 0, cycle == 1);
+    ASSERT_EQ(metrics.missing_reply_streak(1), 0);
+  }
+  ASSERT_EQ(metrics.missing_reply_streak(2), 0);
+  ASSERT_EQ(metrics.max_missing_reply_streak, 4);
+  ASSERT_EQ(metrics.nb_missing_replies, 4);
+  ASSERT_EQ(metrics.nb_incomplete_cycles, 4);
+  ASSERT_EQ(metrics.nb_transport_errors, 1);
+  ASSERT_EQ(metrics.nb_missing_attitudes, 1);
+  ASSERT_EQ(metrics.missing_reply_streak(-1), 0);
+  ASSERT_EQ(metrics.missing_reply_streak(128), 0);
+}
+
+}  // namespace vulp::actuation
@@ -1,7 +1,14 @@
 // SPDX-License-Identifier: Apache-2.0
 // Copyright 2022 Stéphane Caron
 
+#include <chrono>
+#include <future>
+#include <limits>
 #include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "vulp/actuation/MockInterface.h"
@@ -10,6 +17,31 @@
 
 namespace vulp::actuation {
 
+namespace {
+
+/*! Run a cycle and wait for its output.
+ *
+ * \param[in, out] interface Mock interface.
+ * \param[out] duration Time from the cycle request to the callback, in [s].
+ * \param[out] callback_thread Thread the callback was invoked from.
+ */
+moteus::Output cycle_and_wait(MockInterface& interface, double& duration,
+                              std::thread::id& callback_thread) {
+  std::promise<moteus::Output> promise;
+  std::future<moteus::Output> future = promise.get_future();
+  const auto start = std::chrono::steady_clock::now();
+  interface.cycle(interface.data(), [&](const moteus::Output& output) {
+    duration = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                             start)
+                   .count();
+    callback_thread = std::this_thread::get_id();
+    promise.set_value(output);
+  });
+  return future.get();
+}
+
+}  // namespace
+
 TEST(MockInterfaceTest, CycleCallsCallback) {
   const auto layout = get_coffee_machine_layout();
   const double dt = 1e-3;
@@ -23,4 +55,261 @@ TEST(MockInterfaceTest, CycleCallsCallback) {
   ASSERT_TRUE(callback_called);
 }
 
+TEST(MockInterfaceTest, FixedLatencyFromBackgroundThread) {
+  MockInterface::Parameters params;
+  params.latency_mode = MockInterface::LatencyMode::kFixed;
+  params.latency = 2e-3;
+  MockInterface interface(get_coffee_machine_layout(), 1e-3, params);
+
+  double duration = 0.0;
+  std::thread::id callback_thread;
+  const auto output = cycle_and_wait(interface, duration, callback_thread);
+  ASSERT_EQ(output.query_result_size, interface.replies().size());
+  ASSERT_GE(duration, params.latency);
+  ASSERT_NE(callback_thread, std::this_thread::get_id());
+}
+
+TEST(MockInterfaceTest, CycleBeforeCallbackThrows) {
+  MockInterface::Parameters params;
+  params.latency_mode = MockInterface::LatencyMode::kFixed;
+  params.latency = 10e-3;
+  MockInterface interface(get_coffee_machine_layout(), 1e-3, params);
+
+  std::promise<void> promise;
+  interface.cycle(interface.data(),
+                  [&promise](const moteus::Output&) { promise.set_value(); });
+  ASSERT_THROW(interface.cycle(interface.data(), [](const moteus::Output&) {}),
+               std::logic_error);
+  promise.get_future().wait();
+}
+
+TEST(MockInterfaceTest, SampledLatencies) {
+  MockInterface::Parameters params;
+  params.latency_mode = MockInterface::LatencyMode::kUniform;
+  params.min_latency = 1e-3;
+  params.max_latency = 2e-3;
+  MockInterface interface(get_coffee_machine_layout(), 1e-3, params);
+  double duration = 0.0;
+  std::thread::id callback_thread;
+  for (int i = 0; i < 5; ++i) {
+    cycle_and_wait(interface, duration, callback_thread);
+    ASSERT_GE(duration, params.min_latency);
+  }
+
+  // Recorded histogram where all latencies are between 3 and 4 ms
+  Dictionary config;
+  config("mock")("latency_mode") = std::string("histogram");
+  config("mock")("histogram_edges") = std::vector<double>{1e-3, 3e-3, 4e-3};
+  config("mock")("histogram_counts") = std::vector<double>{0.0, 10.0};
+  interface.reset(config);
+  for (int i = 0; i < 5; ++i) {
+    cycle_and_wait(interface, duration, callback_thread);
+    ASSERT_GE(duration, 3e-3);
+  }
+}
+
+TEST(MockInterfaceTest, DropAndTruncateReplies) {
+  MockInterface::Parameters params;
+  params.drop_probability = 1.0;
+  MockInterface dropping_interface(get_coffee_machine_layout(), 1e-3, params);
+  double duration = 0.0;
+  std::thread::id callback_thread;
+  auto output = cycle_and_wait(dropping_interface, duration, callback_thread);
+  ASSERT_EQ(output.query_result_size, 0);
+
+  params.drop_probability = 0.0;
+  params.truncate_probability = 1.0;
+  MockInterface truncating_interface(get_coffee_machine_layout(), 1e-3, params);
+  for (int i = 0; i < 10; ++i) {
+    output = cycle_and_wait(truncating_interface, duration, callback_thread);
+    ASSERT_LT(output.query_result_size, truncating_interface.replies().size());
+    for (size_t j = 0; j < output.query_result_size; ++j) {
+      ASSERT_EQ(truncating_interface.replies()[j].id,
+                truncating_interface.commands()[j].id);
+    }
+  }
+}
+
+TEST(MockInterfaceTest, ResetReseedsReplyFaults) {
+  MockInterface interface(get_coffee_machine_layout(), 1e-3);
+  Dictionary config;
+  config("mock")("drop_probability") = 0.5;
+  config("mock")("seed") = 42;
+
+  std::vector<size_t> nb_replies[2];
+  for (auto& sequence : nb_replies) {
+    interface.reset(config);
+    for (int i = 0; i < 20; ++i) {
+      interface.cycle(interface.data(), [&sequence](const moteus::Output& out) {
+        sequence.push_back(out.query_result_size);
+      });
+    }
+  }
+  ASSERT_EQ(nb_replies[0], nb_replies[1]);
+
+  config("mock")("seed") = -1;
+  ASSERT_THROW(interface.reset(config), std::invalid_argument);
+}
+
+TEST(MockInterfaceTest, KinematicModel) {
+  MockInterface interface(get_coffee_machine_layout(), 1e-3);
+  double duration = 0.0;
+  std::thread::id callback_thread;
+  for (auto& command : interface.commands()) {
+    command.mode = moteus::Mode::kPosition;
+    command.position.position = 0.5;
+    command.position.velocity = 0.0;
+  }
+  cycle_and_wait(interface, duration, callback_thread);
+  ASSERT_DOUBLE_EQ(interface.replies()[0].result.position, 0.5);
+
+  // Velocity commands without position integrate the last position
+  interface.commands()[0].position.position =
+      std::numeric_limits<double>::quiet_NaN();
+  interface.commands()[0].position.velocity = 2.0;
+  cycle_and_wait(interface, duration, callback_thread);
+  ASSERT_DOUBLE_EQ(interface.replies()[0].result.position, 0.502);
+  ASSERT_DOUBLE_EQ(interface.replies()[0].result.velocity, 2.0);
+  ASSERT_EQ(interface.replies()[0].result.mode, moteus::Mode::kPosition);
+}
+
+TEST(MockInterfaceTest, DynamicModelsTrackTargets) {
+  for (const auto model : {MockInterface::ServoModel::kFirstOrder,
+                           MockInterface::ServoModel::kSecondOrder}) {
+    MockInterface::Parameters params;
+    params.servo_model = model;
+    MockInterface interface(get_coffee_machine_layout(), 1e-3, params);
+    for (auto& command : interface.commands()) {
+      command.mode = moteus::Mode::kPosition;
+      command.position.position = 0.1 * command.id;
+      command.position.velocity = 0.0;
+      command.position.maximum_torque = 10.0;
+    }
+
+    // The second-order model settles within 1e-3 after about 1.5 s
+    double duration = 0.0;
+    std::thread::id callback_thread;
+    moteus::Output output;
+    for (int i = 0; i < 2000; ++i) {
+      output = cycle_and_wait(interface, duration, callback_thread);
+    }
+    ASSERT_EQ(output.query_result_size, interface.replies().size());
+    for (const auto& reply : interface.replies()) {
+      ASSERT_NEAR(reply.result.position, 0.1 * reply.id, 1e-3);
+      ASSERT_NEAR(reply.result.velocity, 0.0, 1e-3);
+    }
+
+    // Stopped servos exert no torque
+    interface.write_stop_commands();
+    cycle_and_wait(interface, duration, callback_thread);
+    ASSERT_EQ(interface.replies()[0].result.mode, moteus::Mode::kStopped);
+    ASSERT_DOUBLE_EQ(interface.replies()[0].result.torque, 0.0);
+  }
+}
+
+TEST(MockInterfaceTest, UncommandedServosKeepTheirState) {
+  MockInterface::Parameters params;
+  params.servo_model = MockInterface::ServoModel::kFirstOrder;
+  MockInterface interface(get_coffee_machine_layout(), 1e-3, params);
+  auto& commands = interface.commands();
+  for (auto& command : commands) {
+    command.mode = moteus::Mode::kPosition;
+    command.position.position = 1.0;
+    command.position.velocity = 0.0;
+  }
+  interface.cycle(interface.data(), [](const moteus::Output&) {});
+
+  // Only the first servo is commanded, the second one keeps its targets
+  moteus::ServoReply reply;
+  moteus::Data first_servo;
+  first_servo.commands = {commands.data(), 1};
+  first_servo.replies = {&reply, 1};
+  for (int i = 0; i < 100; ++i) {
+    interface.cycle(first_servo, [](const moteus::Output&) {});
+  }
+
+  // Without position target, the reply is the current state
+  commands[1].position.position = std::numeric_limits<double>::quiet_NaN();
+  moteus::Data second_servo;
+  second_servo.commands = {commands.data() + 1, 1};
+  second_servo.replies = {&reply, 1};
+  interface.cycle(second_servo, [](const moteus::Output&) {});
+  ASSERT_EQ(reply.id, commands[1].id);
+  ASSERT_NEAR(reply.result.position, 1e-3 / params.time_constant, 1e-12);
+}
+
+TEST(MockInterfaceTest, SecondOrderTorqueLimit) {
+  Dictionary config;
+  config("mock")("servo_model") = std::string("second_order");
+  MockInterface interface(get_coffee_machine_layout(), 1e-3,
+                          MockInterface::Parameters(config));
+  for (auto& command : interface.commands()) {
+    command.mode = moteus::Mode::kPosition;
+    command.position.position = 1.0;
+    command.position.maximum_torque = 0.5;
+  }
+  double duration = 0.0;
+  std::thread::id callback_thread;
+  cycle_and_wait(interface, duration, callback_thread);
+  for (const auto& reply : interface.replies()) {
+    ASSERT_DOUBLE_EQ(reply.result.torque, 0.5);
+    ASSERT_GT(reply.result.velocity, 0.0);
+  }
+}
+
+TEST(MockInterfaceTest, InvalidParameters) {
+  MockInterface::Parameters params;
+  params.latency_mode = MockInterface::LatencyMode::kHistogram;
+  params.histogram_edges = {0.0, 1e-3};
+  params.histogram_counts = {1.0, 2.0};
+  ASSERT_THROW(MockInterface(get_coffee_machine_layout(), 1e-3, params),
+               std::invalid_argument);
+
+  // Edges should be strictly increasing
+  params.histogram_edges = {0.0, 2e-3, 1e-3};
+  ASSERT_THROW(MockInterface(get_coffee_machine_layout(), 1e-3, params),
+               std::invalid_argument);
+  params.histogram_edges = {0.0, 1e-3, 1e-3};
+  ASSERT_THROW(MockInterface(get_coffee_machine_layout(), 1e-3, params),
+               std::invalid_argument);
+
+  // Counts should be non-negative with at least one sample
+  params.histogram_edges = {0.0, 1e-3, 2e-3};
+  params.histogram_counts = {-1.0, 2.0};
+  ASSERT_THROW(MockInterface(get_coffee_machine_layout(), 1e-3, params),
+               std::invalid_argument);
+  params.histogram_counts = {0.0, 0.0};
+  ASSERT_THROW(MockInterface(get_coffee_machine_layout(), 1e-3, params),
+               std::invalid_argument);
+
+  MockInterface interface(get_coffee_machine_layout(), 1e-3);
+  Dictionary config;
+  config("mock")("latency_mode") = std::string("instantaneous");
+  ASSERT_THROW(interface.reset(config), std::invalid_argument);
+
+  config("mock")("latency_mode") = std::string("fixed");
+  config("mock")("drop_probability") = 1.5;
+  ASSERT_THROW(interface.reset(config), std::invalid_argument);
+
+  config("mock")("drop_probability") = 0.0;
+  config("mock")("servo_model") = std::string("third_order");
+  ASSERT_THROW(interface.reset(config), std::invalid_argument);
+
+  // Time constant and inertia are divisors of the servo models
+  config("mock")("servo_model") = std::string("second_order");
+  config("mock")("time_constant") = 0.0;
+  ASSERT_THROW(interface.reset(config), std::invalid_argument);
+  config("mock")("time_constant") = 0.01;
+  config("mock")("inertia") = -0.05;
+  ASSERT_THROW(interface.reset(config), std::invalid_argument);
+  config("mock")("inertia") = 0.05;
+  config("mock")("kd") = -0.5;
+  ASSERT_THROW(interface.reset(config), std::invalid_argument);
+  config("mock")("kd") = 0.5;
+  config("mock")("friction") = -0.01;
+  ASSERT_THROW(interface.reset(config), std::invalid_argument);
+  config("mock")("friction") = 0.01;
+  ASSERT_NO_THROW(interface.reset(config));
+}
+
 }  // namespace vulp::actuation
@@ -0,0 +1,224 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "vulp/actuation/MoteusEmulator.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "vulp/actuation/BusTiming.h"
+#include "vulp/actuation/moteus/protocol.h"
+#include "vulp/actuation/resolution.h"
+#include "vulp/actuation/tests/coffee_machine_layout.h"
+
+namespace vulp::actuation {
+
+namespace {
+
+using Frame = CanTransport::Frame;
+
+/*! Make a position command frame, as sent by the Pi3HatInterface.
+ *
+ * \param[in] servo_id Servo identifier.
+ * \param[in] bus Bus the servo is connected to.
+ * \param[in] position Target position in [rev].
+ */
+Frame make_position_frame(int servo_id, int bus, double position) {
+  Frame frame;
+  frame.id = static_cast<uint32_t>(servo_id | 0x8000);
+  frame.bus = bus;
+  frame.expect_reply = true;
+  moteus::PositionCommand command;
+  command.position = position;
+  command.maximum_torque = 10.0;
+  moteus::WriteCanFrame writer(frame.data, &frame.size);
+  moteus::EmitPositionCommand(&writer, command, get_position_resolution());
+  moteus::EmitQueryCommand(&writer, get_query_resolution());
+  return frame;
+}
+
+//! Make a stop command frame without query.
+Frame make_stop_frame(int servo_id, int bus) {
+  Frame frame;
+  frame.id = static_cast<uint32_t>(servo_id);
+  frame.bus = bus;
+  moteus::WriteCanFrame writer(frame.data, &frame.size);
+  moteus::EmitStopCommand(&writer);
+  return frame;
+}
+
+}  // namespace
+
+class MoteusEmulatorTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    params_.real_time = false;
+    rx_frames_.resize(8);
+  }
+
+  //! Run a cycle on the emulator with the current transmit frames.
+  CanTransport::Output cycle(MoteusEmulator& emulator,
+                             bool request_attitude = false,
+                             bool wait_for_attitude = false) {
+    CanTransport::Input input;
+    input.tx_can = {tx_frames_.data(), tx_frames_.size()};
+    input.rx_can = {rx_frames_.data(), rx_frames_.size()};
+    input.attitude = &attitude_;
+    input.request_attitude = request_attitude;
+    input.wait_for_attitude = wait_for_attitude;
+    return emulator.cycle(input);
+  }
+
+  MoteusEmulator::Parameters params_;
+  std::vector<Frame> tx_frames_;
+  std::vector<Frame> rx_frames_;
+  CanTransport::Attitude attitude_;
+};
+
+TEST_F(MoteusEmulatorTest, RepliesToQueries) {
+  MoteusEmulator emulator(params_);
+  tx_frames_ = {make_position_frame(1, 1, 0.5), make_position_frame(5, 2, 0.)};
+  const auto output = cycle(emulator);
+  ASSERT_FALSE(output.error);
+  ASSERT_EQ(output.rx_can_size, 2);
+
+  for (size_t i = 0; i < output.rx_can_size; ++i) {
+    const Frame& reply = rx_frames_[i];
+    const int servo_id = static_cast<int>(reply.id >> 8);
+    ASSERT_EQ(servo_id, static_cast<int>(tx_frames_[i].id & 0x7f));
+    ASSERT_EQ(reply.bus, tx_frames_[i].bus);
+    ASSERT_EQ(reply.size, can_fd_data_length(reply.size));
+
+    const auto result = moteus::ParseQueryResult(reply.data, reply.size);
+    const auto& state = emulator.servo(servo_id);
+    ASSERT_EQ(result.mode, moteus::Mode::kPosition);
+    ASSERT_NEAR(result.position, state.position, 1e-5);
+    ASSERT_NEAR(result.velocity, state.velocity, 1e-5);
+    ASSERT_NEAR(result.torque, state.torque, 1e-3);
+    ASSERT_NEAR(result.voltage, params_.voltage, 0.5);
+    ASSERT_NEAR(result.temperature, params_.temperature, 1.0);
+  }
+  ASSERT_GT(emulator.servo(1).torque, 0.0);
+  ASSERT_DOUBLE_EQ(emulator.servo(5).torque, 0.0);
+}
+
+TEST_F(MoteusEmulatorTest, ServoReachesTarget) {
+  MoteusEmulator emulator(params_);
+  tx_frames_ = {make_position_frame(3, 1, -0.25)};
+  for (int i = 0; i < 2000; ++i) {
+    cycle(emulator);
+  }
+  ASSERT_NEAR(emulator.servo(3).position, -0.25, 1e-3);
+  ASSERT_NEAR(emulator.servo(3).velocity, 0.0, 1e-3);
+}
+
+TEST_F(MoteusEmulatorTest, StopCommandWithoutQuery) {
+  MoteusEmulator emulator(params_);
+  tx_frames_ = {make_position_frame(1, 1, 1.0)};
+  cycle(emulator);
+  ASSERT_EQ(emulator.servo(1).mode, moteus::Mode::kPosition);
+
+  tx_frames_ = {make_stop_frame(1, 1)};
+  const auto output = cycle(emulator);
+  ASSERT_EQ(output.rx_can_size, 0);
+  ASSERT_EQ(emulator.servo(1).mode, moteus::Mode::kStopped);
+  ASSERT_DOUBLE_EQ(emulator.servo(1).torque, 0.0);
+  ASSERT_THROW(emulator.servo(128), std::out_of_range);
+}
+
+TEST_F(MoteusEmulatorTest, RepliesAreBoundedByBuffer) {
+  MoteusEmulator emulator(params_);
+  rx_frames_.resize(2);
+  for (int servo_id = 1; servo_id <= 4; ++servo_id) {
+    tx_frames_.push_back(make_position_frame(servo_id, 1, 0.0));
+  }
+  ASSERT_EQ(cycle(emulator).rx_can_size, 2);
+}
+
+TEST_F(MoteusEmulatorTest, CycleDurationMatchesBusTiming) {
+  const ServoLayout layout = get_coffee_machine_layout();
+  for (const auto& servo_bus : layout.servo_bus_map()) {
+    tx_frames_.push_back(
+        make_position_frame(servo_bus.first, servo_bus.second, 0.0));
+  }
+  const BusTiming bus_timing(layout, get_position_resolution(),
+                             get_query_resolution());
+
+  MoteusEmulator emulator(params_);
+  cycle(emulator);
+  ASSERT_NEAR(emulator.last_cycle_duration(), bus_timing.cycle_duration(),
+              1e-12);
+  ASSERT_NEAR(emulator.time(), bus_timing.cycle_duration(), 1e-12);
+
+  params_.cycle_latency = 100e-6;
+  params_.bus_latency[2] = 1e-3;
+  MoteusEmulator slow_emulator(params_);
+  cycle(slow_emulator);
+  const double bus2_duration = bus_timing.bus_loads().at(2).duration;
+  ASSERT_NEAR(slow_emulator.last_cycle_duration(),
+              params_.cycle_latency + bus2_duration + 1e-3, 1e-12);
+}
+
+TEST_F(MoteusEmulatorTest, InterleavedFramesShortenCycles) {
+  ServoLayout layout;
+  for (int servo_id = 1; servo_id <= 6; ++servo_id) {
+    layout.add_servo(servo_id, (servo_id <= 3) ? 1 : 2, "");
+  }
+  std::vector<int> buses;
+  std::vector<Frame> sorted_frames;
+  for (const auto& servo_bus : layout.servo_bus_map()) {
+    buses.push_back(servo_bus.second);
+    sorted_frames.push_back(
+        make_position_frame(servo_bus.first, servo_bus.second, 0.0));
+  }
+  const BusTiming bus_timing(layout, get_position_resolution(),
+                             get_query_resolution());
+  const double bus_duration = bus_timing.bus_loads().at(2).duration;
+  params_.tx_frame_latency = 10e-6;  // less than a servo's bus time
+
+  // Sorted by servo ID, bus 2 waits for the first three frames of bus 1
+  MoteusEmulator emulator(params_);
+  tx_frames_ = sorted_frames;
+  cycle(emulator);
+  ASSERT_NEAR(emulator.last_cycle_duration(),
+              4 * params_.tx_frame_latency + bus_duration, 1e-12);
+
+  // Interleaved, both buses start after at most two frames
+  MoteusEmulator interleaved_emulator(params_);
+  tx_frames_.clear();
+  for (const size_t index : interleave_buses(buses)) {
+    tx_frames_.push_back(sorted_frames[index]);
+  }
+  cycle(interleaved_emulator);
+  ASSERT_NEAR(interleaved_emulator.last_cycle_duration(),
+              2 * params_.tx_frame_latency + bus_duration, 1e-12);
+}
+
+TEST_F(MoteusEmulatorTest, AttitudeRate) {
+  params_.attitude_rate = 1000.0;
+  params_.cycle_latency = 100e-6;
+  tx_frames_ = {make_position_frame(1, 1, 0.0)};
+
+  // Without waiting, cycles are shorter than the IMU period and estimates
+  // are present once per period
+  MoteusEmulator emulator(params_);
+  unsigned nb_present = 0;
+  for (int i = 0; i < 100; ++i) {
+    nb_present += cycle(emulator, true, false).attitude_present;
+  }
+  ASSERT_LT(emulator.last_cycle_duration(), 1e-3);
+  ASSERT_NEAR(emulator.time(), 100 * emulator.last_cycle_duration(), 1e-9);
+  ASSERT_NEAR(nb_present, emulator.time() * params_.attitude_rate, 1.0);
+  ASSERT_FLOAT_EQ(attitude_.attitude.w, 1.0f);
+  ASSERT_FLOAT_EQ(attitude_.accel_mps2.z, 9.81f);
+
+  // Waiting makes every cycle after the first one last until the next
+  // estimate, as the IMU has an estimate ready when the emulator starts
+  MoteusEmulator waiting_emulator(params_);
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_TRUE(cycle(waiting_emulator, true, true).attitude_present);
+  }
+  ASSERT_NEAR(waiting_emulator.time(), 9e-3, 1e-9);
+}
+
+}  // namespace vulp::actuation
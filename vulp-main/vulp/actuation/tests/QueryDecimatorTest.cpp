@@ -0,0 +1,151 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "vulp/actuation/QueryDecimator.h"
+
+#include <cmath>
+
+#include "gtest/gtest.h"
+#include "vulp/actuation/resolution.h"
+
+namespace vulp::actuation {
+
+using moteus::QueryCommand;
+using moteus::QueryResult;
+using moteus::Resolution;
+
+namespace {
+
+//! Reply with given slow fields.
+QueryResult make_result(double voltage, double temperature, int fault) {
+  QueryResult result;
+  result.position = 0.5;
+  result.voltage = voltage;
+  result.temperature = temperature;
+  result.fault = fault;
+  return result;
+}
+
+//! Reply to a query without slow fields.
+QueryResult make_fast_result() {
+  QueryResult result;
+  result.position = 0.5;
+  return result;
+}
+
+}  // namespace
+
+TEST(QueryDecimator, FastQueryIsConstexpr) {
+  constexpr QueryCommand query = get_fast_query_resolution();
+  static_assert(query.voltage == Resolution::kIgnore);
+  static_assert(query.temperature == Resolution::kIgnore);
+  static_assert(query.fault == Resolution::kIgnore);
+  static_assert(query.position == get_query_resolution().position);
+}
+
+TEST(QueryDecimator, NoDecimationByDefault) {
+  QueryDecimator decimator;
+  const QueryCommand full_query = get_query_resolution();
+  for (int cycle = 0; cycle < 5; ++cycle) {
+    decimator.next_cycle();
+    for (int servo_id = 1; servo_id <= 6; ++servo_id) {
+      ASSERT_EQ(decimator.query(servo_id, full_query), full_query);
+    }
+  }
+}
+
+TEST(QueryDecimator, RoundRobinAcrossServos) {
+  QueryDecimator decimator;
+  decimator.reset(3);
+  const QueryCommand full_query = get_query_resolution();
+  const QueryCommand fast_query = get_fast_query_resolution();
+
+  // Slow fields are queried from everyone until they are first received
+  decimator.next_cycle();
+  for (int servo_id = 1; servo_id <= 6; ++servo_id) {
+    ASSERT_EQ(decimator.query(servo_id, full_query), full_query);
+    QueryResult result = make_result(18.0, 30.0, 0);
+    decimator.merge(servo_id, result);
+  }
+
+  // Then each servo gets slow fields once every three cycles
+  for (int cycle = 0; cycle < 9; ++cycle) {
+    decimator.next_cycle();
+    int nb_full_queries = 0;
+    for (int servo_id = 1; servo_id <= 6; ++servo_id) {
+      const QueryCommand query = decimator.query(servo_id, full_query);
+      if (query == full_query) {
+        ++nb_full_queries;
+      } else {
+        ASSERT_EQ(query, fast_query);
+      }
+    }
+    ASSERT_EQ(nb_full_queries, 2);
+  }
+}
+
+TEST(QueryDecimator, KeepLastKnownValues) {
+  QueryDecimator decimator;
+  decimator.reset(4);
+  const QueryCommand full_query = get_query_resolution();
+  constexpr int kServoId = 2;
+
+  decimator.next_cycle();
+  ASSERT_EQ(decimator.query(kServoId, full_query), full_query);
+  QueryResult result = make_result(18.5, 42.0, 33);
+  decimator.merge(kServoId, result);
+  ASSERT_EQ(decimator.ages()[kServoId], 0);
+
+  unsigned age = 0;
+  for (int cycle = 0; cycle < 8; ++cycle) {
+    decimator.next_cycle();
+    ++age;
+    if (decimator.query(kServoId, full_query) == full_query) {
+      QueryResult slow_result = make_result(18.0 - cycle, 43.0, 0);
+      decimator.merge(kServoId, slow_result);
+      age = 0;
+    } else {
+      QueryResult fast_result = make_fast_result();
+      decimator.merge(kServoId, fast_result);
+      ASSERT_FALSE(std::isnan(fast_result.voltage));
+      ASSERT_FALSE(std::isnan(fast_result.temperature));
+    }
+    ASSERT_EQ(decimator.ages()[kServoId], age);
+  }
+}
+
+TEST(QueryDecimator, MissingReplyIncreasesAge) {
+  QueryDecimator decimator;
+  decimator.reset(2);
+  const QueryCommand full_query = get_query_resolution();
+  constexpr int kServoId = 1;
+
+  ASSERT_EQ(decimator.ages()[kServoId], QueryDecimator::kNeverReceived);
+  decimator.next_cycle();
+  decimator.query(kServoId, full_query);
+  QueryResult result = make_result(18.5, 42.0, 0);
+  decimator.merge(kServoId, result);
+
+  // No reply from the servo in the next cycles
+  for (unsigned cycle = 1; cycle <= 5; ++cycle) {
+    decimator.next_cycle();
+    decimator.query(kServoId, full_query);
+    ASSERT_EQ(decimator.ages()[kServoId], cycle);
+  }
+}
+
+TEST(QueryDecimator, SamePeriodKeepsValues) {
+  QueryDecimator decimator;
+  decimator.reset(2);
+  decimator.next_cycle();
+  decimator.query(1, get_query_resolution());
+  QueryResult result = make_result(18.5, 42.0, 0);
+  decimator.merge(1, result);
+
+  decimator.set_period(2);
+  ASSERT_EQ(decimator.ages()[1], 0);
+  decimator.set_period(5);
+  ASSERT_EQ(decimator.ages()[1], QueryDecimator::kNeverReceived);
+}
+
+}  // namespace vulp::actuation
@@ -0,0 +1,222 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <palimpsest/Dictionary.h>
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "vulp/exceptions/FilterError.h"
+#include "vulp/exceptions/TypeError.h"
+#include "vulp/observation/Observer.h"
+#include "vulp/utils/low_pass_filter.h"
+
+namespace vulp::observation {
+
+using palimpsest::Dictionary;
+using vulp::exceptions::FilterError;
+using vulp::exceptions::TypeError;
+using vulp::observation::Observer;
+using vulp::utils::low_pass_filter;
+
+/*! Report filtered and downsampled history vectors to lower-frequency agents.
+ *
+ * This observer low-pass filters signals from the spine at every cycle, and
+ * keeps one filtered sample every \ref decimation() cycles. For instance, a
+ * 200 Hz agent can get the last second of a 1 kHz signal as 200 samples
+ * rather than 1000. The filter cutoff period should be more than twice the
+ * period of kept samples to avoid aliasing.
+ *
+ * A single observer handles several signals of the same type. Outputs are
+ * written to the "history" prefix at each signal's keys, most recent first,
+ * as for \ref HistoryObserver.
+ */
+template <typename T>
+class DownsamplingHistoryObserver : public Observer {
+ public:
+  /*! Initialize observer.
+   *
+   * \param[in] key_paths Keys to read each signal from in input observations.
+   * \param[in] size Size of the history vectors.
+   * \param[in] decimation Number of spine cycles between two kept samples.
+   * \param[in] cutoff_period Cutoff period of the low-pass filter in [s].
+   * \param[in] dt Spine period in [s].
+   * \param[in] default_value Value to initialize history vectors.
+   *
+   * \throw FilterError if the decimation is zero, or if the cutoff period is
+   *     at most twice the period of kept samples.
+   */
+  DownsamplingHistoryObserver(
+      const std::vector<std::vector<std::string>>& key_paths, size_t size,
+      unsigned decimation, double cutoff_period, double dt,
+      const T& default_value)
+      : decimation_(decimation),
+        cutoff_period_(cutoff_period),
+        dt_(dt),
+        default_value_(default_value),
+        head_(size > 0 ? size - 1 : 0) {
+    if (decimation < 1) {
+      throw FilterError("[DownsamplingHistoryObserver] Zero decimation");
+    }
+    utils::check_cutoff_period(cutoff_period, decimation * dt);
+    signals_.reserve(key_paths.size());
+    for (const auto& keys : key_paths) {
+      Signal signal;
+      signal.keys = keys;
+      for (const auto& key : keys) {
+        signal.key_path += "/" + key;
+      }
+      signal.filtered = default_value;
+      signal.samples.assign(size, default_value);
+      signals_.push_back(std::move(signal));
+    }
+  }
+
+  //! Prefix of outputs in the observation dictionary.
+  inline std::string prefix() const noexcept final { return "history"; }
+
+  //! Number of spine cycles between two kept samples.
+  unsigned decimation() const noexcept { return decimation_; }
+
+  /*! Reset observer.
+   *
+   * \param[in] config Configuration dictionary.
+   *
+   * Filters restart from the next input and histories are filled with the
+   * default value.
+   */
+  void reset(const Dictionary& config) final {
+    nb_cycles_ = 0;
+    head_ = (size() > 0) ? size() - 1 : 0;
+    has_new_sample_ = true;
+    for (auto& signal : signals_) {
+      signal.is_filter_initialized = false;
+      signal.filtered = default_value_;
+      std::fill(signal.samples.begin(), signal.samples.end(), default_value_);
+    }
+  }
+
+  /*! Read inputs from other observations.
+   *
+   * \param[in] observation Dictionary to read other observations from.
+   */
+  void read(const Dictionary& observation) final {
+    for (auto& signal : signals_) {
+      const Dictionary* dict = &observation;
+      for (const auto& key : signal.keys) {
+        dict = &(*dict)(key);
+      }
+      if (!dict->is_value()) {
+        throw TypeError(__FILE__, __LINE__,
+                        "Observation at " + signal.key_path +
+                            " is not a value");
+      }
+      const T& input = dict->as<T>();
+      if (signal.is_filter_initialized) {
+        signal.filtered =
+            low_pass_filter(signal.filtered, cutoff_period_, input, dt_);
+      } else {
+        signal.filtered = input;
+        signal.is_filter_initialized = true;
+      }
+    }
+
+    const bool is_sample_kept = (nb_cycles_ % decimation_ == 0);
+    nb_cycles_ = (nb_cycles_ + 1 < decimation_) ? nb_cycles_ + 1 : 0;
+    if (!is_sample_kept || size() < 1) {
+      return;
+    }
+    head_ = (head_ + 1 < size()) ? head_ + 1 : 0;
+    for (auto& signal : signals_) {
+      signal.samples[head_] = signal.filtered;
+    }
+    has_new_sample_ = true;
+  }
+
+  /*! Write outputs, called if reading was successful.
+   *
+   * \param[out] observation Dictionary to write observations to.
+   *
+   * Output vectors are only updated when a new sample has been kept since the
+   * last write, or when they are missing or have the wrong size. This assumes
+   * that outputs are written to the same observation dictionary at each
+   * cycle, as the spine does.
+   */
+  void write(Dictionary& observation) final {
+    for (auto& signal : signals_) {
+      Dictionary* dict = &observation(prefix());
+      for (const auto& key : signal.keys) {
+        dict = &(*dict)(key);
+      }
+      if (dict->is_empty()) {
+        *dict = std::vector<T>(size(), default_value_);
+      } else if (!has_new_sample_ &&
+                 dict->as<std::vector<T>>().size() == size()) {
+        continue;
+      }
+      auto& output = dict->as<std::vector<T>>();
+      output.resize(size(), default_value_);
+      if (size() > 0) {
+        const auto split = signal.samples.begin() + head_ + 1;
+        auto next = std::reverse_copy(signal.samples.begin(), split,
+                                      output.begin());
+        std::reverse_copy(split, signal.samples.end(), next);
+      }
+    }
+    has_new_sample_ = false;
+  }
+
+ private:
+  //! Filter state and history of one signal.
+  struct Signal {
+    //! Keys locating values to read from in input observations
+    std::vector<std::string> keys;
+
+    //! Concatenated keys, for reporting
+    std::string key_path;
+
+    //! Whether the filter has received its first input
+    bool is_filter_initialized = false;
+
+    //! Filter output
+    T filtered;
+
+    //! Ring buffer of kept samples
+    std::vector<T> samples;
+  };
+
+  //! Size of history vectors.
+  size_t size() const noexcept {
+    return signals_.empty() ? 0 : signals_.front().samples.size();
+  }
+
+  //! Number of spine cycles between two kept samples
+  unsigned decimation_;
+
+  //! Cutoff period of the low-pass filter in [s]
+  double cutoff_period_;
+
+  //! Spine period in [s]
+  double dt_;
+
+  //! Value to initialize history vectors
+  T default_value_;
+
+  //! Filter state and history of each signal
+  std::vector<Signal> signals_;
+
+  //! Index of the most recent sample in the ring buffers
+  size_t head_;
+
+  //! Number of spine cycles since the last kept sample
+  unsigned nb_cycles_ = 0;
+
+  //! Whether a sample has been kept since the last write
+  bool has_new_sample_ = true;
+};
+
+}  // namespace vulp::observation
@@ -0,0 +1,166 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "vulp/observation/FilterBankObserver.h"
+
+#include <cmath>
+#include <string>
+
+#include "vulp/exceptions/FilterError.h"
+#include "vulp/exceptions/TypeError.h"
+#include "vulp/utils/low_pass_filter.h"
+
+namespace vulp::observation {
+
+using vulp::exceptions::FilterError;
+using vulp::exceptions::TypeError;
+
+FilterBankObserver::FilterBankObserver(
+    const std::vector<std::vector<std::string>>& scalar_key_paths,
+    const std::vector<std::vector<std::string>>& vector_key_paths,
+    const Parameters& params, double dt)
+    : params_(params), dt_(dt) {
+  Eigen::Index offset = 0;
+  for (const auto& keys : scalar_key_paths) {
+    channels_.push_back({keys, offset, 1});
+    offset += 1;
+  }
+  for (const auto& keys : vector_key_paths) {
+    channels_.push_back({keys, offset, 3});
+    offset += 3;
+  }
+  input_.setZero(offset);
+  output_.setZero(offset);
+  check_parameters(params_, dt_);
+  compute_coefficients();
+}
+
+void FilterBankObserver::reset(const Dictionary& config) {
+  Parameters params = params_;
+  params.configure(config);
+  check_parameters(params, dt_);
+  params_ = params;
+  compute_coefficients();
+  is_first_read_ = true;
+}
+
+void FilterBankObserver::read(const Dictionary& observation) {
+  for (const auto& channel : channels_) {
+    const Dictionary* dict = &observation;
+    for (const auto& key : channel.keys) {
+      dict = &(*dict)(key);
+    }
+    if (!dict->is_value()) {
+      std::string key_path;
+      for (const auto& key : channel.keys) {
+        key_path += "/" + key;
+      }
+      throw TypeError(__FILE__, __LINE__,
+                      "Observation at " + key_path + " is not a value");
+    }
+    if (channel.size == 1) {
+      input_[channel.offset] = dict->as<double>();
+    } else {
+      input_.segment<3>(channel.offset) = dict->as<Eigen::Vector3d>().array();
+    }
+  }
+
+  if (is_first_read_) {
+    initialize_states();
+    is_first_read_ = false;
+    return;
+  }
+
+  if (sections_.empty()) {
+    output_ += alpha_ * (input_ - output_);
+    return;
+  }
+
+  // Direct form II transposed, the output of each section feeding the next
+  const size_t nb_sections = sections_.size();
+  for (size_t i = 0; i < nb_sections; ++i) {
+    const Biquad& c = sections_[i];
+    auto z1 = z1_.col(i);
+    auto z2 = z2_.col(i);
+    output_ = c.b0 * input_ + z1;
+    z1 = c.b1 * input_ - c.a1 * output_ + z2;
+    z2 = c.b2 * input_ - c.a2 * output_;
+    if (i + 1 < nb_sections) {
+      input_.swap(output_);
+    }
+  }
+}
+
+void FilterBankObserver::write(Dictionary& observation) {
+  for (const auto& channel : channels_) {
+    Dictionary* dict = &observation(prefix());
+    for (const auto& key : channel.keys) {
+      dict = &(*dict)(key);
+    }
+    if (channel.size == 1) {
+      if (dict->is_empty()) {
+        *dict = output_[channel.offset];
+      } else {
+        dict->as<double>() = output_[channel.offset];
+      }
+    } else {
+      const Eigen::Vector3d value = output_.segment<3>(channel.offset);
+      if (dict->is_empty()) {
+        *dict = value;
+      } else {
+        dict->as<Eigen::Vector3d>() = value;
+      }
+    }
+  }
+}
+
+void FilterBankObserver::check_parameters(const Parameters& params,
+                                          double dt) {
+  const unsigned order = params.order;
+  if (order != 1 && (order < 2 || order % 2 != 0)) {
+    throw FilterError("[FilterBankObserver] Filter order " +
+                      std::to_string(order) + " is neither one nor even");
+  }
+  utils::check_cutoff_period(params.cutoff_period, dt);
+}
+
+void FilterBankObserver::compute_coefficients() {
+  const unsigned order = params_.order;
+  sections_.clear();
+  alpha_ = dt_ / params_.cutoff_period;
+  if (order > 1) {
+    // Bilinear transform of Butterworth sections, see the "Audio EQ Cookbook"
+    const double w0 = 2.0 * M_PI * dt_ / params_.cutoff_period;
+    const double cos_w0 = std::cos(w0);
+    const double sin_w0 = std::sin(w0);
+    const unsigned nb_sections = order / 2;
+    for (unsigned k = 1; k <= nb_sections; ++k) {
+      const double theta = (2 * k - 1) * M_PI / (2.0 * order);
+      const double q = 1.0 / (2.0 * std::cos(theta));
+      const double alpha = sin_w0 / (2.0 * q);
+      const double a0 = 1.0 + alpha;
+      Biquad section;
+      section.b0 = 0.5 * (1.0 - cos_w0) / a0;
+      section.b1 = (1.0 - cos_w0) / a0;
+      section.b2 = section.b0;
+      section.a1 = -2.0 * cos_w0 / a0;
+      section.a2 = (1.0 - alpha) / a0;
+      sections_.push_back(section);
+    }
+  }
+  z1_.setZero(input_.size(), sections_.size());
+  z2_.setZero(input_.size(), sections_.size());
+}
+
+void FilterBankObserver::initialize_states() {
+  // Sections have unit gain at zero frequency, so that constant inputs are
+  // a steady state of every section
+  output_ = input_;
+  for (size_t i = 0; i < sections_.size(); ++i) {
+    const Biquad& c = sections_[i];
+    z1_.col(i) = (1.0 - c.b0) * input_;
+    z2_.col(i) = (c.b2 - c.a2) * input_;
+  }
+}
+
+}  // namespace vulp::observation
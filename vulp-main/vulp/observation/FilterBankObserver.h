@@ -0,0 +1,186 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <palimpsest/Dictionary.h>
+
+#include <Eigen/Core>
+#include <string>
+#include <vector>
+
+#include "vulp/observation/Observer.h"
+#include "vulp/utils/get_unsigned.h"
+
+namespace vulp::observation {
+
+using palimpsest::Dictionary;
+using vulp::observation::Observer;
+
+/*! Low-pass filter many signals at once with a bank of IIR filters.
+ *
+ * This observer applies the same low-pass filter to a set of scalar and 3D
+ * vector signals, for instance all servo positions, velocities and torques
+ * along with IMU angular velocities and linear accelerations. Filters are
+ * either first-order, like \ref vulp::utils::low_pass_filter, or Butterworth
+ * filters implemented as cascades of biquads (second-order sections).
+ *
+ * Filter coefficients are computed and validated once at reset. At each
+ * cycle, inputs are gathered into a contiguous array, and every filter stage
+ * is a coefficient-wise operation over all channels, which Eigen vectorizes.
+ *
+ * Filtered values are written to the "filtered" prefix at the same keys as
+ * their inputs, for instance "filtered/servo/left_knee/torque" for
+ * "servo/left_knee/torque".
+ */
+class FilterBankObserver : public Observer {
+ public:
+  //! Filter parameters.
+  struct Parameters {
+    /*! Configure from dictionary.
+     *
+     * \param[in] config Global configuration dictionary.
+     */
+    void configure(const Dictionary& config) {
+      if (!config.has("filter_bank")) {
+        return;
+      }
+      const auto& filter_bank = config("filter_bank");
+      order = utils::get_unsigned(filter_bank, "order", order);
+      cutoff_period = filter_bank.get<double>("cutoff_period", cutoff_period);
+    }
+
+    /*! Filter order.
+     *
+     * Order one is a first-order filter. Even orders are Butterworth filters
+     * made of order / 2 biquads.
+     */
+    unsigned order = 2;
+
+    //! Cutoff period in [s]
+    double cutoff_period = 0.02;
+  };
+
+  /*! Initialize observer.
+   *
+   * \param[in] scalar_key_paths Keys to read scalar signals from.
+   * \param[in] vector_key_paths Keys to read 3D vector signals from.
+   * \param[in] params Filter parameters.
+   * \param[in] dt Spine period in [s].
+   *
+   * \throw FilterError if the filter order is neither one nor even, or if the
+   *     cutoff period is at most twice the spine period.
+   */
+  FilterBankObserver(
+      const std::vector<std::vector<std::string>>& scalar_key_paths,
+      const std::vector<std::vector<std::string>>& vector_key_paths,
+      const Parameters& params, double dt);
+
+  //! Prefix of outputs in the observation dictionary.
+  inline std::string prefix() const noexcept final { return "filtered"; }
+
+  /*! Reset observer.
+   *
+   * \param[in] config Configuration dictionary.
+   *
+   * Filter parameters can be updated from the "filter_bank" key of the
+   * configuration. Filters restart from the next inputs.
+   *
+   * \throw FilterError if the new parameters are invalid.
+   */
+  void reset(const Dictionary& config) final;
+
+  /*! Read inputs from other observations.
+   *
+   * \param[in] observation Dictionary to read other observations from.
+   */
+  void read(const Dictionary& observation) final;
+
+  /*! Write outputs, called if reading was successful.
+   *
+   * \param[out] observation Dictionary to write observations to.
+   */
+  void write(Dictionary& observation) final;
+
+  //! Number of scalar values filtered at each cycle.
+  Eigen::Index nb_values() const noexcept { return input_.size(); }
+
+ private:
+  //! Input signal.
+  struct Channel {
+    //! Keys locating the signal in input observations
+    std::vector<std::string> keys;
+
+    //! Index of the first value of the signal in the value arrays
+    Eigen::Index offset;
+
+    //! Number of values: one for scalars, three for vectors
+    Eigen::Index size;
+  };
+
+  //! Coefficients of a biquad, normalized so that a0 = 1.
+  struct Biquad {
+    //! Feedforward coefficient of the current input
+    double b0;
+
+    //! Feedforward coefficient of the previous input
+    double b1;
+
+    //! Feedforward coefficient of the input before the previous one
+    double b2;
+
+    //! Feedback coefficient of the previous output
+    double a1;
+
+    //! Feedback coefficient of the output before the previous one
+    double a2;
+  };
+
+  /*! Validate parameters.
+   *
+   * \param[in] params Filter parameters.
+   * \param[in] dt Spine period in [s].
+   *
+   * \throw FilterError if the filter order is neither one nor even, or if the
+   *     cutoff period is at most twice the spine period.
+   */
+  static void check_parameters(const Parameters& params, double dt);
+
+  //! Compute filter coefficients from validated parameters.
+  void compute_coefficients();
+
+  //! Set filter states so that outputs are equal to the current inputs.
+  void initialize_states();
+
+  //! Filter parameters
+  Parameters params_;
+
+  //! Spine period in [s]
+  double dt_;
+
+  //! Input signals
+  std::vector<Channel> channels_;
+
+  //! Weight of new inputs in the first-order filter
+  double alpha_;
+
+  //! Biquad coefficients, one per section
+  std::vector<Biquad> sections_;
+
+  //! True until filter states are initialized from the first inputs
+  bool is_first_read_ = true;
+
+  //! Input values of all channels
+  Eigen::ArrayXd input_;
+
+  //! Output values of all channels
+  Eigen::ArrayXd output_;
+
+  //! First state of each biquad, one column per section
+  Eigen::ArrayXXd z1_;
+
+  //! Second state of each biquad, one column per section
+  Eigen::ArrayXXd z2_;
+};
+
+}  // namespace vulp::observation
@@ -5,6 +5,7 @@
 
 #include <palimpsest/Dictionary.h>
 
+#include <algorithm>
 #include <limits>
 #include <string>
 #include <unordered_map>
@@ -19,10 +20,31 @@ using palimpsest::Dictionary;
 using vulp::exceptions::TypeError;
 using vulp::observation::Observer;
 
+//! Layout of history vectors in output observations.
+enum class HistoryLayout {
+  /*! Vector of values, most recent first.
+   *
+   * All values are copied to the output at each write.
+   */
+  kMostRecentFirst,
+
+  /*! Ring buffer of values, with the index of the most recent value.
+   *
+   * Outputs are a dictionary with "values", the ring buffer, and "head", the
+   * index of the most recent value. Older values come at decreasing indices,
+   * wrapping around the end of the buffer. Only values read since the last
+   * write are copied to an existing output of the right size, which assumes
+   * that outputs are written to the same observation dictionary at each
+   * cycle, as the spine does. Missing or resized outputs get all values.
+   */
+  kRingBuffer,
+};
+
 /*! Report high-frequency history vectors to lower-frequency agents.
  *
  * This observer allows processing higher-frequency signals from the spine as
- * vectors of observations reported to lower-frequency agents.
+ * vectors of observations reported to lower-frequency agents. Values are
+ * stored in a ring buffer, so that reading a new value takes constant time.
  */
 template <typename T>
 class HistoryObserver : public Observer {
@@ -32,10 +54,20 @@ class HistoryObserver : public Observer {
    * \param[in] keys List of keys to read values from in input observations.
    * \param[in] size Size of the history vector.
    * \param[in] default_value Value to initialize history vectors.
+   * \param[in] layout Layout of history vectors in output observations.
    */
   HistoryObserver(const std::vector<std::string>& keys, size_t size,
-                  const T& default_value)
-      : keys_(keys), values_(size, default_value) {}
+                  const T& default_value,
+                  HistoryLayout layout = HistoryLayout::kMostRecentFirst)
+      : keys_(keys),
+        layout_(layout),
+        values_(size, default_value),
+        head_(size > 0 ? size - 1 : 0),
+        nb_unwritten_(size) {
+    for (const auto& key : keys_) {
+      key_path_ += "/" + key;
+    }
+  }
 
   //! Prefix of outputs in the observation dictionary.
   inline std::string prefix() const noexcept final { return "history"; }
@@ -51,7 +83,20 @@ class HistoryObserver : public Observer {
    * \param[in] observation Dictionary to read other observations from.
    */
   void read(const Dictionary& observation) final {
-    return read_value(observation, 0);
+    const Dictionary* dict = &observation;
+    for (const auto& key : keys_) {
+      dict = &(*dict)(key);
+    }
+    if (!dict->is_value()) {
+      throw TypeError(__FILE__, __LINE__,
+                      "Observation at " + key_path_ + " is not a value");
+    }
+    if (values_.empty()) {
+      return;
+    }
+    head_ = (head_ + 1 < values_.size()) ? head_ + 1 : 0;
+    values_[head_] = dict->as<T>();
+    nb_unwritten_ = std::min(nb_unwritten_ + 1, values_.size());
   }
 
   /*! Write outputs, called if reading was successful.
@@ -59,63 +104,77 @@ class HistoryObserver : public Observer {
    * \param[out] observation Dictionary to write observations to.
    */
   void write(Dictionary& observation) final {
-    auto& output = observation(prefix());
-    write_values(output, 0);
-  }
-
- private:
-  //! Concatenate keys into a single string for reporting.
-  std::string concatenate_keys() {
-    std::string output;
+    Dictionary* dict = &observation(prefix());
     for (const auto& key : keys_) {
-      output += "/" + key;
+      dict = &(*dict)(key);
+    }
+    if (layout_ == HistoryLayout::kRingBuffer) {
+      write_ring_buffer(*dict);
+    } else {
+      write_most_recent_first(*dict);
     }
-    return output;
   }
 
-  /*! Read value from an input dictionary.
+ private:
+  /*! Write values to an output dictionary, most recent first.
    *
-   * \param[in] dict Input dictionary.
-   * \param[in] key_index Index we are at in the list of keys.
+   * \param[out] dict Output dictionary.
    */
-  void read_value(const Dictionary& dict, unsigned key_index) {
-    if (key_index < keys_.size()) {
-      const std::string& key = keys_.at(key_index);
-      return read_value(dict(key), key_index + 1);
+  void write_most_recent_first(Dictionary& dict) {
+    if (dict.is_empty()) {
+      dict = std::vector<T>(values_.size());
     }
-    if (!dict.is_value()) {
-      throw TypeError(
-          __FILE__, __LINE__,
-          "Observation at " + concatenate_keys() + " is not a value");
+    auto& output = dict.as<std::vector<T>>();
+    output.resize(values_.size());
+    if (values_.empty()) {
+      return;
     }
-    const T& new_value = dict.as<T>();
-    values_.pop_back();
-    values_.insert(values_.begin(), new_value);
+    const auto split = values_.begin() + head_ + 1;
+    auto next = std::reverse_copy(values_.begin(), split, output.begin());
+    std::reverse_copy(split, values_.end(), next);
+    nb_unwritten_ = 0;
   }
 
-  /*! Write values to an output dictionary.
+  /*! Write values to an output dictionary as a ring buffer.
    *
    * \param[out] dict Output dictionary.
-   * \param[in] key_index Index we are at in the list of keys.
    */
-  void write_values(Dictionary& dict, unsigned key_index) {
-    if (key_index < keys_.size()) {
-      const std::string& key = keys_.at(key_index);
-      return write_values(dict(key), key_index + 1);
-    }
-    if (dict.is_empty()) {
-      dict = values_;
+  void write_ring_buffer(Dictionary& dict) {
+    if (!dict.has("values")) {
+      dict("values") = values_;
     } else {
-      dict.as<std::vector<T>>() = values_;
+      auto& output = dict("values").as<std::vector<T>>();
+      if (output.size() != values_.size()) {
+        output = values_;
+      } else {
+        for (size_t k = 0, i = head_; k < nb_unwritten_; ++k) {
+          output[i] = values_[i];
+          i = (i > 0) ? i - 1 : values_.size() - 1;
+        }
+      }
     }
+    dict("head") = static_cast<unsigned>(head_);
+    nb_unwritten_ = 0;
   }
 
  private:
   //! Keys locating values to read from in input observations.
   std::vector<std::string> keys_;
 
-  //! History of recent values written to output observations.
+  //! Concatenated keys, for reporting.
+  std::string key_path_;
+
+  //! Layout of history vectors in output observations.
+  HistoryLayout layout_;
+
+  //! Ring buffer of recent values.
   std::vector<T> values_;
+
+  //! Index of the most recent value in the ring buffer.
+  size_t head_;
+
+  //! Number of values read since the last write, up to the history size.
+  size_t nb_unwritten_;
 };
 
 }  // namespace vulp::observation
@@ -0,0 +1,372 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <palimpsest/Dictionary.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "vulp/exceptions/FilterError.h"
+#include "vulp/exceptions/TypeError.h"
+#include "vulp/observation/Observer.h"
+#include "vulp/utils/low_pass_filter.h"
+
+namespace vulp::observation {
+
+using palimpsest::Dictionary;
+using vulp::exceptions::FilterError;
+using vulp::exceptions::TypeError;
+using vulp::observation::Observer;
+
+/*! Report streaming statistics of scalar signals to agents.
+ *
+ * For each signal, this observer maintains statistics over a sliding window
+ * of the latest samples, as well as exponentially weighted statistics. All
+ * updates take constant (amortized, for the minimum and maximum) time:
+ *
+ * - Windowed mean and variance follow Welford's algorithm, extended to
+ *   replace the oldest sample once the window is full. They are recomputed
+ *   from the window every time it wraps around, to bound rounding drift.
+ * - Windowed minimum and maximum are the fronts of monotonic queues.
+ * - The root mean square is computed from the mean and variance.
+ *
+ * Outputs are written to the "statistics" prefix at each signal's keys, as a
+ * dictionary with "mean", "variance", "min", "max", "rms", "ewm_mean" and
+ * "ewm_variance". Variances are population variances, that is, divided by
+ * the number of samples.
+ *
+ * Non-finite samples, such as NaNs from a faulty sensor, would stay in the
+ * statistics forever. They are skipped and counted in "nb_skipped" instead,
+ * so that each signal has its own window of finite samples.
+ */
+class StatisticsObserver : public Observer {
+ public:
+  /*! Initialize observer.
+   *
+   * \param[in] key_paths Keys to read each signal from in input observations.
+   * \param[in] window_size Number of samples in the sliding window.
+   * \param[in] time_constant Time constant of exponentially weighted
+   *     statistics in [s].
+   * \param[in] dt Spine period in [s].
+   *
+   * \throw FilterError if the window is empty, or if the time constant is at
+   *     most twice the spine period.
+   */
+  StatisticsObserver(const std::vector<std::vector<std::string>>& key_paths,
+                     size_t window_size, double time_constant, double dt)
+      : window_size_(window_size), alpha_(dt / time_constant) {
+    if (window_size < 1) {
+      throw FilterError("[StatisticsObserver] Empty window");
+    }
+    utils::check_cutoff_period(time_constant, dt);
+    signals_.reserve(key_paths.size());
+    for (const auto& keys : key_paths) {
+      Signal signal;
+      signal.keys = keys;
+      for (const auto& key : keys) {
+        signal.key_path += "/" + key;
+      }
+      signal.window.resize(window_size);
+      signal.min_queue.resize(window_size);
+      signal.max_queue.resize(window_size);
+      signals_.push_back(std::move(signal));
+    }
+    inputs_.resize(signals_.size());
+  }
+
+  //! Prefix of outputs in the observation dictionary.
+  inline std::string prefix() const noexcept final { return "statistics"; }
+
+  /*! Reset observer.
+   *
+   * \param[in] config Configuration dictionary.
+   *
+   * Statistics restart from the next sample.
+   */
+  void reset(const Dictionary& config) final {
+    for (auto& signal : signals_) {
+      signal.nb_samples = 0;
+      signal.nb_skipped = 0;
+      signal.mean = 0.0;
+      signal.m2 = 0.0;
+      signal.ewm_mean = 0.0;
+      signal.ewm_variance = 0.0;
+      signal.min_queue.clear();
+      signal.max_queue.clear();
+    }
+  }
+
+  /*! Read inputs from other observations.
+   *
+   * \param[in] observation Dictionary to read other observations from.
+   *
+   * \throw TypeError if an input is not a value. Statistics are then left
+   *     unchanged.
+   */
+  void read(const Dictionary& observation) final {
+    // Read all inputs first, so that statistics are left unchanged if any
+    // of them is missing or invalid
+    for (size_t i = 0; i < signals_.size(); ++i) {
+      const Dictionary* dict = &observation;
+      for (const auto& key : signals_[i].keys) {
+        dict = &(*dict)(key);
+      }
+      if (!dict->is_value()) {
+        throw TypeError(__FILE__, __LINE__,
+                        "Observation at " + signals_[i].key_path +
+                            " is not a value");
+      }
+      inputs_[i] = dict->as<double>();
+    }
+
+    for (size_t i = 0; i < signals_.size(); ++i) {
+      if (std::isfinite(inputs_[i])) {
+        update(signals_[i], inputs_[i]);
+      } else {
+        ++signals_[i].nb_skipped;
+      }
+    }
+  }
+
+  /*! Write outputs, called if reading was successful.
+   *
+   * \param[out] observation Dictionary to write observations to.
+   */
+  void write(Dictionary& observation) final {
+    for (const auto& signal : signals_) {
+      Dictionary* dict = &observation(prefix());
+      for (const auto& key : signal.keys) {
+        dict = &(*dict)(key);
+      }
+      (*dict)("nb_skipped") = static_cast<unsigned>(signal.nb_skipped);
+      if (signal.nb_samples < 1) {
+        write_summary(*dict, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
+        continue;
+      }
+      const double nb_window = static_cast<double>(window_count(signal));
+      const double variance = std::max(signal.m2 / nb_window, 0.0);
+      const double rms = std::sqrt(variance + signal.mean * signal.mean);
+      write_summary(*dict, signal.mean, variance,
+                    signal.window[signal.min_queue.front() % window_size_],
+                    signal.window[signal.max_queue.front() % window_size_],
+                    rms, signal.ewm_mean, signal.ewm_variance);
+    }
+  }
+
+ private:
+  /*! Fixed-capacity double-ended queue of sample indices.
+   *
+   * Storage is allocated once, so that pushing and popping never allocates.
+   */
+  class IndexQueue {
+   public:
+    //! Allocate storage for a given number of indices.
+    void resize(size_t capacity) {
+      indices_.assign(capacity, 0);
+      clear();
+    }
+
+    //! Remove all indices.
+    void clear() noexcept {
+      begin_ = 0;
+      size_ = 0;
+    }
+
+    //! True if the queue is empty.
+    bool empty() const noexcept { return size_ < 1; }
+
+    //! First index in the queue.
+    uint64_t front() const noexcept { return indices_[begin_]; }
+
+    //! Last index in the queue.
+    uint64_t back() const noexcept {
+      return indices_[(begin_ + size_ - 1) % indices_.size()];
+    }
+
+    //! Remove the first index.
+    void pop_front() noexcept {
+      begin_ = (begin_ + 1) % indices_.size();
+      --size_;
+    }
+
+    //! Remove the last index.
+    void pop_back() noexcept { --size_; }
+
+    //! Append an index, assuming the queue is not full.
+    void push_back(uint64_t index) noexcept {
+      indices_[(begin_ + size_) % indices_.size()] = index;
+      ++size_;
+    }
+
+   private:
+    //! Circular storage of indices
+    std::vector<uint64_t> indices_;
+
+    //! Position of the first index in storage
+    size_t begin_ = 0;
+
+    //! Number of indices in the queue
+    size_t size_ = 0;
+  };
+
+  //! Statistics of one signal.
+  struct Signal {
+    //! Keys locating values to read from in input observations
+    std::vector<std::string> keys;
+
+    //! Concatenated keys, for reporting
+    std::string key_path;
+
+    //! Samples in the sliding window, indexed by sample index modulo size
+    std::vector<double> window;
+
+    //! Mean of samples in the window
+    double mean = 0.0;
+
+    //! Sum of squared deviations from the mean in the window
+    double m2 = 0.0;
+
+    //! Indices of samples with increasing values, the minimum first
+    IndexQueue min_queue;
+
+    //! Indices of samples with decreasing values, the maximum first
+    IndexQueue max_queue;
+
+    //! Exponentially weighted mean
+    double ewm_mean = 0.0;
+
+    //! Exponentially weighted variance
+    double ewm_variance = 0.0;
+
+    //! Number of finite samples read since the last reset
+    uint64_t nb_samples = 0;
+
+    //! Number of non-finite samples skipped since the last reset
+    uint64_t nb_skipped = 0;
+  };
+
+  /*! Number of samples in the sliding window of a signal.
+   *
+   * \param[in] signal Signal to count samples of.
+   */
+  size_t window_count(const Signal& signal) const noexcept {
+    return std::min(static_cast<size_t>(signal.nb_samples), window_size_);
+  }
+
+  /*! Add a new sample to the statistics of a signal.
+   *
+   * \param[in, out] signal Signal to update.
+   * \param[in] x New sample, assumed finite.
+   */
+  void update(Signal& signal, double x) noexcept {
+    const uint64_t index = signal.nb_samples;
+    const size_t slot = index % window_size_;
+    if (index < 1) {
+      signal.ewm_mean = x;
+      signal.ewm_variance = 0.0;
+    } else {
+      const double delta = x - signal.ewm_mean;
+      signal.ewm_mean += alpha_ * delta;
+      signal.ewm_variance =
+          (1.0 - alpha_) * (signal.ewm_variance + alpha_ * delta * delta);
+    }
+
+    if (index < window_size_) {
+      const double delta = x - signal.mean;
+      signal.mean += delta / static_cast<double>(index + 1);
+      signal.m2 += delta * (x - signal.mean);
+    } else {
+      const double x_old = signal.window[slot];
+      const double prev_mean = signal.mean;
+      signal.mean += (x - x_old) / static_cast<double>(window_size_);
+      signal.m2 += (x - x_old) * (x - signal.mean + x_old - prev_mean);
+    }
+    signal.window[slot] = x;
+    signal.nb_samples = index + 1;
+
+    // Rounding errors of the sliding updates would accumulate otherwise
+    if (index >= window_size_ && slot + 1 == window_size_) {
+      recompute_moments(signal);
+    }
+
+    // Drop the sample leaving the window, then dominated samples
+    if (index >= window_size_) {
+      const uint64_t expired = index - window_size_;
+      for (auto* queue : {&signal.min_queue, &signal.max_queue}) {
+        if (!queue->empty() && queue->front() == expired) {
+          queue->pop_front();
+        }
+      }
+    }
+    while (!signal.min_queue.empty() &&
+           signal.window[signal.min_queue.back() % window_size_] >= x) {
+      signal.min_queue.pop_back();
+    }
+    signal.min_queue.push_back(index);
+    while (!signal.max_queue.empty() &&
+           signal.window[signal.max_queue.back() % window_size_] <= x) {
+      signal.max_queue.pop_back();
+    }
+    signal.max_queue.push_back(index);
+  }
+
+  /*! Recompute the windowed mean and variance of a full window.
+   *
+   * \param[in, out] signal Signal to update.
+   */
+  void recompute_moments(Signal& signal) const noexcept {
+    const double nb_window = static_cast<double>(window_size_);
+    double sum = 0.0;
+    for (const double x : signal.window) {
+      sum += x;
+    }
+    signal.mean = sum / nb_window;
+    signal.m2 = 0.0;
+    for (const double x : signal.window) {
+      signal.m2 += (x - signal.mean) * (x - signal.mean);
+    }
+  }
+
+  /*! Write summary values to an output dictionary.
+   *
+   * \param[out] dict Output dictionary.
+   * \param[in] mean Windowed mean.
+   * \param[in] variance Windowed variance.
+   * \param[in] min Windowed minimum.
+   * \param[in] max Windowed maximum.
+   * \param[in] rms Windowed root mean square.
+   * \param[in] ewm_mean Exponentially weighted mean.
+   * \param[in] ewm_variance Exponentially weighted variance.
+   */
+  static void write_summary(Dictionary& dict, double mean, double variance,
+                            double min, double max, double rms,
+                            double ewm_mean, double ewm_variance) {
+    dict("mean") = mean;
+    dict("variance") = variance;
+    dict("min") = min;
+    dict("max") = max;
+    dict("rms") = rms;
+    dict("ewm_mean") = ewm_mean;
+    dict("ewm_variance") = ewm_variance;
+  }
+
+  //! Number of samples in the sliding window, once full
+  size_t window_size_;
+
+  //! Weight of new samples in exponentially weighted statistics
+  double alpha_;
+
+  //! Statistics of each signal
+  std::vector<Signal> signals_;
+
+  //! Input of each signal at the current cycle
+  std::vector<double> inputs_;
+};
+
+}  // namespace vulp::observation
@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include <benchmark/benchmark.h>
+#include <palimpsest/Dictionary.h>
+
+#include <Eigen/Core>
+#include <string>
+#include <vector>
+
+#include "vulp/observation/DownsamplingHistoryObserver.h"
+
+namespace vulp::observation {
+
+/*! Last second of IMU vectors at 1 kHz for a 200 Hz agent.
+ *
+ * The argument is the decimation, with 1 keeping every sample. The history
+ * covers one second whatever the decimation.
+ */
+static void BM_DownsamplingHistoryObserver(benchmark::State& state) {
+  const unsigned decimation = static_cast<unsigned>(state.range(0));
+  const double dt = 1e-3;
+  DownsamplingHistoryObserver<Eigen::Vector3d> observer(
+      {{"imu", "linear_acceleration"}, {"imu", "angular_velocity"}},
+      /* size = */ 1000 / decimation, decimation,
+      /* cutoff_period = */ 2.5 * decimation * dt, dt,
+      Eigen::Vector3d::Zero());
+  palimpsest::Dictionary observation;
+  Eigen::Vector3d input = Eigen::Vector3d::Zero();
+  for (auto _ : state) {
+    input.x() += 1.0;
+    observation("imu")("linear_acceleration") = input;
+    observation("imu")("angular_velocity") = input;
+    observer.read(observation);
+    observer.write(observation);
+  }
+  benchmark::DoNotOptimize(observation);
+}
+BENCHMARK(BM_DownsamplingHistoryObserver)->Arg(1)->Arg(5)->Arg(10);
+
+}  // namespace vulp::observation
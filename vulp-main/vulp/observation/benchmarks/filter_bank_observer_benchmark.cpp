@@ -0,0 +1,42 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include <benchmark/benchmark.h>
+#include <palimpsest/Dictionary.h>
+
+#include <string>
+#include <vector>
+
+#include "vulp/observation/FilterBankObserver.h"
+
+namespace vulp::observation {
+
+/*! Throughput of the filter bank over scalar servo channels.
+ *
+ * Arguments are the filter order and the number of channels. Items are
+ * filtered values, including reading inputs and writing outputs.
+ */
+static void BM_FilterBankObserver(benchmark::State& state) {
+  std::vector<std::vector<std::string>> key_paths;
+  for (int64_t i = 0; i < state.range(1); ++i) {
+    key_paths.push_back({"servo", "joint_" + std::to_string(i), "torque"});
+  }
+  FilterBankObserver::Parameters params;
+  params.order = static_cast<unsigned>(state.range(0));
+  FilterBankObserver observer(key_paths, {}, params, 1e-3);
+  palimpsest::Dictionary observation;
+  double torque = 0.0;
+  for (auto _ : state) {
+    for (const auto& keys : key_paths) {
+      observation(keys[0])(keys[1])(keys[2]) = torque;
+      torque = (torque > 10.0) ? -10.0 : torque + 0.7;
+    }
+    observer.read(observation);
+    observer.write(observation);
+  }
+  benchmark::DoNotOptimize(observation);
+  state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+BENCHMARK(BM_FilterBankObserver)->ArgsProduct({{1, 2, 4}, {12, 36, 100}});
+
+}  // namespace vulp::observation
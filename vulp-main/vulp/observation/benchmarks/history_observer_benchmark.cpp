@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include <benchmark/benchmark.h>
+#include <palimpsest/Dictionary.h>
+
+#include <string>
+#include <vector>
+
+#include "vulp/observation/HistoryObserver.h"
+
+namespace vulp::observation {
+
+/*! Read and write a torque history at each cycle, as the spine does.
+ *
+ * Arguments are the output layout, as in \ref HistoryLayout, and the size of
+ * the history vector.
+ */
+static void BM_HistoryObserver(benchmark::State& state) {
+  const auto layout = static_cast<HistoryLayout>(state.range(0));
+  HistoryObserver<double> history_observer(
+      std::vector<std::string>{"servo", "left_knee", "torque"},
+      static_cast<size_t>(state.range(1)), 0.0, layout);
+  palimpsest::Dictionary observation;
+  observation("servo")("left_knee")("torque") = 0.0;
+  double torque = 0.0;
+  for (auto _ : state) {
+    observation("servo")("left_knee")("torque") = torque;
+    history_observer.read(observation);
+    history_observer.write(observation);
+    torque += 1.0;
+  }
+  benchmark::DoNotOptimize(observation);
+}
+BENCHMARK(BM_HistoryObserver)->ArgsProduct({{0, 1}, {10, 100, 1000}});
+
+}  // namespace vulp::observation
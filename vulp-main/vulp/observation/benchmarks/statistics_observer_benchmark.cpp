@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include <benchmark/benchmark.h>
+#include <palimpsest/Dictionary.h>
+
+#include <string>
+#include <vector>
+
+#include "vulp/observation/StatisticsObserver.h"
+
+namespace vulp::observation {
+
+/*! Statistics of the torques of twelve servos at each spine cycle.
+ *
+ * The argument is the window size. Items are signal updates.
+ */
+static void BM_StatisticsObserver(benchmark::State& state) {
+  constexpr int kNbServos = 12;
+  std::vector<std::vector<std::string>> key_paths;
+  for (int i = 0; i < kNbServos; ++i) {
+    key_paths.push_back({"servo", "joint_" + std::to_string(i), "torque"});
+  }
+  StatisticsObserver observer(key_paths, state.range(0), 0.1, 1e-3);
+  palimpsest::Dictionary observation;
+  double torque = 0.0;
+  for (auto _ : state) {
+    for (const auto& keys : key_paths) {
+      observation(keys[0])(keys[1])(keys[2]) = torque;
+      torque = (torque > 10.0) ? -10.0 : torque + 0.7;
+    }
+    observer.read(observation);
+    observer.write(observation);
+  }
+  benchmark::DoNotOptimize(observation);
+  state.SetItemsProcessed(state.iterations() * kNbServos);
+}
+BENCHMARK(BM_StatisticsObserver)->Arg(10)->Arg(1000);
+
+}  // namespace vulp::observation
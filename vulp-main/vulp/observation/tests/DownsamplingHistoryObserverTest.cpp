@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include <palimpsest/Dictionary.h>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "vulp/exceptions/FilterError.h"
+#include "vulp/observation/DownsamplingHistoryObserver.h"
+
+namespace vulp::observation::tests {
+
+using palimpsest::Dictionary;
+using vulp::exceptions::FilterError;
+
+TEST(DownsamplingHistoryObserver, CutoffBelowNyquist) {
+  const std::vector<std::vector<std::string>> key_paths = {{"imu", "x"}};
+  ASSERT_THROW(DownsamplingHistoryObserver<double>(
+                   key_paths, /* size = */ 10, /* decimation = */ 5,
+                   /* cutoff_period = */ 8e-3, /* dt = */ 1e-3, 0.0),
+               FilterError);
+  ASSERT_THROW(DownsamplingHistoryObserver<double>(
+                   key_paths, /* size = */ 10, /* decimation = */ 0,
+                   /* cutoff_period = */ 1.0, /* dt = */ 1e-3, 0.0),
+               FilterError);
+}
+
+TEST(DownsamplingHistoryObserver, KeepsEveryKthSample) {
+  DownsamplingHistoryObserver<double> observer(
+      /* key_paths = */ {{"servo", "left_knee", "torque"}},
+      /* size = */ 3,
+      /* decimation = */ 2,
+      /* cutoff_period = */ 5e-3,
+      /* dt = */ 1e-3,
+      /* default_value = */ -1.0);
+
+  // A constant input goes through the filter unchanged
+  Dictionary observation;
+  observation("servo")("left_knee")("torque") = 4.0;
+  observer.read(observation);
+  observer.write(observation);
+  const auto& values = observation("history")("servo")("left_knee")("torque")
+                           .as<std::vector<double>>();
+  ASSERT_EQ(values.size(), 3);
+  ASSERT_DOUBLE_EQ(values[0], 4.0);
+  ASSERT_DOUBLE_EQ(values[1], -1.0);
+
+  for (int i = 0; i < 3; ++i) {
+    observer.read(observation);
+    observer.write(observation);
+  }
+  ASSERT_DOUBLE_EQ(values[0], 4.0);
+  ASSERT_DOUBLE_EQ(values[1], 4.0);
+  ASSERT_DOUBLE_EQ(values[2], -1.0);  // only two samples kept in 4 cycles
+}
+
+TEST(DownsamplingHistoryObserver, FiltersBeforeDownsampling) {
+  DownsamplingHistoryObserver<double> observer(
+      /* key_paths = */ {{"signal"}},
+      /* size = */ 4,
+      /* decimation = */ 2,
+      /* cutoff_period = */ 5e-3,
+      /* dt = */ 1e-3,
+      /* default_value = */ 0.0);
+
+  // Alternating input at the Nyquist frequency of the spine
+  Dictionary observation;
+  for (int i = 0; i < 200; ++i) {
+    observation("signal") = (i % 2 == 0) ? 1.0 : -1.0;
+    observer.read(observation);
+  }
+  observer.write(observation);
+
+  // Kept samples all fall on the same phase, but the filter removed it
+  const auto& values =
+      observation("history")("signal").as<std::vector<double>>();
+  for (const double value : values) {
+    ASSERT_LT(std::abs(value), 0.15);
+  }
+}
+
+TEST(DownsamplingHistoryObserver, SeveralVectorSignals) {
+  DownsamplingHistoryObserver<Eigen::Vector3d> observer(
+      /* key_paths = */ {{"imu", "linear_acceleration"},
+                         {"imu", "angular_velocity"}},
+      /* size = */ 2,
+      /* decimation = */ 1,
+      /* cutoff_period = */ 5e-3,
+      /* dt = */ 1e-3,
+      /* default_value = */ Eigen::Vector3d::Zero());
+
+  Dictionary observation;
+  observation("imu")("linear_acceleration") = Eigen::Vector3d{1.0, 2.0, 3.0};
+  observation("imu")("angular_velocity") = Eigen::Vector3d{0.1, 0.2, 0.3};
+  observer.read(observation);
+  observation("imu")("linear_acceleration") = Eigen::Vector3d{2.0, 2.0, 3.0};
+  observer.read(observation);
+  observer.write(observation);
+
+  const auto& accelerations =
+      observation("history")("imu")("linear_acceleration")
+          .as<std::vector<Eigen::Vector3d>>();
+  ASSERT_EQ(accelerations.size(), 2);
+  ASSERT_DOUBLE_EQ(accelerations[1].x(), 1.0);
+  ASSERT_DOUBLE_EQ(accelerations[0].x(), 1.2);  // 1.0 + (2.0 - 1.0) / 5
+  ASSERT_DOUBLE_EQ(accelerations[0].z(), 3.0);
+
+  const auto& velocities = observation("history")("imu")("angular_velocity")
+                               .as<std::vector<Eigen::Vector3d>>();
+  ASSERT_TRUE(velocities[0].isApprox(Eigen::Vector3d{0.1, 0.2, 0.3}));
+}
+
+TEST(DownsamplingHistoryObserver, ResetClearsHistory) {
+  DownsamplingHistoryObserver<double> observer(
+      /* key_paths = */ {{"signal"}},
+      /* size = */ 2,
+      /* decimation = */ 1,
+      /* cutoff_period = */ 5e-3,
+      /* dt = */ 1e-3,
+      /* default_value = */ -1.0);
+
+  Dictionary observation;
+  observation("signal") = 3.0;
+  observer.read(observation);
+  observer.read(observation);
+  observer.reset(Dictionary());
+  observation("signal") = 5.0;
+  observer.read(observation);
+  observer.write(observation);
+
+  const auto& values =
+      observation("history")("signal").as<std::vector<double>>();
+  ASSERT_DOUBLE_EQ(values[0], 5.0);  // filter restarts from the new input
+  ASSERT_DOUBLE_EQ(values[1], -1.0);
+}
+
+}  // namespace vulp::observation::tests
@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include <palimpsest/Dictionary.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "vulp/exceptions/FilterError.h"
+#include "vulp/observation/FilterBankObserver.h"
+#include "vulp/utils/low_pass_filter.h"
+
+namespace vulp::observation::tests {
+
+using palimpsest::Dictionary;
+using vulp::exceptions::FilterError;
+
+TEST(FilterBankObserver, InvalidParameters) {
+  FilterBankObserver::Parameters params;
+  params.order = 3;
+  ASSERT_THROW(FilterBankObserver({{"signal"}}, {}, params, 1e-3),
+               FilterError);
+  params.order = 2;
+  params.cutoff_period = 2e-3;
+  ASSERT_THROW(FilterBankObserver({{"signal"}}, {}, params, 1e-3),
+               FilterError);
+}
+
+TEST(FilterBankObserver, FirstOrderMatchesLowPassFilter) {
+  const double dt = 1e-3;
+  FilterBankObserver::Parameters params;
+  params.order = 1;
+  params.cutoff_period = 10 * dt;
+  FilterBankObserver observer({{"servo", "left_knee", "torque"}}, {}, params,
+                              dt);
+  ASSERT_EQ(observer.nb_values(), 1);
+
+  Dictionary observation;
+  double expected = 0.0;
+  for (int i = 0; i < 10; ++i) {
+    const double torque = std::sin(0.3 * i);
+    observation("servo")("left_knee")("torque") = torque;
+    observer.read(observation);
+    observer.write(observation);
+    expected = (i == 0) ? torque
+                        : utils::low_pass_filter(expected, params.cutoff_period,
+                                                 torque, dt);
+  }
+  const double output =
+      observation("filtered")("servo")("left_knee")("torque");
+  ASSERT_NEAR(output, expected, 1e-12);
+}
+
+TEST(FilterBankObserver, ButterworthSteadyStateAndAttenuation) {
+  const double dt = 1e-3;
+  FilterBankObserver::Parameters params;
+  params.order = 4;
+  params.cutoff_period = 20 * dt;
+  FilterBankObserver observer({{"constant"}, {"oscillating"}}, {}, params, dt);
+
+  // Constant inputs go through from the first cycle, while oscillations at
+  // five times the cutoff frequency are attenuated by 4 * 14 = 56 dB
+  Dictionary observation;
+  double max_output = 0.0;
+  for (int i = 0; i < 1000; ++i) {
+    observation("constant") = 2.5;
+    observation("oscillating") = std::sin(2.0 * M_PI * 5.0 / 20.0 * i);
+    observer.read(observation);
+    observer.write(observation);
+    ASSERT_NEAR(observation("filtered").get<double>("constant"), 2.5, 1e-10);
+    if (i >= 500) {
+      max_output = std::max(
+          max_output,
+          std::abs(observation("filtered").get<double>("oscillating")));
+    }
+  }
+  ASSERT_LT(max_output, 0.01);
+}
+
+TEST(FilterBankObserver, ScalarAndVectorChannels) {
+  FilterBankObserver observer(
+      /* scalar_key_paths = */ {{"servo", "left_wheel", "velocity"}},
+      /* vector_key_paths = */ {{"imu", "angular_velocity"}},
+      FilterBankObserver::Parameters(), 1e-3);
+  ASSERT_EQ(observer.nb_values(), 4);
+
+  Dictionary observation;
+  observation("servo")("left_wheel")("velocity") = 1.0;
+  observation("imu")("angular_velocity") = Eigen::Vector3d{0.1, 0.2, 0.3};
+  observer.read(observation);
+  observer.write(observation);
+  observation("imu")("angular_velocity") = Eigen::Vector3d{1.1, 0.2, 0.3};
+  observer.read(observation);
+  observer.write(observation);
+
+  const Eigen::Vector3d& angular_velocity =
+      observation("filtered")("imu")("angular_velocity")
+          .as<Eigen::Vector3d>();
+  ASSERT_GT(angular_velocity.x(), 0.1);
+  ASSERT_LT(angular_velocity.x(), 1.1);
+  ASSERT_NEAR(angular_velocity.y(), 0.2, 1e-12);
+  ASSERT_NEAR(observation("filtered")("servo")("left_wheel")
+                  .get<double>("velocity"),
+              1.0, 1e-12);
+}
+
+TEST(FilterBankObserver, ResetReconfigures) {
+  FilterBankObserver observer({{"signal"}}, {},
+                              FilterBankObserver::Parameters(), 1e-3);
+
+  Dictionary config;
+  config("filter_bank")("order") = 1;
+  config("filter_bank")("cutoff_period") = 5e-3;
+  observer.reset(config);
+
+  Dictionary observation;
+  observation("signal") = 0.0;
+  observer.read(observation);
+  observation("signal") = 1.0;
+  observer.read(observation);
+  observer.write(observation);
+  ASSERT_DOUBLE_EQ(observation("filtered").get<double>("signal"), 0.2);
+
+  // Invalid parameters are rejected without replacing the current ones
+  config("filter_bank")("order") = 5;
+  ASSERT_THROW(observer.reset(config), FilterError);
+  ASSERT_NO_THROW(observer.reset(Dictionary()));
+  observation("signal") = 0.0;
+  observer.read(observation);
+  observation("signal") = 1.0;
+  observer.read(observation);
+  observer.write(observation);
+  ASSERT_DOUBLE_EQ(observation("filtered").get<double>("signal"), 0.2);
+}
+
+}  // namespace vulp::observation::tests
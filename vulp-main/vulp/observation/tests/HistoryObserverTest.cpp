@@ -101,4 +101,59 @@ TEST(HistoryObserver, Vector3dReadThenWrite) {
   ASSERT_DOUBLE_EQ(values[2].z(), 3.2);
 }
 
+TEST(HistoryObserver, WrapAround) {
+  HistoryObserver<double> history_observer(
+      /* keys = */ std::vector<std::string>{"servo", "left_knee", "torque"},
+      /* size = */ 3,
+      /* default_value = */ 0.0);
+
+  Dictionary observation;
+  for (int i = 1; i <= 5; ++i) {
+    observation("servo")("left_knee")("torque") = static_cast<double>(i);
+    history_observer.read(observation);
+    history_observer.write(observation);
+  }
+
+  const auto& values = observation("history")("servo")("left_knee")("torque")
+                           .as<std::vector<double>>();
+  ASSERT_EQ(values.size(), 3);
+  ASSERT_DOUBLE_EQ(values[0], 5.0);
+  ASSERT_DOUBLE_EQ(values[1], 4.0);
+  ASSERT_DOUBLE_EQ(values[2], 3.0);
+}
+
+TEST(HistoryObserver, RingBufferLayout) {
+  HistoryObserver<double> history_observer(
+      /* keys = */ std::vector<std::string>{"servo", "left_knee", "torque"},
+      /* size = */ 3,
+      /* default_value = */ 0.0,
+      /* layout = */ HistoryLayout::kRingBuffer);
+
+  Dictionary observation;
+  for (int i = 1; i <= 4; ++i) {
+    observation("servo")("left_knee")("torque") = static_cast<double>(i);
+    history_observer.read(observation);
+    if (i != 2) {  // several reads may happen between two writes
+      history_observer.write(observation);
+    }
+  }
+
+  const auto& output = observation("history")("servo")("left_knee")("torque");
+  const auto& values = output("values").as<std::vector<double>>();
+  const unsigned head = output("head");
+  ASSERT_EQ(values.size(), 3);
+  ASSERT_EQ(head, 0);
+  ASSERT_DOUBLE_EQ(values[head], 4.0);
+  ASSERT_DOUBLE_EQ(values[2], 3.0);
+  ASSERT_DOUBLE_EQ(values[1], 2.0);
+
+  // A new output dictionary gets all values
+  Dictionary other_observation;
+  history_observer.write(other_observation);
+  const auto& other_values =
+      other_observation("history")("servo")("left_knee")("torque")("values")
+          .as<std::vector<double>>();
+  ASSERT_EQ(other_values, values);
+}
+
 }  // namespace vulp::observation::tests
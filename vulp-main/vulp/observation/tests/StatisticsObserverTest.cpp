@@ -0,0 +1,200 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include <palimpsest/Dictionary.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "vulp/exceptions/FilterError.h"
+#include "vulp/exceptions/TypeError.h"
+#include "vulp/observation/StatisticsObserver.h"
+
+namespace vulp::observation::tests {
+
+using palimpsest::Dictionary;
+using vulp::exceptions::FilterError;
+using vulp::exceptions::TypeError;
+
+TEST(StatisticsObserver, InvalidParameters) {
+  const std::vector<std::vector<std::string>> key_paths = {{"signal"}};
+  ASSERT_THROW(StatisticsObserver(key_paths, /* window_size = */ 0,
+                                  /* time_constant = */ 0.1, /* dt = */ 1e-3),
+               FilterError);
+  ASSERT_THROW(StatisticsObserver(key_paths, /* window_size = */ 10,
+                                  /* time_constant = */ 1e-3, /* dt = */ 1e-3),
+               FilterError);
+}
+
+TEST(StatisticsObserver, WriteBeforeRead) {
+  StatisticsObserver observer({{"servo", "left_knee", "torque"}}, 10, 0.1,
+                              1e-3);
+  Dictionary observation;
+  observer.write(observation);
+  const auto& output =
+      observation("statistics")("servo")("left_knee")("torque");
+  ASSERT_DOUBLE_EQ(output.get<double>("mean"), 0.0);
+  ASSERT_DOUBLE_EQ(output.get<double>("max"), 0.0);
+}
+
+TEST(StatisticsObserver, MatchesBruteForceWindow) {
+  const size_t window_size = 7;
+  StatisticsObserver observer({{"a"}, {"b"}}, window_size, 0.1, 1e-3);
+
+  std::mt19937 rng(42);
+  std::normal_distribution<double> noise(1.0, 2.0);
+  std::vector<double> samples;
+  Dictionary observation;
+  for (int i = 0; i < 100; ++i) {
+    const double x = noise(rng);
+    samples.push_back(x);
+    observation("a") = x;
+    observation("b") = -x;
+    observer.read(observation);
+    observer.write(observation);
+
+    const size_t n = std::min(samples.size(), window_size);
+    const auto begin = samples.end() - n;
+    double mean = 0.0;
+    double mean_square = 0.0;
+    for (auto it = begin; it != samples.end(); ++it) {
+      mean += *it / n;
+      mean_square += *it * *it / n;
+    }
+    double variance = 0.0;
+    for (auto it = begin; it != samples.end(); ++it) {
+      variance += (*it - mean) * (*it - mean) / n;
+    }
+
+    const auto& a = observation("statistics")("a");
+    ASSERT_NEAR(a.get<double>("mean"), mean, 1e-10);
+    ASSERT_NEAR(a.get<double>("variance"), variance, 1e-10);
+    ASSERT_NEAR(a.get<double>("rms"), std::sqrt(mean_square), 1e-10);
+    ASSERT_DOUBLE_EQ(a.get<double>("min"),
+                     *std::min_element(begin, samples.end()));
+    ASSERT_DOUBLE_EQ(a.get<double>("max"),
+                     *std::max_element(begin, samples.end()));
+
+    const auto& b = observation("statistics")("b");
+    ASSERT_NEAR(b.get<double>("mean"), -mean, 1e-10);
+    ASSERT_DOUBLE_EQ(b.get<double>("min"),
+                     -*std::max_element(begin, samples.end()));
+  }
+}
+
+TEST(StatisticsObserver, ExponentiallyWeighted) {
+  StatisticsObserver observer({{"signal"}}, 10, /* time_constant = */ 5e-3,
+                              /* dt = */ 1e-3);
+  Dictionary observation;
+  observation("signal") = 1.0;
+  observer.read(observation);
+  observation("signal") = 2.0;
+  observer.read(observation);
+  observer.write(observation);
+
+  // alpha = dt / time_constant = 0.2
+  const auto& output = observation("statistics")("signal");
+  ASSERT_DOUBLE_EQ(output.get<double>("ewm_mean"), 1.2);
+  ASSERT_DOUBLE_EQ(output.get<double>("ewm_variance"), 0.8 * 0.2);
+
+  // Constant inputs make the variance vanish
+  for (int i = 0; i < 1000; ++i) {
+    observer.read(observation);
+  }
+  observer.write(observation);
+  ASSERT_NEAR(output.get<double>("ewm_mean"), 2.0, 1e-12);
+  ASSERT_NEAR(output.get<double>("ewm_variance"), 0.0, 1e-12);
+  ASSERT_DOUBLE_EQ(output.get<double>("variance"), 0.0);
+}
+
+TEST(StatisticsObserver, ResetRestartsStatistics) {
+  StatisticsObserver observer({{"signal"}}, 4, 0.1, 1e-3);
+  Dictionary observation;
+  observation("signal") = 10.0;
+  observer.read(observation);
+  observer.read(observation);
+  observer.reset(Dictionary());
+  observation("signal") = -3.0;
+  observer.read(observation);
+  observer.write(observation);
+
+  const auto& output = observation("statistics")("signal");
+  ASSERT_DOUBLE_EQ(output.get<double>("mean"), -3.0);
+  ASSERT_DOUBLE_EQ(output.get<double>("max"), -3.0);
+  ASSERT_DOUBLE_EQ(output.get<double>("ewm_mean"), -3.0);
+}
+
+TEST(StatisticsObserver, InvalidInputLeavesStatisticsUnchanged) {
+  StatisticsObserver observer({{"a"}, {"b"}}, 4, 0.1, 1e-3);
+  Dictionary observation;
+  observation("a") = 1.0;
+  observation("b") = 2.0;
+  observer.read(observation);
+
+  // The first signal is valid but the second one is not a value
+  Dictionary invalid;
+  invalid("a") = 100.0;
+  invalid("b")("nested") = 2.0;
+  ASSERT_THROW(observer.read(invalid), TypeError);
+
+  observation("a") = 3.0;
+  observer.read(observation);
+  observer.write(observation);
+  const auto& output = observation("statistics")("a");
+  ASSERT_DOUBLE_EQ(output.get<double>("mean"), 2.0);
+  ASSERT_DOUBLE_EQ(output.get<double>("max"), 3.0);
+  ASSERT_DOUBLE_EQ(output.get<double>("variance"), 1.0);
+}
+
+TEST(StatisticsObserver, NonFiniteSamplesAreSkipped) {
+  StatisticsObserver observer({{"a"}, {"b"}}, 4, 0.1, 1e-3);
+  Dictionary observation;
+  observation("a") = 1.0;
+  observation("b") = 1.0;
+  observer.read(observation);
+  observation("a") = std::numeric_limits<double>::quiet_NaN();
+  observation("b") = 2.0;
+  observer.read(observation);
+  observation("a") = 3.0;
+  observation("b") = std::numeric_limits<double>::infinity();
+  observer.read(observation);
+  observer.write(observation);
+
+  const auto& a = observation("statistics")("a");
+  ASSERT_DOUBLE_EQ(a.get<double>("mean"), 2.0);
+  ASSERT_DOUBLE_EQ(a.get<double>("max"), 3.0);
+  ASSERT_EQ(a.get<unsigned>("nb_skipped"), 1);
+  const auto& b = observation("statistics")("b");
+  ASSERT_DOUBLE_EQ(b.get<double>("mean"), 1.5);
+  ASSERT_DOUBLE_EQ(b.get<double>("max"), 2.0);
+  ASSERT_EQ(b.get<unsigned>("nb_skipped"), 1);
+}
+
+TEST(StatisticsObserver, MomentsAreRecomputedWhenWindowWraps) {
+  const size_t window_size = 8;
+  StatisticsObserver observer({{"signal"}}, window_size, 0.1, 1e-3);
+  std::mt19937 rng(42);
+  std::normal_distribution<double> noise(1e8, 1e3);
+  Dictionary observation;
+  for (size_t i = 0; i < 100 * window_size; ++i) {
+    observation("signal") = noise(rng);
+    observer.read(observation);
+  }
+
+  // Sliding updates alone would leave rounding errors of large past samples
+  observation("signal") = 1.0;
+  for (size_t i = 0; i < window_size; ++i) {
+    observer.read(observation);
+  }
+  observer.write(observation);
+  const auto& output = observation("statistics")("signal");
+  ASSERT_DOUBLE_EQ(output.get<double>("mean"), 1.0);
+  ASSERT_DOUBLE_EQ(output.get<double>("variance"), 0.0);
+}
+
+}  // namespace vulp::observation::tests
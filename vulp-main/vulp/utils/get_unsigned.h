@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <palimpsest/Dictionary.h>
+
+#include <stdexcept>
+#include <string>
+
+namespace vulp::utils {
+
+/*! Get a non-negative integer from a configuration dictionary.
+ *
+ * \param dict Dictionary to read from.
+ * \param key Key of the integer in the dictionary.
+ * \param default_value Value returned if the key is absent.
+ *
+ * \return Value of the integer.
+ *
+ * \throw std::invalid_argument if the value is negative.
+ *
+ * Configurations deserialized from MessagePack store integers as `int`, so
+ * that reading them as `unsigned` directly would fail with a type error.
+ */
+inline unsigned get_unsigned(const palimpsest::Dictionary& dict,
+                             const std::string& key, unsigned default_value) {
+  if (!dict.has(key)) {
+    return default_value;
+  }
+  const int value = dict.get<int>(key);
+  if (value < 0) {
+    throw std::invalid_argument("[get_unsigned] Value of \"" + key +
+                                "\" should be non-negative, got " +
+                                std::to_string(value));
+  }
+  return static_cast<unsigned>(value);
+}
+
+}  // namespace vulp::utils
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <Eigen/Core>
 #include <stdexcept>
 #include <string>
 
@@ -12,18 +13,15 @@ namespace vulp::utils {
 
 using vulp::exceptions::FilterError;
 
-/*! Low-pass filter as an inline function.
+/*! Check that a cutoff period does not lose information.
  *
- * \param prev_output Previous filter output, or initial value.
  * \param cutoff_period Cutoff period in [s].
- * \param new_input New filter input.
  * \param dt Sampling period in [s].
  *
- * \return New filter output.
+ * \throw FilterError if the cutoff period is at most twice the sampling
+ *     period.
  */
-inline double low_pass_filter(double prev_output, double cutoff_period,
-                              double new_input, double dt) {
-  // Make sure the cutoff period is not too small
+inline void check_cutoff_period(double cutoff_period, double dt) {
   if (cutoff_period <= 2.0 * dt) {
     auto message =
         std::string("[low_pass_filter] Cutoff period ") +
@@ -32,10 +30,43 @@ inline double low_pass_filter(double prev_output, double cutoff_period,
         " s, causing information loss (Nyquist–Shannon sampling theorem)";
     throw FilterError(message);
   }
+}
+
+/*! Low-pass filter as an inline function.
+ *
+ * \param prev_output Previous filter output, or initial value.
+ * \param cutoff_period Cutoff period in [s].
+ * \param new_input New filter input.
+ * \param dt Sampling period in [s].
+ *
+ * \return New filter output.
+ */
+inline double low_pass_filter(double prev_output, double cutoff_period,
+                              double new_input, double dt) {
+  // Make sure the cutoff period is not too small
+  check_cutoff_period(cutoff_period, dt);
 
   // Actual filtering ;)
   const double alpha = dt / cutoff_period;
   return prev_output + alpha * (new_input - prev_output);
 }
 
+/*! Low-pass filter applied coefficient-wise to an Eigen vector.
+ *
+ * \param prev_output Previous filter output, or initial value.
+ * \param cutoff_period Cutoff period in [s].
+ * \param new_input New filter input.
+ * \param dt Sampling period in [s].
+ *
+ * \return New filter output.
+ */
+template <typename Derived>
+inline typename Derived::PlainObject low_pass_filter(
+    const Eigen::MatrixBase<Derived>& prev_output, double cutoff_period,
+    const Eigen::MatrixBase<Derived>& new_input, double dt) {
+  check_cutoff_period(cutoff_period, dt);
+  const double alpha = dt / cutoff_period;
+  return prev_output + alpha * (new_input - prev_output);
+}
+
 }  // namespace vulp::utils
@@ -0,0 +1,33 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "vulp/utils/get_unsigned.h"
+
+#include <palimpsest/Dictionary.h>
+
+#include <stdexcept>
+
+#include "gtest/gtest.h"
+
+namespace vulp::utils {
+
+using palimpsest::Dictionary;
+
+TEST(GetUnsigned, ReadsIntegers) {
+  Dictionary config;
+  config("answer") = 42;
+  ASSERT_EQ(get_unsigned(config, "answer", 0u), 42u);
+}
+
+TEST(GetUnsigned, DefaultValue) {
+  Dictionary config;
+  ASSERT_EQ(get_unsigned(config, "missing", 7u), 7u);
+}
+
+TEST(GetUnsigned, RejectsNegativeValues) {
+  Dictionary config;
+  config("answer") = -1;
+  ASSERT_THROW(get_unsigned(config, "answer", 0u), std::invalid_argument);
+}
+
+}  // namespace vulp::utils
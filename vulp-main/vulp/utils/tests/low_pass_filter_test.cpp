@@ -28,4 +28,16 @@ TEST(InlineLowPassFilter, Converges) {
   ASSERT_LT(output, target);
 }
 
+TEST(InlineLowPassFilter, EigenVector) {
+  const double dt = 1e-3;
+  const double T = 10 * dt;
+  const Eigen::Vector3d input(1.0, -2.0, 3.0);
+  const Eigen::Vector3d output =
+      low_pass_filter(Eigen::Vector3d::Zero().eval(), T, input, dt);
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_DOUBLE_EQ(output[i], low_pass_filter(0.0, T, input[i], dt));
+  }
+  ASSERT_THROW(low_pass_filter(output, dt, input, dt), FilterError);
+}
+
 }  // namespace vulp::utils